@@ -0,0 +1,142 @@
+/**
+ * @file AcquisitionPlan.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Choice of the ADC data rate and switch delay for a set of channels and a sample rate
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef ACQUISITIONPLAN_H
+#define ACQUISITIONPLAN_H
+
+#include <bit>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+
+#include "Ads1258.h"
+
+constexpr std::array<double, 4> AUTO_SCAN_RATES = {AUTO_DRATE0, AUTO_DRATE1, AUTO_DRATE2, AUTO_DRATE3}; ///< Conversions per second by DRATE field.
+constexpr std::array<double, 8> SWITCH_DELAYS_US = {DLY0, DLY1, DLY2, DLY3, DLY4, DLY5, DLY6, DLY7};     ///< Switch delay in microseconds by DLY field.
+
+constexpr uint8_t SYSTEM_READINGS = 0b111101; ///< Bits of SYSRED that select a reading, bit 1 is reserved.
+
+/**
+ * @brief Channels of an auto-scan, laid out as the MUXDIF, MUXSG0/MUXSG1 and SYSRED registers.
+ */
+struct ScanChannels
+{
+    uint8_t differential = 0; ///< Bit per differential pair, see DiffChannel.
+    uint16_t single = 0;      ///< Bit per single ended input, see SingleChannel.
+    uint8_t system = 0;       ///< System readings, see SystemChannels.
+
+    /**
+     * @brief Number of conversions in one scan.
+     */
+    constexpr uint32_t size(void) const
+    {
+        return std::popcount(differential) + std::popcount(single) + std::popcount(static_cast<uint8_t>(system & SYSTEM_READINGS));
+    }
+
+    bool operator==(const ScanChannels &) const = default;
+};
+
+/**
+ * @brief What the planner optimizes once the target rate is reached.
+ */
+enum class PlanGoal
+{
+    MIN_POWER, ///< Slowest settings that reach the target, the fewest conversions to read and filter.
+    MAX_RATE   ///< Fastest settings, the target is only a lower bound.
+};
+
+/**
+ * @brief ADC settings for an auto-scan and the timing they give.
+ */
+struct AcquisitionPlan
+{
+    ScanChannels channels; ///< Scanned channels.
+    uint8_t drate = 0;     ///< DRATE field of CONFIG1.
+    uint8_t dly = 0;       ///< DLY field of CONFIG1.
+
+    double sample_rate = 0; ///< Scans per second, the sample rate of every channel.
+    double scan_skew = 0;   ///< Seconds between the first and the last conversion of a scan.
+
+    /**
+     * @brief Register contents to write with Ads1258::write_registers or Ads1258::initialize.
+     */
+    constexpr RegisterImage registers(void) const
+    {
+        RegisterImage image = auto_scan_registers(channels.single, drate, dly);
+
+        image[RegisterAdressses::MUXDIF] = channels.differential;
+        image[RegisterAdressses::SYSRED] = channels.system & SYSTEM_READINGS;
+
+        return image;
+    }
+
+    bool operator==(const AcquisitionPlan &) const = default;
+};
+
+/**
+ * @brief Pick the data rate and switch delay for a scan, out of every combination the ADC offers.
+ *
+ * A lower data rate is taken over a longer delay at the same sample rate, it averages more per conversion.
+ *
+ * @param channels channels to scan
+ * @param target_rate lowest sample rate per channel in Hz
+ * @param goal how to choose between the settings that reach the target
+ * @return std::optional<AcquisitionPlan> the settings, empty when no setting reaches the target
+ * @throws std::invalid_argument when no channel is selected
+ */
+constexpr std::optional<AcquisitionPlan> plan_acquisition(const ScanChannels &channels, const double target_rate, const PlanGoal goal)
+{
+    const uint32_t n = channels.size();
+
+    if (!n)
+        throw std::invalid_argument("an acquisition needs at least one channel");
+
+    std::optional<AcquisitionPlan> best;
+
+    for (uint8_t drate = 0; drate < AUTO_SCAN_RATES.size(); drate++)
+    {
+        for (uint8_t dly = 0; dly < SWITCH_DELAYS_US.size(); dly++)
+        {
+            const double rate = channel_drate_delay_to_frequency(n, AUTO_SCAN_RATES[drate], SWITCH_DELAYS_US[dly]);
+
+            if (rate < target_rate)
+                continue;
+
+            if (best && (goal == PlanGoal::MAX_RATE ? rate <= best->sample_rate : rate >= best->sample_rate))
+                continue;
+
+            best = AcquisitionPlan{.channels = channels,
+                                   .drate = drate,
+                                   .dly = dly,
+                                   .sample_rate = rate,
+                                   .scan_skew = (n - 1) / drate_delay_to_frequency(AUTO_SCAN_RATES[drate], SWITCH_DELAYS_US[dly])};
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief Single ended inputs of three-component geophones, counted down from AIN15.
+ *
+ * @param n_geophones number of geophones, 1 up to 5
+ * @throws std::invalid_argument when the geophones do not fit on the 16 inputs
+ */
+constexpr ScanChannels geophone_channels(const uint32_t n_geophones)
+{
+    if (n_geophones < 1 || n_geophones > 5)
+        throw std::invalid_argument("the number of geophones has to be between 1 and 5");
+
+    return {.single = static_cast<uint16_t>(((1u << 3 * n_geophones) - 1) << (16 - 3 * n_geophones))};
+}
+
+#endif
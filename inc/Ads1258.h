@@ -12,8 +12,10 @@
 #ifndef ADS1258_H
 #define ADS1258_H
 
+#include <span>
+#include <array>
 #include <vector>
-#include <map>
+#include <chrono>
 #include <cmath>
 
 #include "spi.h"
@@ -56,7 +58,28 @@ typedef GpioReg GpioDirection;
 typedef GpioReg GpioOutput;
 typedef GpioReg GpioInput;
 
-typedef std::pair<uint8_t, int32_t> ChannelData;
+constexpr uint8_t SAMPLE_NEW = 0x80;      ///< NEW bit, the conversion was not read before.
+constexpr uint8_t SAMPLE_OVERFLOW = 0x40; ///< OVF bit, the input exceeded the range of the ADC.
+constexpr uint8_t SAMPLE_SUPPLY = 0x20;   ///< SUPPLY bit, the analog supply was below its threshold.
+
+/**
+ * @brief A single conversion result together with the flags of the STATUS byte it was read with.
+ */
+struct ChannelData
+{
+    uint8_t channel; ///< Channel id (CHID) of the conversion.
+    uint8_t flags;   ///< SAMPLE_NEW, SAMPLE_OVERFLOW and SAMPLE_SUPPLY bits, 0 when the status byte is not read.
+    int32_t value;   ///< Sign extended 24 bit conversion result.
+};
+
+/**
+ * @brief STATUS flags of one frame, bit i belongs to the i-th active channel.
+ */
+struct FrameFlags
+{
+    uint32_t overflow = 0; ///< OVF bits, input exceeded the range of the ADC.
+    uint32_t supply = 0;   ///< SUPPLY bits, analog supply dropped below its threshold.
+};
 
 union SingleChannel
 {
@@ -118,6 +141,38 @@ union SystemChannels
     uint16_t raw_data;
 };
 
+/**
+ * @brief Contents of the writable registers CONFIG0 up to GPIOD, indexed by RegisterAdressses.
+ */
+typedef std::array<char, NUM_REGISTERS - 1> RegisterImage;
+
+/** Register contents after a reset */
+constexpr RegisterImage DEFAULT_REGISTERS = {CONFIG0_DEFAULT.raw_data, CONFIG1_DEFAULT.raw_data, MUXSCH_DEFAULT.raw_data,
+                                             MUXDIF_DEFAULT.raw_data, MUXSG0_DEFAULT.raw_data, MUXSG1_DEFAULT.raw_data,
+                                             SYSRED_DEFAULT.raw_data, GPIOC_DEFAULT.raw_data, GPIOD_DEFAULT.raw_data};
+
+/**
+ * @brief Build the registers for auto-scan mode over single ended channels, with the STATUS byte on and the
+ * internal clock running without sleep mode.
+ *
+ * @param channels bit per single ended channel, see SingleChannel
+ * @param drate DRATE field of CONFIG1
+ * @param delay DLY field of CONFIG1
+ * @return RegisterImage to write with Ads1258::write_registers
+ */
+constexpr RegisterImage auto_scan_registers(const uint16_t channels, const uint8_t drate, const uint8_t delay)
+{
+    RegisterImage image = DEFAULT_REGISTERS;
+
+    // the bitfield unions cannot be used in a constant expression, so the fields are shifted in place
+    image[RegisterAdressses::CONFIG0] = 1 << 1;                                 // STAT
+    image[RegisterAdressses::CONFIG1] = (delay & 0b111) << 4 | (drate & 0b11); // IDLMOD and SCBCS off
+    image[RegisterAdressses::MUXSG0] = channels & 0xFF;
+    image[RegisterAdressses::MUXSG1] = channels >> 8;
+
+    return image;
+}
+
 constexpr double channel_drate_delay_to_frequency(const double n_channels, const double drate, const double delay_us)
 {
     double time = 1 / drate + delay_us * 1e-6;
@@ -145,7 +200,9 @@ private:
     uint8_t _channel_index;
     std::vector<uint8_t> _channel_ids;
 
-    std::map<RegisterAdressses, char> registers;
+    uint32_t _spi_speed = 0; ///< SPI clock in Hz, the spacing of direct reads depends on it.
+
+    RegisterImage registers;
 
     void set_register(RegisterAdressses address, char data);
     void set_all_registers(void);
@@ -154,6 +211,7 @@ private:
 
     void reset_local_registers(void);
     void reset_channel_data(void);
+    void update_active_channels(void);
 
 public:
     Ads1258(std::filesystem::path spi, std::filesystem::path gpio);
@@ -285,7 +343,31 @@ public:
     void update_settings(void);
 
     /**
-     * @brief retrieve settings from ADC to verify configuration
+     * @brief write all registers in a single burst and take over their channel selection
+     *
+     * @param image register contents, see auto_scan_registers
+     */
+    void write_registers(const RegisterImage &image);
+
+    /**
+     * @brief reset the ADC, wait until it answers and write and verify its registers
+     *
+     * @param image register contents to write
+     * @param max_tries attempts before giving up
+     * @throws std::runtime_error when the ADC did not take the registers in any attempt
+     */
+    void initialize(const RegisterImage &image, const uint32_t max_tries);
+
+    /**
+     * @brief poll the ID register until the ADC answers after a reset or power up
+     *
+     * @param timeout how long to keep polling
+     * @return true if the ADC answered with the ID of an ADS1258 within the timeout
+     */
+    bool wait_until_ready(std::chrono::microseconds timeout);
+
+    /**
+     * @brief retrieve settings from ADC in a single burst to verify configuration
      * 
      * @return true if settings are correct with what is saved locally
      * @return false if settings are incorrect with what is saved locally
@@ -323,7 +405,7 @@ public:
     /**
      * @brief Get 2 pairs of channeldata
      * 
-     * @return std::pair<ChannelData, ChannelData> 2 pairs of adc data
+     * @return std::pair<ChannelData, ChannelData> 2 samples of adc data
      */
     std::pair<ChannelData, ChannelData> get_data_read(void);
 
@@ -334,6 +416,41 @@ public:
      */
     ChannelData get_data_direct(void);
 
+    /**
+     * @brief wait for the falling edge of DRDY, which signals a new conversion
+     *
+     * @param timeout how long to wait
+     * @return true if DRDY fell within the timeout
+     */
+    bool await_data_ready(std::chrono::microseconds timeout);
+
+    /**
+     * @brief read a batch of conversions with direct reads of 4 bytes, the STATUS byte and the conversion result
+     *
+     * Every read follows its own DRDY edge, so every conversion is read once. A conversion read a second time comes
+     * without SAMPLE_NEW.
+     *
+     * @param out conversions to fill, its size is the batch size
+     * @param period time between two conversions, the wait for an edge gives up after two of them
+     * @return size_t number of conversions read, fewer than the batch size when DRDY did not come
+     * @throws std::logic_error when the STATUS byte is disabled
+     */
+    size_t get_data_direct(std::span<ChannelData> out, std::chrono::nanoseconds period);
+
+    /**
+     * @brief set the SPI clock
+     *
+     * @param speed clock in Hz
+     */
+    void set_spi_speed(uint32_t speed);
+
+    /**
+     * @brief get the SPI clock
+     *
+     * @return uint32_t clock in Hz
+     */
+    uint32_t get_spi_speed(void) const;
+
     /**
      * @brief Get the active channels
      * 
@@ -0,0 +1,129 @@
+/**
+ * @file ArchiveFormat.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Layout of the time-indexed archive files
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * An archive file is a file header followed by blocks of interleaved frames and, once the file is closed,
+ * a sparse time index and a trailer. Every block carries its own start time and checksums, so a file that
+ * was never closed can be read and repaired by scanning the blocks. All fields are little endian and
+ * every block starts on an 8 byte boundary. The payload of a block holds its frames, followed by the STATUS
+ * records of the frames the ADC flagged when the block has the ARCHIVE_STATUS flag.
+ *
+ */
+
+#ifndef ARCHIVEFORMAT_H
+#define ARCHIVEFORMAT_H
+
+#include <cstdint>
+
+constexpr char ARCHIVE_MAGIC[8] = {'D', 'R', 'G', 'A', 'R', 'C', 'H', '1'};
+constexpr char ARCHIVE_INDEX_MAGIC[8] = {'D', 'R', 'G', 'A', 'I', 'D', 'X', '1'};
+constexpr uint32_t ARCHIVE_BLOCK_MAGIC = 0x314b4c42; // "BLK1"
+constexpr uint16_t ARCHIVE_VERSION = 1;
+constexpr uint32_t ARCHIVE_INDEX_INTERVAL = 16; // blocks between two index entries unless configured otherwise
+
+/**
+ * @brief Flags of a block.
+ */
+enum ArchiveBlockFlags : uint32_t
+{
+    ARCHIVE_DISCONTINUITY = 1 << 0, ///< The block does not follow the previous block in time, such as after a restart.
+    ARCHIVE_STATUS = 1 << 1,        ///< STATUS records follow the frames in the payload.
+};
+
+/**
+ * @brief Flags of a file.
+ */
+enum ArchiveFileFlags : uint32_t
+{
+    ARCHIVE_RAW = 1 << 0,    ///< Samples are the unfiltered ADC codes, samples the ADC did not deliver are 0.
+    ARCHIVE_MERGED = 1 << 1, ///< Channels of several units side by side, bit s of a gap_mask marks unit s as missing.
+};
+
+/**
+ * @brief Start of every archive file.
+ */
+struct ArchiveFileHeader
+{
+    char magic[8];
+    uint16_t version;
+    uint16_t n_channels;
+    uint16_t bits_per_sample;
+    uint16_t bytes_per_sample; ///< Bytes of every stored sample, samples are packed little endian.
+    double sample_rate;
+    uint32_t channel_mask;     ///< ADC channels of the stored channels, in order.
+    uint32_t frames_per_block; ///< Frames of a full block, the last block of a file may be shorter.
+    uint32_t flags;            ///< ArchiveFileFlags.
+    uint32_t reserved[2];
+    uint32_t crc; ///< CRC32C of the preceding bytes of the header.
+};
+
+/**
+ * @brief Start of every block, followed by payload_size bytes of interleaved frames and padding up to 8 bytes.
+ */
+struct ArchiveBlockHeader
+{
+    uint32_t magic;
+    uint32_t payload_size;
+    int64_t start_time_ns; ///< Time of the first frame, nanoseconds since the Unix epoch.
+    uint64_t first_sample; ///< Index of the first frame since the start of the recording.
+    uint32_t n_frames;
+    uint32_t channel_mask; ///< ADC channels of the stored channels, in order.
+    uint32_t gap_mask;     ///< Channels with samples that were filled in because the ADC did not deliver them.
+    uint32_t flags;        ///< ArchiveBlockFlags.
+    uint32_t payload_crc;  ///< CRC32C of the payload.
+    uint32_t header_crc;   ///< CRC32C of the preceding bytes of the header.
+};
+
+/**
+ * @brief STATUS flags of one frame, only stored for frames with a flag set.
+ */
+struct ArchiveStatusRecord
+{
+    uint32_t frame;    ///< Frame in the block, counted from its first frame.
+    uint32_t overflow; ///< Stored channels whose input exceeded the range of the ADC.
+    uint32_t supply;   ///< Stored channels whose analog supply was low.
+};
+
+/**
+ * @brief Entry of the sparse time index, one for every index_interval blocks.
+ */
+struct ArchiveIndexEntry
+{
+    int64_t start_time_ns;
+    uint64_t first_sample;
+    uint64_t offset; ///< File offset of the block header.
+};
+
+/**
+ * @brief End of a closed archive file.
+ */
+struct ArchiveTrailer
+{
+    uint64_t index_offset;
+    uint32_t n_entries;
+    uint32_t index_crc;      ///< CRC32C of the index entries.
+    uint32_t index_interval; ///< Blocks between two index entries.
+    uint32_t crc;            ///< CRC32C of the preceding bytes of the trailer.
+    char magic[8];
+};
+
+static_assert(sizeof(ArchiveFileHeader) == 48);
+static_assert(sizeof(ArchiveBlockHeader) == 48);
+static_assert(sizeof(ArchiveStatusRecord) == 12);
+static_assert(sizeof(ArchiveIndexEntry) == 24);
+static_assert(sizeof(ArchiveTrailer) == 32);
+
+/**
+ * @brief Size of a block with its header and padding.
+ */
+constexpr uint64_t archive_block_size(uint32_t payload_size)
+{
+    return sizeof(ArchiveBlockHeader) + ((payload_size + 7) & ~uint64_t(7));
+}
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * @file ArchiveWriter.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Long recording files made of checksummed, time-stamped blocks with a sparse time index
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef ARCHIVEWRITER_H
+#define ARCHIVEWRITER_H
+
+#include <vector>
+
+#include "ArchiveFormat.h"
+#include "AsyncFileWriter.h"
+#include "RecordingWriter.h"
+
+class ArchiveWriter : public RecordingWriter
+{
+private:
+    static constexpr size_t BUFFER_SIZE = 1 << 20; ///< Size of the pool buffers, a block always fits in one.
+
+    // Sample size and speed information
+    uint16_t _n_channels = 0;
+    double _sample_rate = 0;
+    uint16_t _bits_per_sample = 0;
+    uint16_t _bytes_per_sample = 0;
+    uint32_t _channel_mask = 0;
+    uint32_t _file_flags = 0;
+
+    // Block settings
+    double _block_seconds;
+    uint32_t _index_interval;
+    uint32_t _frames_per_block = 0;
+
+    // Storage objects, every file operation runs on the storage thread of _io
+    AsyncFileWriter _io{BUFFER_SIZE, 3};
+    AsyncFileWriter::FileId _file = 0;
+    bool _is_open = false;
+    IoBuffer *_buffer = nullptr; ///< Buffer collecting blocks, written once full.
+    uint64_t _buffer_offset = 0; ///< File offset of the start of _buffer.
+    uint64_t _offset = 0;        ///< File offset of the next block.
+
+    // Block state
+    std::vector<int32_t> _pending;     ///< Interleaved frames of the next block.
+    uint32_t _gap_mask = 0;            ///< Gaps in the pending frames.
+    uint32_t _next_gaps = 0;           ///< Gaps in the frames of the next write_frames call.
+    std::vector<ArchiveStatusRecord> _status;      ///< Flags of the pending frames, counted from the start of the next block.
+    std::vector<ArchiveStatusRecord> _next_status; ///< Flags of the frames of the next write_frames call.
+    uint64_t _sample_index = 0;        ///< Index of the next frame since the writer was created.
+    uint64_t _file_first_sample = 0;   ///< Index of the first frame of the open file.
+    uint64_t _n_blocks = 0;            ///< Blocks in the open file.
+    bool _discontinuity = true;        ///< Whether the next block starts a new recording.
+    std::vector<ArchiveIndexEntry> _index;
+
+    // Periodic commits
+    uint64_t _commit_frames = 0;
+    uint64_t _frames_since_commit = 0;
+
+    // Metadata
+    std::chrono::system_clock::time_point _datetime;
+
+    void write_block(const int32_t *frames, uint32_t n_frames, uint32_t gap_mask);
+    void submit_buffer(void);
+
+public:
+    /**
+     * @brief Construct a writer.
+     *
+     * @param block_seconds Duration of the frames in one block.
+     * @param index_interval Blocks between two entries of the time index.
+     */
+    ArchiveWriter(double block_seconds = 1.0, uint32_t index_interval = ARCHIVE_INDEX_INTERVAL);
+    ~ArchiveWriter() override;
+
+    ArchiveWriter(const ArchiveWriter &) = delete;
+    ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+
+    std::string extension() const override { return ".drga"; }
+
+    /**
+     * @brief The archive has no free text field, the comments are dropped.
+     */
+    void set_comments(const std::string &comment) override;
+
+    /**
+     * @brief Set the time of the first frame in the file, the start time of every block follows from it.
+     *
+     * @param datetime The timestamp of the first frame.
+     */
+    void set_datetime(const std::chrono::system_clock::time_point &datetime) override;
+
+    void open_file(const std::string &file_name) override;
+
+    /**
+     * @brief Close the file, the remaining frames are written as a shorter block followed by the time index.
+     */
+    void close_file() override;
+
+    void flush() override;
+    WriteLatency take_write_latency() override;
+
+    /**
+     * @brief Write interleaved frames, a block is written once enough frames are collected.
+     *
+     * @param interleaved Samples ordered frame after frame, n_channels samples per frame.
+     * @param n_frames Number of frames to write from the start of interleaved.
+     */
+    void write_frames(std::span<const int32_t> interleaved, size_t n_frames) override;
+
+    void mark_gaps(uint32_t channel_mask) override;
+
+    /**
+     * @brief Record the STATUS flags of a frame, they are stored after the frames of its block.
+     */
+    void mark_status(uint32_t frame, uint32_t overflow, uint32_t supply) override;
+
+    /**
+     * @brief Write the complete blocks to storage and sync them periodically.
+     *
+     * @param frames Number of frames between commits, 0 disables them.
+     */
+    void set_commit_interval(uint64_t frames) override;
+
+    void set_n_channels(uint16_t num_channels) override;
+    void set_sample_rate(uint32_t sample_rate) override;
+
+    /**
+     * @brief Set a sample rate that is not a whole number, used for the block start times.
+     *
+     * @param sample_rate The sample rate in Hz.
+     */
+    void set_exact_sample_rate(double sample_rate);
+
+    void set_bits_per_sample(uint16_t bits_per_sample) override;
+
+    /**
+     * @brief Set the ADC channels that are stored, recorded in every block.
+     *
+     * @param channel_mask Bit c is set when ADC channel c is stored.
+     */
+    void set_channel_mask(uint32_t channel_mask);
+
+    /**
+     * @brief Mark the files as holding unfiltered ADC codes, takes effect at the next open_file.
+     *
+     * @param raw Whether the samples are the raw ADC codes.
+     */
+    void set_raw(bool raw);
+
+    /**
+     * @brief Mark the files as merged from several units, takes effect at the next open_file. The gap masks
+     * then hold one bit per unit instead of one per channel.
+     *
+     * @param merged Whether the channels come from several units.
+     */
+    void set_merged(bool merged);
+
+    /**
+     * @brief Repair a file that was not closed, it is cut after its last valid block and gets a time index.
+     *
+     * @param file_name The archive file.
+     * @return true when the file was repaired, false when it was closed properly or is not an archive file
+     */
+    static bool recover_file(const std::string &file_name);
+};
+
+#endif
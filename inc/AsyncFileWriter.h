@@ -0,0 +1,220 @@
+/**
+ * @file AsyncFileWriter.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Dedicated storage thread that performs all file I/O through io_uring or pwrite
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef ASYNCFILEWRITER_H
+#define ASYNCFILEWRITER_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <filesystem>
+#include <unordered_map>
+
+/**
+ * @brief Aligned block of memory from the writer's pool.
+ */
+struct IoBuffer
+{
+    uint8_t *data = nullptr; ///< Start of the block, aligned to IO_BUFFER_ALIGNMENT.
+    size_t capacity = 0;     ///< Size of the block.
+    size_t size = 0;         ///< Number of bytes in use.
+};
+
+/**
+ * @brief Write completion latency, measured from queueing a write until it has completed.
+ */
+struct WriteLatency
+{
+    uint64_t writes = 0; ///< Number of completed writes.
+    uint64_t bytes = 0;  ///< Number of bytes written.
+    double mean_ms = 0;  ///< Mean latency.
+    double max_ms = 0;   ///< Worst latency.
+};
+
+constexpr size_t IO_BUFFER_ALIGNMENT = 4096;
+
+class AsyncFileWriter
+{
+public:
+    typedef uint32_t FileId;
+
+private:
+    struct IoRequest
+    {
+        enum Type
+        {
+            OPEN,
+            WRITE,
+            SYNC,
+            CLOSE,
+            TRUNCATE,
+            TASK
+        } type;
+
+        FileId file = 0;
+        uint64_t offset = 0;            ///< File offset of a write, or the length of a truncate.
+        IoBuffer *buffer = nullptr;     ///< Pool buffer of a write, returned to the pool when done.
+        std::vector<uint8_t> bytes;     ///< Owned bytes of a small write without a pool buffer.
+        std::filesystem::path path;     ///< Path of an open request.
+        std::function<void()> task;     ///< Work of a task request.
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    size_t _buffer_size;            ///< Size of every pool buffer.
+    std::vector<IoBuffer> _buffers; ///< All pool buffers.
+    std::vector<IoBuffer *> _free_buffers; ///< Buffers that can be handed out.
+
+    std::deque<IoRequest> _queue; ///< Requests in submission order.
+    bool _busy = false;           ///< Whether the thread is working on taken requests.
+    std::atomic<FileId> _next_file_id = 1;
+
+    std::thread _thread;
+    std::atomic_bool _run_thread = false;
+    std::mutex _mtx;                     ///< Protects the queue, the pool and the statistics.
+    std::condition_variable _cv_queue;   ///< Signals new requests or a stop request.
+    std::condition_variable _cv_buffers; ///< Signals a buffer that returned to the pool.
+    std::condition_variable _cv_idle;    ///< Signals that every queued request has completed.
+
+    // only used by the storage thread
+    std::unordered_map<FileId, int> _fds;
+    bool _use_uring = false;
+    void *_ring = nullptr;
+
+    // statistics
+    WriteLatency _latency;
+    double _latency_sum_ms = 0;
+    std::string _last_error;
+
+    void thread_func(void);
+    void execute(IoRequest &request);
+    void execute_writes(std::vector<IoRequest *> &writes);
+    void close_ring(void);
+    bool pwrite_all(int fd, const uint8_t *data, size_t size, uint64_t offset);
+    void complete_write(IoRequest &request, bool success);
+    void fail(const std::string &error);
+    void enqueue(IoRequest &&request);
+
+public:
+    /**
+     * @brief Construct a writer with a pool of aligned buffers.
+     *
+     * @param buffer_size Size of each pool buffer in bytes.
+     * @param n_buffers Number of pool buffers, 2 for double and 3 for triple buffering.
+     */
+    AsyncFileWriter(size_t buffer_size = 1 << 20, size_t n_buffers = 3);
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter &) = delete;
+    AsyncFileWriter &operator=(const AsyncFileWriter &) = delete;
+
+    /**
+     * @brief Start the storage thread, uses io_uring when available and pwrite otherwise.
+     */
+    void start(void);
+
+    /**
+     * @brief Complete every queued request and stop the storage thread.
+     */
+    void stop(void);
+
+    /**
+     * @brief Queue the creation of a file, truncating an existing one.
+     *
+     * @param path Path of the file.
+     * @return FileId handle for the following requests
+     */
+    FileId open(const std::filesystem::path &path);
+
+    /**
+     * @brief Get an empty buffer from the pool.
+     *
+     * Only blocks when every buffer is still queued or in flight, which means storage is falling behind.
+     *
+     * @return IoBuffer* buffer to fill and pass to write
+     */
+    IoBuffer *acquire_buffer(void);
+
+    /**
+     * @brief Queue a write of a pool buffer, the buffer returns to the pool once written.
+     *
+     * @param file Handle from open.
+     * @param offset File offset of the first byte.
+     * @param buffer Buffer from acquire_buffer, size bytes are written.
+     */
+    void write(FileId file, uint64_t offset, IoBuffer *buffer);
+
+    /**
+     * @brief Queue a write of a small block of bytes, such as a header.
+     *
+     * @param file Handle from open.
+     * @param offset File offset of the first byte.
+     * @param bytes Bytes to write, owned by the request.
+     */
+    void write(FileId file, uint64_t offset, std::vector<uint8_t> &&bytes);
+
+    /**
+     * @brief Queue an fdatasync, it completes after every write queued before it.
+     *
+     * @param file Handle from open.
+     */
+    void sync(FileId file);
+
+    /**
+     * @brief Queue a truncate or extension of the file to a length.
+     *
+     * @param file Handle from open.
+     * @param length New file length in bytes.
+     */
+    void truncate(FileId file, uint64_t length);
+
+    /**
+     * @brief Queue closing the file, after every write queued before it.
+     *
+     * @param file Handle from open.
+     */
+    void close(FileId file);
+
+    /**
+     * @brief Queue work that runs on the storage thread, after every request queued before it.
+     *
+     * Used for file operations that do not fit the requests above, such as mapping a file.
+     *
+     * @param task Work to run, must not throw.
+     */
+    void run(std::function<void()> task);
+
+    /**
+     * @brief Wait until every queued request has completed.
+     */
+    void wait_idle(void);
+
+    /**
+     * @brief Get the write latency since the previous call and reset it.
+     *
+     * @return WriteLatency latency statistics
+     */
+    WriteLatency take_latency(void);
+
+    /**
+     * @brief Get and clear the last error reported by the storage thread.
+     *
+     * @return std::string error message, empty when there was none
+     */
+    std::string take_error(void);
+};
+
+#endif
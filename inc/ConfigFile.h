@@ -0,0 +1,77 @@
+/**
+ * @file ConfigFile.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Reader of the key = value configuration file
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef CONFIGFILE_H
+#define CONFIGFILE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+
+/**
+ * @brief Settings as text, one "key = value" per line.
+ *
+ * Empty lines and everything after a # are ignored, spaces around keys and values are removed. A key that
+ * appears twice keeps its last value.
+ */
+class ConfigFile
+{
+private:
+    std::filesystem::path _path;
+    std::map<std::string, std::string> _values;
+
+public:
+    ConfigFile() = default;
+
+    /**
+     * @brief Read a file, replacing the values read before.
+     *
+     * @param path file to read
+     * @throws std::runtime_error when the file cannot be read or a line has no =
+     */
+    void load(const std::filesystem::path &path);
+
+    /**
+     * @brief File that was read last, empty when none was read.
+     */
+    const std::filesystem::path &path(void) const { return _path; }
+
+    /**
+     * @brief Value of a key, without the quotes around it.
+     */
+    std::optional<std::string> get(const std::string &key) const;
+
+    /**
+     * @brief Set a value in memory, the file is not changed.
+     */
+    void set(const std::string &key, const std::string &value);
+
+    /**
+     * @brief Give a value an other key, used for keys that were renamed.
+     */
+    void rename(const std::string &old_key, const std::string &new_key);
+
+    void clear(void) { _values.clear(); }
+
+    /**
+     * @brief All keys, in alphabetical order.
+     */
+    std::vector<std::string> keys(void) const;
+};
+
+/**
+ * @brief Replace a leading ~ in a path with the home folder.
+ */
+std::filesystem::path expand_home(const std::string &path);
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file ControlServer.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Unix socket that accepts text commands for the running program
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <filesystem>
+
+constexpr const char *CONTROL_DEFAULT_SOCKET = "/tmp/drongo.sock"; ///< Default path of the control socket.
+
+/**
+ * @brief Answers commands of one line each, such as "reload" or "set psd true", from a thread of its own.
+ *
+ * Every command gets the text returned by the handler as its reply, followed by an empty line so a client
+ * knows where the reply ends.
+ */
+class ControlServer
+{
+public:
+    /**
+     * @brief Handles a command and returns the reply, an exception is sent back as an error.
+     */
+    typedef std::function<std::string(const std::string &command)> Handler;
+
+private:
+    struct Client
+    {
+        int fd = -1;
+        std::string received;
+    };
+
+    std::filesystem::path _path;
+    Handler _handler;
+
+    int _listen_fd = -1;
+    int _wake_fd = -1; ///< eventfd that wakes the thread when it has to stop.
+
+    std::thread _thread;
+    std::atomic_bool _running = false;
+
+    std::vector<std::unique_ptr<Client>> _clients;
+
+    void run(void);
+    bool handle_input(Client &client);
+
+public:
+    /**
+     * @param path path of the socket, a file left behind by an earlier run is replaced
+     * @param handler called on the control thread for every command
+     */
+    ControlServer(const std::filesystem::path &path, Handler handler);
+    ~ControlServer();
+
+    ControlServer(const ControlServer &) = delete;
+    ControlServer &operator=(const ControlServer &) = delete;
+
+    /**
+     * @brief Create the socket and start the control thread.
+     *
+     * @throws std::system_error when the socket cannot be created
+     */
+    void start(void);
+
+    /**
+     * @brief Close all connections, stop the thread and remove the socket.
+     */
+    void stop(void);
+};
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * @file CrossCorrelator.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Running, stacked cross-correlation between pairs of channels
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef CROSSCORRELATOR_H
+#define CROSSCORRELATOR_H
+
+#include <span>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+#include <fftw3.h>
+
+#include "SampleSink.h"
+#include "utils/SampleRing.h"
+
+/**
+ * @brief Magic bytes at the start of every stacked correlation file.
+ */
+constexpr char XCORR_MAGIC[4] = {'D', 'X', 'C', 'R'};
+
+/**
+ * @brief Version of the stacked correlation layout.
+ */
+constexpr uint16_t XCORR_VERSION = 1;
+
+/**
+ * @brief Header of a stacked correlation file.
+ *
+ * The header is followed by n_pairs pairs of uint16 channel indices and then n_pairs * n_lags
+ * float32 normalized correlation coefficients. Lag i corresponds to (i - max_lag) samples, a positive
+ * lag means the first channel of the pair lags the second one. All fields are little endian.
+ */
+struct __attribute__((packed)) XcorrHeader
+{
+    char magic[4];         ///< XCORR_MAGIC.
+    uint16_t version;      ///< XCORR_VERSION.
+    uint16_t n_pairs;      ///< Number of channel pairs.
+    uint32_t window_size;  ///< Length of the correlated windows in samples.
+    uint32_t max_lag;      ///< Largest lag in samples.
+    uint32_t n_lags;       ///< Number of lags per pair (2 * max_lag + 1).
+    uint32_t n_stacked;    ///< Number of windows in the stack.
+    double sample_rate;    ///< Sample rate of the correlated data in Hz.
+    int64_t start_time_ns; ///< Time of the first stacked window, nanoseconds since the unix epoch.
+    double duration_s;     ///< Time span covered by the stack in seconds.
+};
+
+typedef std::pair<uint16_t, uint16_t> ChannelPair;
+
+class CrossCorrelator : public SampleSink
+{
+private:
+    uint16_t _n_channels = 0; ///< Number of channels in each frame.
+    double _sample_rate = 0;  ///< Sampling rate of the incoming frames.
+
+    std::vector<ChannelPair> _pairs;        ///< Correlated pairs, as indices into the frame.
+    std::vector<uint16_t> _used_channels;   ///< Channels that take part in at least one pair.
+    std::vector<ChannelPair> _pair_slots;   ///< Pairs as indices into _used_channels.
+
+    uint32_t _window_size = 0;     ///< Length of each correlated window.
+    uint32_t _fft_size = 0;        ///< Zero padded transform length (2 * window size).
+    uint32_t _n_bins = 0;          ///< Number of one-sided frequency bins.
+    uint32_t _bin_stride = 0;      ///< Distance between channel spectra in _fft_out.
+    uint32_t _hop_size = 0;        ///< Frames between consecutive windows.
+    uint32_t _max_lag = 0;         ///< Largest stored lag in samples.
+    uint64_t _frames_per_stack = 0; ///< Frames per stored stack.
+
+    // producer side, only touched by the thread that pushes frames
+    std::vector<SampleRing<double>> _rings; ///< Sliding window history per used channel.
+    uint32_t _frames_since_window = 0;      ///< Frames since the last window was handed off.
+    uint64_t _frames_total = 0;             ///< Frames received since the start time was set.
+    bool _sequence_known = false;           ///< Whether a block was consumed since the start time was set.
+    uint64_t _next_sequence = 0;            ///< Sequence of the block that follows the last consumed one.
+    uint64_t _next_sample = 0;              ///< First frame of the block that follows the last consumed one.
+
+    // hand off between producer and worker
+    std::vector<double> _pending;    ///< Window waiting for the worker, per used channel.
+    uint64_t _pending_frame = 0;     ///< Index of the last frame of the pending window.
+    bool _pending_ready = false;     ///< Whether _pending holds an unprocessed window.
+    uint64_t _dropped_windows = 0;   ///< Windows skipped because the worker was still busy.
+    bool _end_stack = false;         ///< Whether the worker writes the stack before the next window, set at a gap.
+
+    std::thread _worker;             ///< Thread doing the transforms and stacking.
+    std::mutex _mtx;                 ///< Protects the hand off members.
+    std::condition_variable _cv;     ///< Signals a pending window or a stop request.
+    std::atomic_bool _run_worker = false; ///< Control flag for the worker thread.
+
+    // worker side
+    std::vector<double> _segment;    ///< Window that is being processed.
+    double *_fft_in = nullptr;       ///< FFTW aligned real buffer.
+    fftw_complex *_fft_out = nullptr; ///< FFTW aligned spectra of every used channel.
+    fftw_plan _forward = nullptr;    ///< Real to complex plan of length fft size.
+    fftw_plan _inverse = nullptr;    ///< Complex to real plan of length fft size.
+    std::vector<double> _stack;      ///< Stacked cross spectrum per pair.
+    std::vector<uint32_t> _stack_count; ///< Number of windows stacked per pair.
+    uint64_t _stack_start_frame = 0; ///< First frame of the current stack.
+    uint64_t _stack_end_frame = 0;   ///< Last frame seen by the current stack.
+
+    std::filesystem::path _output_path;                ///< Directory for the correlation files.
+    std::chrono::system_clock::time_point _start_time; ///< Timestamp of the first frame.
+
+    void release_plans(void);
+    void worker_func(void);
+    void process_segment(uint64_t last_frame);
+    void write_stack(void);
+    void skip_gap(uint64_t missed_blocks, uint64_t missed_frames);
+
+public:
+    CrossCorrelator();
+    ~CrossCorrelator();
+
+    CrossCorrelator(const CrossCorrelator &) = delete;
+    CrossCorrelator &operator=(const CrossCorrelator &) = delete;
+
+    /**
+     * @brief Allocate buffers and create the FFT plans.
+     *
+     * @param n_channels Number of channels in each frame.
+     * @param sample_rate Sampling rate in Hz.
+     * @param pairs Pairs of frame indices to correlate.
+     * @param window_size Length of each correlated window in samples.
+     * @param overlap Fraction of overlap between consecutive windows, 0 <= overlap < 1.
+     * @param max_lag_seconds Largest lag that is stored.
+     * @param stack_seconds Time span that is stacked into one output file.
+     */
+    void setup(uint16_t n_channels, double sample_rate, const std::vector<ChannelPair> &pairs,
+               uint32_t window_size = 4096, double overlap = 0.5, double max_lag_seconds = 1.0, double stack_seconds = 3600);
+
+    /**
+     * @brief Set the directory where stacks are written.
+     *
+     * @param path Filesystem path for the correlation files.
+     */
+    void set_output_path(const std::filesystem::path &path);
+
+    /**
+     * @brief Set the time of the first frame, used to timestamp the stacks.
+     *
+     * @param start_time Timestamp of the next frame that will be pushed.
+     */
+    void set_start_time(const std::chrono::system_clock::time_point &start_time);
+
+    /**
+     * @brief Start the worker thread.
+     *
+     * @param core_id Core the worker is pinned to, negative to leave it unpinned.
+     */
+    void start(int core_id = -1);
+
+    /**
+     * @brief Stop the worker thread and write the partial stack.
+     */
+    void stop(void);
+
+    /**
+     * @brief Add a frame of raw ADC samples, one sample per channel.
+     *
+     * Only copies into the window history, the transforms run on the worker thread. When the worker
+     * has not finished the previous window the new window is skipped instead of blocking.
+     *
+     * @param samples The samples of a single frame.
+     */
+    void push_frame(std::span<const int32_t> samples);
+
+    const char *sink_name() const override { return "cross correlation"; }
+
+    /**
+     * @brief Add every frame of a processed block.
+     *
+     * Blocks the fan-out dropped show up as a jump in the sequence, the current stack is then written
+     * and the windows start again after the gap so no window spans it.
+     */
+    void consume(const std::shared_ptr<const SampleBlock> &block) override;
+
+    /**
+     * @brief Stop the worker, which writes the last stack.
+     */
+    void finish() override { stop(); }
+};
+
+#endif
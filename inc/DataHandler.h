@@ -19,19 +19,67 @@
 #include <deque>
 #include <atomic>
 #include <chrono>
+#include <memory>
+#include <string>
+#include <optional>
 #include <filesystem>
 
 #include "Ads1258.h"
+#include "AcquisitionPlan.h"
 #include "WAVwriter.h"
+#include "FlacWriter.h"
+#include "MiniSeedWriter.h"
+#include "ArchiveWriter.h"
+#include "SpectrumAnalyzer.h"
+#include "CrossCorrelator.h"
+#include "QualityMonitor.h"
+#include "StreamServer.h"
+#include "ShmRingWriter.h"
+#include "SinkFanout.h"
+#include "RecordingSink.h"
+#include "RuntimeConfig.h"
+#include "SignalProcessor.h"
 // #include "Plotter.h"
 
+/**
+ * @brief File format of the recorded data.
+ */
+enum class OutputFormat
+{
+    WAV,
+    FLAC,
+    MINISEED,
+    ARCHIVE
+};
+
+constexpr uint8_t ADC_GAP_CHANNEL = 0xFF; ///< Channel of the marker queued after the ADC was set up again, CHID only has 5 bits.
+
+/**
+ * @brief Counters of the ADC watchdog and the STATUS flags since acquisition started.
+ */
+struct AdcHealth
+{
+    uint32_t recoveries = 0;        ///< Times the ADC was set up again because it stalled or scanned the wrong channels.
+    uint64_t missed_frames = 0;     ///< Frames filled in for the time the ADC delivered no data.
+    double last_recovery_ms = 0;    ///< Time from detecting the fault to data flowing again, for the last recovery.
+    double longest_recovery_ms = 0; ///< Longest of those times.
+    std::chrono::system_clock::time_point started;       ///< Start of acquisition, for the number of recoveries per day.
+    std::chrono::system_clock::time_point last_recovery; ///< When the ADC delivered data again after the last recovery.
+    std::vector<uint64_t> overflow_samples;              ///< Samples per channel the ADC flagged with OVF.
+    std::vector<uint64_t> supply_samples;                ///< Samples per channel converted with a low analog supply.
+};
+
 class DataHandler
 {
         
 private:
     /* data */
     Ads1258 _adc; ///< Object for ADS1258 ADC interface.
-    WAVWriter _writer; ///< Object for writing data to WAV files.
+    std::unique_ptr<RecordingSink> _recording; ///< Output writing the data to WAV, FLAC, MiniSEED or archive files.
+    SinkFanout _sinks; ///< Hands every processed block to the enabled outputs, each on its own thread.
+    SpectrumAnalyzer _spectrum; ///< Object for writing PSD tiles next to the data files.
+    CrossCorrelator _correlator; ///< Object for stacking cross-correlations between channel pairs.
+    QualityMonitor _qc; ///< Object for writing quality control statistics next to the data files.
     
     std::thread _irq_thread; ///< Thread handling IRQ (Interrupt Requests).
     std::thread _storing_thread; ///< Thread for storing data into files.
@@ -41,6 +89,22 @@ private:
 
     std::deque<ChannelData> _raw_data_queue; ///< Queue for raw data from ADC.
 
+    /**
+     * @brief Time the ADC delivered no data, queued by the IRQ thread together with an ADC_GAP_CHANNEL marker.
+     */
+    struct AdcGap
+    {
+        std::chrono::steady_clock::duration stalled;  ///< From the last sample to data flowing again.
+        std::chrono::steady_clock::duration recovery; ///< From detecting the fault to data flowing again.
+        std::string reason;                           ///< What the watchdog noticed.
+    };
+
+    std::deque<AdcGap> _adc_gaps; ///< Gaps belonging to the markers in _raw_data_queue, guarded by _mailbox_mtx.
+    AsyncFileWriter _gap_log{IO_BUFFER_ALIGNMENT, 2}; ///< Appends to adc_recoveries.csv off the storing thread, the buffers stay unused.
+
+    AdcHealth _health;      ///< Counters of the ADC watchdog and flags, only the storing thread changes them.
+    std::mutex _health_mtx; ///< Guards _health against readers on other threads.
+
     std::mutex _mailbox_mtx; ///< Mutex for controlling access to the data queue.
 
     std::condition_variable _cv_raw_data; ///< Condition variable for new raw data.
@@ -50,37 +114,202 @@ private:
     uint8_t _current_channel; ///< Current channel being processed.
     uint8_t _n_active_channels; ///< Number of active channels.
 
-    std::string _current_filename; ///< Name of the current data file.
-    std::filesystem::path _data_path; ///< Path for storing data files.
-
     double _sample_rate; ///< Sampling rate of the ADC.
+    AcquisitionPlan _plan; ///< Channels and timing the ADC was set up with.
     uint32_t _n_samples_per_file; ///< Number of samples per file.
 
     std::chrono::system_clock::time_point _current_timestamp; ///< Current timestamp for data samples.
 
+    RuntimeConfig _config; ///< Settings in use, once acquisition runs only the storing thread changes them.
+    std::mutex _config_mtx; ///< Guards _config, _pending_config, _sample_rate and _plan against readers on other threads.
+    std::optional<RuntimeConfig> _pending_config; ///< Settings to apply at the next block boundary.
+
+    bool _raw_mode = false; ///< Whether the unfiltered ADC codes are stored.
+
+    std::unique_ptr<StreamServer> _stream_server; ///< Live stream of the processed blocks, empty when disabled.
+    std::unique_ptr<ShmRingWriter> _shm_ring;     ///< Shared memory ring with the processed frames, empty when disabled.
+
+    bool _mapped_files = false; ///< Whether data files are preallocated and memory-mapped.
+    bool _direct_read = false;  ///< Whether conversions are read directly after DRDY instead of with the read command.
+    OutputFormat _output_format = OutputFormat::WAV; ///< Format of the data files.
+    SeedCodes _seed_codes; ///< SEED identifiers of MiniSEED streams.
+    uint32_t _seed_record_length = 4096; ///< Bytes per MiniSEED record.
+    double _commit_seconds = 5; ///< Time between commits of valid sizes to the open data file, 0 disables them.
+
+    /**
+     * @brief Create the recording output with a writer of the selected file format for the active channels.
+     */
+    void create_writer(void);
+
+    /**
+     * @brief Add the enabled outputs to the fan-out, with the backlog each of them may build up.
+     *
+     * @param start time of the first frame the outputs receive
+     */
+    void setup_sinks(const std::chrono::system_clock::time_point &start);
+
+    void start_spectrum(const std::chrono::system_clock::time_point &start);
+    void start_correlator(const std::chrono::system_clock::time_point &start);
+    void start_stream_server(void);
+    void start_shm_ring(const std::chrono::system_clock::time_point &start);
+
+    /**
+     * @brief Throw std::invalid_argument for runtime settings that can never be applied.
+     */
+    void check_config(const RuntimeConfig &config) const;
+
+    /**
+     * @brief Settings of the filters, following the runtime settings.
+     */
+    SignalProcessorConfig processing_config(void) const;
+
+    /**
+     * @brief Create the data path when it does not exist and repair the newest data file in it.
+     *
+     * @param path folder of the data files
+     */
+    void prepare_data_path(const std::filesystem::path &path);
+
+    /**
+     * @brief Repair the newest data file in a folder when it was not closed properly.
+     */
+    void recover_last_file(const std::filesystem::path &path);
+
+    /**
+     * @brief Bring a stalled ADC back from the IRQ thread and queue the gap it left.
+     *
+     * Tries a register rewrite first and a full reset after that, until the ADC delivers data or the thread is
+     * stopped. The storing thread keeps the open files and fills in the frames that were missed.
+     *
+     * @param registers register contents the ADC was scanning with
+     * @param reason what the watchdog noticed, for the log
+     * @param last_sample when the last good sample arrived
+     */
+    void recover_adc(const RegisterImage &registers, const std::string &reason, const std::chrono::steady_clock::time_point &last_sample);
+
+    /**
+     * @brief Log a gap filled in after an ADC recovery and queue it for adc_recoveries.csv in the data path.
+     *
+     * @param gap what the IRQ thread measured
+     * @param start time of the first missing frame
+     * @param frames number of frames filled in
+     */
+    void record_gap(const AdcGap &gap, const std::chrono::system_clock::time_point &start, uint64_t frames);
+
+    /**
+     * @brief Set the channels and data rate of a running ADC, without a power cycle.
+     *
+     * Falls back to setup_adc when the ADC does not take the new settings.
+     *
+     * @param plan channels and timing to switch to
+     */
+    void reconfigure_adc(const AcquisitionPlan &plan);
+
+    /**
+     * @brief Process one continuous stream of frames with the current channels and rate.
+     *
+     * @return true when it ended for a change of channels, false when the handler was stopped
+     */
+    bool process_stream(void);
+
 public:
     DataHandler();
     ~DataHandler();
 
     /**
-     * @brief Set the data path for storing data files.
-     * 
-     * @param path Filesystem path for data storage.
+     * @brief Apply the runtime settings before acquisition starts: data path, ADC channels, filters and outputs.
+     *
+     * The newest data file in the data path is repaired when it was not closed properly.
+     *
+     * @param config settings to start with
+     */
+    void configure(const RuntimeConfig &config);
+
+    /**
+     * @brief Change the runtime settings while acquisition runs, from any thread.
+     *
+     * The storing thread applies them at the next block boundary, without losing samples. Only the outputs
+     * whose settings changed are restarted. A change of channels ends the data file and reconfigures the ADC.
+     *
+     * @param config settings to change to
+     * @throws std::invalid_argument when the settings can never be applied
+     */
+    void reconfigure(const RuntimeConfig &config);
+
+    /**
+     * @brief Runtime settings in use.
+     */
+    RuntimeConfig config(void);
+
+    /**
+     * @brief Sample rate of the frames in Hz.
+     */
+    double sample_rate(void);
+
+    /**
+     * @brief Counters of the ADC watchdog and of the flagged samples per channel.
      */
-    void set_data_path(std::filesystem::path path);
+    AdcHealth adc_health(void);
 
     /**
-     * @brief Set up the ADC with the specified number of channels.
+     * @brief Set how often the open data file is made durable with valid sizes.
+     *
+     * @param seconds Time between commits, 0 disables them.
+     */
+    void set_commit_interval(double seconds);
+
+    /**
+     * @brief Let storing_thread_func finish, it closes the open files before returning.
+     */
+    void stop(void);
+
+    /**
+     * @brief Set up the ADC with the specified channels and timing.
      * 
-     * @param n_channels Number of channels to activate on the ADC.
+     * @param plan channels, data rate and switch delay, see plan_acquisition
      * @param max_tries Maximum attempts for setting up the ADC. Defaults to 10.
      */
-    void setup_adc(const uint32_t n_channels, const uint32_t max_tries = 10);
+    void setup_adc(const AcquisitionPlan &plan, const uint32_t max_tries = 10);
+
+    /**
+     * @brief Write lossless FLAC files instead of WAV files, one per geophone with more than FLAC_MAX_CHANNELS channels.
+     */
+    void enable_flac(void);
+
+    /**
+     * @brief Write MiniSEED files with Steim2 compressed records instead of WAV files, one stream per channel.
+     *
+     * @param codes SEED identifiers of the streams
+     * @param record_length bytes per record, 512 or 4096
+     */
+    void enable_miniseed(const SeedCodes &codes, uint32_t record_length = 4096);
+
+    /**
+     * @brief Write long archive files of checksummed, time-stamped blocks with a time index instead of WAV files.
+     *
+     * Their length is the file duration of the runtime settings, typically an hour.
+     */
+    void enable_archive(void);
+
+    /**
+     * @brief Store the unfiltered ADC codes, without gap filling, low-pass or response extension, in the archive files.
+     *
+     * Needs archive output, which keeps the STATUS flags of every frame. The filtered product is made later with
+     * drongo_reprocess.
+     */
+    void enable_raw_mode(void);
+
+    /**
+     * @brief Allocate every data file at its full size and write samples through a memory mapping.
+     */
+    void enable_mapped_files(void);
 
     /**
-     * @brief Create a new file for storing data.
+     * @brief Read every conversion once directly after DRDY, with 4 SPI bytes per read instead of 5 with the read command.
+     *
+     * Must be called before start().
      */
-    void new_file(void);
+    void enable_direct_read(void);
 
     /**
      * @brief Delete the last created data file.
@@ -0,0 +1,178 @@
+/**
+ * @file FlacWriter.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Lossless FLAC recording files, frames are encoded in parallel on spare cores
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef FLACWRITER_H
+#define FLACWRITER_H
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "AsyncFileWriter.h"
+#include "RecordingWriter.h"
+
+constexpr uint16_t FLAC_MAX_CHANNELS = 8;  ///< Most channels of a FLAC stream.
+constexpr uint16_t FLAC_GROUP_CHANNELS = 3; ///< Channels per file when there are more than FLAC_MAX_CHANNELS, one geophone each.
+
+/**
+ * @brief Writes FLAC files, with more channels than a FLAC stream allows it writes one file per geophone.
+ */
+class FlacWriter : public RecordingWriter
+{
+private:
+    /**
+     * @brief Output state of one file, shared with the encoder threads.
+     */
+    struct FileState
+    {
+        AsyncFileWriter::FileId id = 0;
+        uint64_t offset = 0;     ///< File offset of the next frame.
+        uint64_t next_block = 0; ///< Number of the next frame to write, frames are written in order.
+        uint64_t n_blocks = UINT64_MAX; ///< Number of frames in the file, known once it is closed.
+        std::map<uint64_t, std::vector<uint8_t>> done; ///< Encoded frames waiting for their predecessors.
+
+        uint32_t min_frame_size = UINT32_MAX;
+        uint32_t max_frame_size = 0;
+
+        // format of the file, the writer may be reconfigured before the last frames are written
+        uint16_t n_channels = 0;
+        uint32_t sample_rate = 0;
+        uint16_t bits_per_sample = 0;
+        uint32_t block_size = 0;
+        uint64_t total_frames = 0; ///< Number of frames, known once the file is closed.
+
+        std::vector<uint8_t> metadata; ///< VORBIS_COMMENT and PADDING blocks, built when the file is closed.
+    };
+
+    /**
+     * @brief One frame for the encoder threads.
+     */
+    struct EncodeJob
+    {
+        std::shared_ptr<FileState> file;
+        uint64_t block_number;
+        std::vector<int32_t> samples; ///< Interleaved samples of the frame.
+    };
+
+    // Sample size and speed information
+    uint16_t _n_channels = 0;
+    uint32_t _sample_rate = 0;
+    uint16_t _bits_per_sample = 0;
+
+    // Encoder settings
+    uint32_t _block_size;    ///< Frames per FLAC frame.
+    uint32_t _max_lpc_order; ///< Highest order of the linear predictor, 0 only uses the fixed predictors.
+
+    // Storage objects, every file operation runs on the storage thread of _io
+    AsyncFileWriter _io{IO_BUFFER_ALIGNMENT, 2};
+    std::vector<std::shared_ptr<FileState>> _files; ///< Files that are open, one per channel group, empty when closed.
+    std::vector<int32_t> _block;      ///< Frames of all channels collected for the next FLAC frame.
+    uint64_t _n_blocks = 0;           ///< FLAC frames started in the open file.
+    uint64_t _n_frames = 0;           ///< Frames written to the open file.
+
+    // Encoder threads
+    std::vector<int> _cores;
+    std::vector<std::thread> _workers;
+    std::deque<EncodeJob> _jobs;
+    size_t _in_flight = 0; ///< Jobs queued or being encoded.
+    bool _run_workers = false;
+    std::mutex _mtx;                  ///< Protects the jobs and every FileState.
+    std::condition_variable _cv_jobs; ///< Signals new jobs or a stop request.
+    std::condition_variable _cv_done; ///< Signals a finished job.
+
+    // Metadata
+    std::chrono::system_clock::time_point _datetime;
+    std::string _comments;
+
+    void worker_func(int core);
+    void submit_block();
+    void write_ready(FileState &file);
+    void finalize(FileState &file);
+    void start_workers();
+    void stop_workers();
+
+    std::vector<std::pair<uint16_t, uint16_t>> channel_groups() const;
+    std::vector<uint8_t> build_metadata() const;
+    static std::vector<uint8_t> build_streaminfo(const FileState &file);
+
+public:
+    /**
+     * @brief Construct a writer.
+     *
+     * @param cores Cores to run an encoder thread on, -1 leaves a thread unpinned.
+     * @param block_size Frames per FLAC frame.
+     * @param max_lpc_order Highest order of the linear predictor, up to 32.
+     */
+    FlacWriter(std::vector<int> cores = {2, 3}, uint32_t block_size = 4096, uint32_t max_lpc_order = 8);
+    ~FlacWriter() override;
+
+    FlacWriter(const FlacWriter &) = delete;
+    FlacWriter &operator=(const FlacWriter &) = delete;
+
+    std::string extension() const override { return ".flac"; }
+
+    /**
+     * @brief Files written for a file name, with more than FLAC_MAX_CHANNELS channels one per geophone.
+     *
+     * The file of channels 3 up to 5 of "name.flac" is "name.ch3-5.flac".
+     *
+     * @param file_name The name given to open_file.
+     * @return std::vector<std::string> names of the files
+     */
+    std::vector<std::string> file_names(const std::string &file_name) const override;
+
+    void set_comments(const std::string &comment) override;
+    void set_datetime(const std::chrono::system_clock::time_point &datetime) override;
+
+    /**
+     * @brief Open a new file, a file that is not closed stays decodable up to its last written frame.
+     *
+     * @param file_name The name of the file to be created and written to.
+     */
+    void open_file(const std::string &file_name) override;
+
+    /**
+     * @brief Close the file, the last frames and the metadata are written once they are encoded.
+     */
+    void close_file() override;
+
+    /**
+     * @brief Wait until every frame has been encoded and written.
+     */
+    void flush() override;
+
+    WriteLatency take_write_latency() override;
+
+    /**
+     * @brief Write interleaved frames, every block_size frames are handed to the encoder threads.
+     *
+     * Only blocks when the encoders fall behind.
+     *
+     * @param interleaved Samples ordered frame after frame, n_channels samples per frame.
+     * @param n_frames Number of frames to write from the start of interleaved.
+     */
+    void write_frames(std::span<const int32_t> interleaved, size_t n_frames) override;
+
+    /**
+     * @brief Set the number of channels, more than FLAC_MAX_CHANNELS are split over files of FLAC_GROUP_CHANNELS.
+     *
+     * @param num_channels The number of channels.
+     */
+    void set_n_channels(uint16_t num_channels) override;
+    void set_sample_rate(uint32_t sample_rate) override;
+    void set_bits_per_sample(uint16_t bits_per_sample) override;
+};
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * @file MiniSeedWriter.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief MiniSEED recording files with Steim2 compressed, fixed size data records
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef MINISEEDWRITER_H
+#define MINISEEDWRITER_H
+
+#include <vector>
+
+#include "AsyncFileWriter.h"
+#include "RecordingWriter.h"
+
+/**
+ * @brief SEED identifiers of the recorded streams.
+ */
+struct SeedCodes
+{
+    std::string network = "XX";        ///< Network code, up to 2 characters.
+    std::string station = "DRONG";     ///< Station code, up to 5 characters.
+    std::string location = "";         ///< Location code, up to 2 characters.
+    std::vector<std::string> channels; ///< Channel code per channel, empty picks band code, P and the channel index.
+};
+
+class MiniSeedWriter : public RecordingWriter
+{
+private:
+    /**
+     * @brief Samples of one channel waiting to be encoded into records.
+     */
+    struct Stream
+    {
+        std::string channel;
+        std::vector<int32_t> pending; ///< Samples that are not in a record yet.
+        uint64_t first_sample = 0;    ///< Index in the file of pending[0].
+        int32_t last = 0;             ///< Last sample of the previous record.
+        bool has_last = false;        ///< Whether a record was written for this stream.
+
+        std::vector<std::pair<uint64_t, uint8_t>> flagged; ///< Index in the file and data quality flags of flagged pending samples.
+    };
+
+    /**
+     * @brief STATUS flags of a frame of the next write_frames call.
+     */
+    struct FrameMark
+    {
+        uint32_t frame;
+        uint32_t overflow;
+        uint32_t supply;
+    };
+
+    // Sample size and speed information
+    uint16_t _n_channels = 0;
+    double _sample_rate = 0;
+    uint16_t _bits_per_sample = 0;
+
+    // Record settings
+    SeedCodes _codes;
+    uint32_t _record_length;
+    uint32_t _n_data_frames; ///< Steim frames per record after the header.
+    int16_t _rate_factor = 0;     ///< Sample rate factor of the fixed header.
+    int16_t _rate_multiplier = 1; ///< Sample rate multiplier of the fixed header.
+
+    // Storage objects, every file operation runs on the storage thread of _io
+    AsyncFileWriter _io;
+    AsyncFileWriter::FileId _file = 0;
+    bool _is_open = false;
+    IoBuffer *_buffer = nullptr; ///< Buffer collecting records, written once full.
+    uint64_t _buffer_offset = 0; ///< File offset of the start of _buffer.
+    uint64_t _offset = 0;        ///< File offset of the next record.
+    uint32_t _sequence = 0;      ///< Sequence number of the last record in the file.
+
+    std::vector<Stream> _streams;
+    std::vector<FrameMark> _marks; ///< Flags passed to mark_status for the next write_frames call.
+
+    // Periodic commits
+    uint64_t _commit_frames = 0;
+    uint64_t _frames_since_commit = 0;
+
+    // Metadata
+    std::chrono::system_clock::time_point _datetime;
+
+    void encode_records(Stream &stream, bool partial);
+    size_t write_record(Stream &stream, size_t start);
+    void write_header(uint8_t *record, const Stream &stream, uint32_t n_samples, uint32_t n_frames, uint8_t quality);
+    void submit_buffer(void);
+
+public:
+    /**
+     * @brief Construct a writer.
+     *
+     * @param codes SEED identifiers of the streams.
+     * @param record_length Bytes per record, 512 or 4096.
+     */
+    MiniSeedWriter(const SeedCodes &codes = {}, uint32_t record_length = 4096);
+    ~MiniSeedWriter() override;
+
+    MiniSeedWriter(const MiniSeedWriter &) = delete;
+    MiniSeedWriter &operator=(const MiniSeedWriter &) = delete;
+
+    std::string extension() const override { return ".mseed"; }
+
+    /**
+     * @brief MiniSEED has no free text field, the comments are dropped.
+     */
+    void set_comments(const std::string &comment) override;
+
+    /**
+     * @brief Set the time of the first frame in the file, the start time of every record follows from it.
+     *
+     * @param datetime The timestamp of the first frame.
+     */
+    void set_datetime(const std::chrono::system_clock::time_point &datetime) override;
+
+    void open_file(const std::string &file_name) override;
+
+    /**
+     * @brief Close the file, the remaining samples of every channel are written as shorter records.
+     */
+    void close_file() override;
+
+    void flush() override;
+    WriteLatency take_write_latency() override;
+
+    /**
+     * @brief Write interleaved frames, a record is written for a channel once its samples fill one.
+     *
+     * @param interleaved Samples ordered frame after frame, n_channels samples per frame.
+     * @param n_frames Number of frames to write from the start of interleaved.
+     */
+    void write_frames(std::span<const int32_t> interleaved, size_t n_frames) override;
+
+    /**
+     * @brief Flag the records holding the frame in their data quality flags: digitizer clipping for an overflow and
+     * glitches for a low supply.
+     *
+     * @param frame Frame of the next write_frames call, counted from its first frame.
+     * @param overflow Bit i is set when the input of channel i exceeded the range of the ADC.
+     * @param supply Bit i is set when the analog supply was low while channel i was converted.
+     */
+    void mark_status(uint32_t frame, uint32_t overflow, uint32_t supply) override;
+
+    /**
+     * @brief Write the complete records to storage and sync them periodically.
+     *
+     * @param frames Number of frames between commits, 0 disables them.
+     */
+    void set_commit_interval(uint64_t frames) override;
+
+    void set_n_channels(uint16_t num_channels) override;
+    void set_sample_rate(uint32_t sample_rate) override;
+
+    /**
+     * @brief Set a sample rate that is not a whole number, used for the record start times.
+     *
+     * @param sample_rate The sample rate in Hz.
+     */
+    void set_exact_sample_rate(double sample_rate);
+
+    /**
+     * @brief Set the number of bits per sample, Steim2 stores differences of up to 30 bits.
+     *
+     * @param bits_per_sample The number of bits in each sample.
+     */
+    void set_bits_per_sample(uint16_t bits_per_sample) override;
+};
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * @file QualityMonitor.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Streaming per-channel quality control statistics written as a CSV sidecar
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef QUALITYMONITOR_H
+#define QUALITYMONITOR_H
+
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <filesystem>
+
+#include "Ads1258.h"
+
+class QualityMonitor
+{
+private:
+    uint16_t _n_channels = 0;       ///< Number of channels in each frame.
+    double _sample_rate = 0;        ///< Sampling rate of the incoming frames.
+    uint32_t _frames_per_interval = 0; ///< Number of frames per row of statistics.
+    int32_t _clip_level = 0;        ///< Raw magnitude from which a sample counts as clipped.
+
+    // one accumulator array per statistic so the per-frame update runs over contiguous memory
+    std::vector<int64_t> _sum;      ///< Sum of the samples.
+    std::vector<double> _sum_sq;    ///< Sum of the squared samples.
+    std::vector<int32_t> _min;      ///< Smallest sample.
+    std::vector<int32_t> _max;      ///< Largest sample.
+    std::vector<uint32_t> _clipped; ///< Samples at or beyond the clip level.
+    std::vector<uint32_t> _overflow; ///< Samples read with the OVF flag.
+    std::vector<uint32_t> _supply;  ///< Samples read with the SUPPLY flag.
+    std::vector<uint32_t> _gaps;    ///< Samples that were missing and had to be filled.
+
+    uint32_t _frames_in_interval = 0; ///< Frames in the current interval.
+    uint64_t _frames_total = 0;       ///< Frames received since the start time was set.
+
+    std::ofstream _output_file;                        ///< Currently open sidecar.
+    std::chrono::system_clock::time_point _start_time; ///< Timestamp of the first frame.
+
+    void reset_interval(void);
+    void write_interval(void);
+
+public:
+    QualityMonitor();
+    ~QualityMonitor();
+
+    /**
+     * @brief Allocate the accumulators.
+     *
+     * @param n_channels Number of channels in each frame.
+     * @param sample_rate Sampling rate in Hz.
+     * @param interval_seconds Time span summarized in one row.
+     * @param clip_fraction Fraction of the ADC full scale from which a sample counts as clipped.
+     */
+    void setup(uint16_t n_channels, double sample_rate, double interval_seconds = 10, double clip_fraction = 0.99);
+
+    /**
+     * @brief Set the time of the first frame, used to timestamp the rows.
+     *
+     * @param start_time Timestamp of the next frame that will be pushed.
+     */
+    void set_start_time(const std::chrono::system_clock::time_point &start_time);
+
+    /**
+     * @brief Write the pending interval and start a new sidecar file.
+     *
+     * @param file_name Path of the sidecar, usually the data file name with a .qc.csv extension.
+     */
+    void open_file(const std::filesystem::path &file_name);
+
+    /**
+     * @brief Write the pending interval and close the sidecar.
+     */
+    void close_file(void);
+
+    /**
+     * @brief Add a frame of raw ADC samples, one sample per channel.
+     *
+     * @param samples The samples of a single frame, before any filtering.
+     * @param flags STATUS flags of the frame.
+     * @param gaps Bit i is set when the sample of channel i was missing and has been filled.
+     */
+    void push_frame(const std::vector<int32_t> &samples, const FrameFlags &flags, uint32_t gaps);
+
+    /**
+     * @brief Write the statistics gathered so far as a row and start a new interval.
+     */
+    void flush(void);
+};
+
+#endif
@@ -0,0 +1,215 @@
+/**
+ * @file RecordingReader.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Memory-mapped reading of recorded WAV and archive files, with time range queries across rotated files
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef RECORDINGREADER_H
+#define RECORDINGREADER_H
+
+#include <map>
+#include <span>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+#include "ArchiveFormat.h"
+
+/**
+ * @brief Consecutive frames of a recording, pointing into the mapped file.
+ */
+struct RecordingSegment
+{
+    int64_t start_time_ns = 0;                   ///< Time of the first frame, nanoseconds since the Unix epoch.
+    uint64_t n_frames = 0;                       ///< Number of frames.
+    uint32_t gap_mask = 0;                       ///< Channels with samples that were filled in, or left at 0 in raw files.
+    bool discontinuity = false;                  ///< Whether the segment does not follow the previous segment of the file.
+    std::span<const uint8_t> data;               ///< Interleaved packed frames, valid as long as the file is open.
+    std::span<const ArchiveStatusRecord> status; ///< STATUS flags of the flagged frames of the segment.
+    uint32_t block_frame = 0;                    ///< Frame of its block the segment starts at, status frames count from the block.
+};
+
+/**
+ * @brief One recording file, mapped into memory for as long as the object lives.
+ */
+class RecordingFile
+{
+public:
+    enum class Format
+    {
+        WAV,
+        ARCHIVE
+    };
+
+private:
+    std::filesystem::path _path;
+    int _fd = -1;
+    const uint8_t *_map = nullptr;
+    size_t _size = 0;
+
+    Format _format;
+    uint16_t _n_channels = 0;
+    uint16_t _bits_per_sample = 0;
+    uint16_t _bytes_per_sample = 0;
+    double _sample_rate = 0;
+    int64_t _start_time_ns = 0;
+    uint64_t _n_frames = 0;
+    bool _raw = false;
+    bool _merged = false;
+    std::string _comment;
+
+    // WAV files
+    uint64_t _data_offset = 0;
+
+    // Archive files
+    std::vector<ArchiveIndexEntry> _index; ///< Sparse time index, every block of a file that was not closed.
+    uint64_t _blocks_end = 0;              ///< File offset after the last block.
+
+    void parse_wav(void);
+    void parse_archive(void);
+    const ArchiveBlockHeader *block_at(uint64_t offset) const;
+
+public:
+    /**
+     * @brief Map a recording file and read its format.
+     *
+     * @param path WAV or archive file, a file that was not closed is read up to its last complete frame or block.
+     */
+    explicit RecordingFile(const std::filesystem::path &path);
+    ~RecordingFile();
+
+    RecordingFile(const RecordingFile &) = delete;
+    RecordingFile &operator=(const RecordingFile &) = delete;
+
+    const std::filesystem::path &path() const { return _path; }
+    Format format() const { return _format; }
+    uint16_t n_channels() const { return _n_channels; }
+    uint16_t bits_per_sample() const { return _bits_per_sample; }
+    uint16_t bytes_per_sample() const { return _bytes_per_sample; }
+    double sample_rate() const { return _sample_rate; }
+    int64_t start_time_ns() const { return _start_time_ns; }
+    uint64_t n_frames() const { return _n_frames; }
+
+    /**
+     * @brief Whether the samples are unfiltered ADC codes, with samples the ADC did not deliver left at 0.
+     */
+    bool raw() const { return _raw; }
+
+    /**
+     * @brief Whether the channels come from several units, the gap masks then mark units instead of channels.
+     */
+    bool merged() const { return _merged; }
+
+    /**
+     * @brief Time after the last frame, from the start time and the number of frames.
+     */
+    int64_t end_time_ns() const;
+
+    /**
+     * @brief Comment of a WAV file, such as its end time, empty for archive files.
+     */
+    const std::string &comment() const { return _comment; }
+
+    /**
+     * @brief Frames between two points in time, without copying them.
+     *
+     * @param begin_ns first point in time
+     * @param end_ns point in time after the last frame
+     * @return std::vector<RecordingSegment> segments in file order, trimmed to the range
+     */
+    std::vector<RecordingSegment> segments(int64_t begin_ns, int64_t end_ns) const;
+
+    /**
+     * @brief Check the checksums of every block of an archive file.
+     *
+     * @return uint64_t number of damaged blocks, always 0 for WAV files
+     */
+    uint64_t verify(void) const;
+
+    /**
+     * @brief Unpack frames of a segment into int32 samples.
+     *
+     * @param data packed samples
+     * @param bytes_per_sample bytes of one packed sample
+     * @param out destination of data.size() / bytes_per_sample samples
+     */
+    static void unpack(std::span<const uint8_t> data, uint16_t bytes_per_sample, int32_t *out);
+};
+
+/**
+ * @brief Time range queries over a directory of rotated recording files.
+ *
+ * Files are found by the start time in their names and only opened when a query needs them.
+ */
+class RecordingReader
+{
+private:
+    std::vector<std::pair<int64_t, std::filesystem::path>> _files; ///< Start time from the name and path, sorted.
+    std::map<std::filesystem::path, std::unique_ptr<RecordingFile>> _open; ///< Files opened by earlier queries.
+
+    RecordingFile &file(const std::filesystem::path &path);
+
+public:
+    /**
+     * @brief Index the recording files of a directory by the time in their names.
+     *
+     * @param directory data path the recordings were written to
+     */
+    explicit RecordingReader(const std::filesystem::path &directory);
+
+    /**
+     * @brief Number of recording files in the directory.
+     */
+    size_t n_files() const { return _files.size(); }
+
+    /**
+     * @brief Paths of the recording files in time order, without opening them.
+     */
+    std::vector<std::filesystem::path> paths() const;
+
+    /**
+     * @brief Files that hold frames between two points in time.
+     *
+     * @param begin_ns first point in time
+     * @param end_ns point in time after the last frame
+     * @return std::vector<RecordingFile *> open files in time order
+     */
+    std::vector<RecordingFile *> files(int64_t begin_ns, int64_t end_ns);
+
+    /**
+     * @brief Frames between two points in time across files, without copying them.
+     *
+     * @param begin_ns first point in time
+     * @param end_ns point in time after the last frame
+     * @return std::vector<RecordingSegment> segments in time order
+     */
+    std::vector<RecordingSegment> query(int64_t begin_ns, int64_t end_ns);
+
+    /**
+     * @brief Unpack the frames between two points in time.
+     *
+     * @param begin_ns first point in time
+     * @param end_ns point in time after the last frame
+     * @param start_time_ns output, time of the first frame
+     * @return std::vector<int32_t> interleaved samples
+     */
+    std::vector<int32_t> read(int64_t begin_ns, int64_t end_ns, int64_t &start_time_ns);
+};
+
+/**
+ * @brief Start time encoded in the name of a recording file, in local time.
+ *
+ * @param path file named like date-2026-10-19-time-12-00-30.wav
+ * @param time_ns output, nanoseconds since the Unix epoch
+ * @return true when the name holds a time
+ */
+bool recording_name_time(const std::filesystem::path &path, int64_t &time_ns);
+
+#endif
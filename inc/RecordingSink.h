@@ -0,0 +1,71 @@
+/**
+ * @file RecordingSink.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Output that stores the processed blocks in data files of any format
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef RECORDINGSINK_H
+#define RECORDINGSINK_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "SampleSink.h"
+#include "RecordingWriter.h"
+
+class RecordingSink : public SampleSink
+{
+private:
+    std::unique_ptr<RecordingWriter> _writer;
+    std::filesystem::path _data_path;
+
+    std::filesystem::path _current_file; ///< Open data file, empty before the first block.
+    int64_t _end_time_ns = 0;            ///< Time after the last stored frame.
+
+    std::vector<uint32_t> _overflow_samples; ///< Samples per channel of the open file flagged with OVF.
+    std::vector<uint32_t> _supply_samples;   ///< Samples per channel of the open file converted with a low supply.
+
+    void set_end_time(int64_t time_ns);
+
+public:
+    /**
+     * @param writer writer of the file format, set up for the channels and sample rate
+     * @param data_path folder of the data files
+     */
+    RecordingSink(std::unique_ptr<RecordingWriter> writer, const std::filesystem::path &data_path);
+
+    const char *sink_name() const override { return "recording"; }
+
+    /**
+     * @brief Store a block, a block with a file start time first closes the open file and opens the next one.
+     */
+    void consume(const std::shared_ptr<const SampleBlock> &block) override;
+
+    /**
+     * @brief Close the open file with its end time and the number of flagged samples per channel.
+     */
+    void finish() override;
+
+    /**
+     * @brief Name of the data file that starts at a point in time.
+     *
+     * @param start_time Time of the first frame in the file.
+     * @return std::string file name without the data path
+     */
+    std::string file_name(const std::chrono::system_clock::time_point &start_time) const;
+
+    /**
+     * @brief Close and delete the open data file, only while no blocks are published.
+     */
+    void delete_last_file(void);
+};
+
+#endif
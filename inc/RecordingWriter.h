@@ -0,0 +1,140 @@
+/**
+ * @file RecordingWriter.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Common interface of the recording file formats
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef RECORDINGWRITER_H
+#define RECORDINGWRITER_H
+
+#include <span>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "AsyncFileWriter.h"
+
+class RecordingWriter
+{
+public:
+    virtual ~RecordingWriter() = default;
+
+    /**
+     * @brief Set comments or metadata for the file.
+     *
+     * @param comment The comment or metadata string to be added to the file.
+     */
+    virtual void set_comments(const std::string &comment) = 0;
+
+    /**
+     * @brief Set the datetime for the file metadata.
+     *
+     * @param datetime The timestamp to be recorded in the file.
+     */
+    virtual void set_datetime(const std::chrono::system_clock::time_point &datetime) = 0;
+
+    /**
+     * @brief Open a new file for writing.
+     *
+     * @param file_name The name of the file to be created and written to.
+     */
+    virtual void open_file(const std::string &file_name) = 0;
+
+    /**
+     * @brief Close the currently open file, without waiting for storage.
+     */
+    virtual void close_file() = 0;
+
+    /**
+     * @brief Create the next file ahead of time, for formats where opening blocks.
+     *
+     * @param file_name The name of the file that will be opened next.
+     */
+    virtual void prepare_file(const std::string &file_name) {}
+
+    /**
+     * @brief Wait until everything queued so far has been written.
+     */
+    virtual void flush() = 0;
+
+    /**
+     * @brief Get the write completion latency since the previous call.
+     *
+     * @return WriteLatency latency statistics of the storage thread
+     */
+    virtual WriteLatency take_write_latency() = 0;
+
+    /**
+     * @brief Write a block of interleaved frames.
+     *
+     * @param interleaved Samples ordered frame after frame, n_channels samples per frame.
+     * @param n_frames Number of frames to write from the start of interleaved.
+     */
+    virtual void write_frames(std::span<const int32_t> interleaved, size_t n_frames) = 0;
+
+    /**
+     * @brief Mark channels of the frames in the next write_frames call whose samples were filled in.
+     *
+     * @param channel_mask Bit i is set when channel i has a filled in sample.
+     */
+    virtual void mark_gaps(uint32_t channel_mask) {}
+
+    /**
+     * @brief Record the STATUS flags of a frame in the next write_frames call, formats without room for them drop them.
+     *
+     * @param frame Frame of the next write_frames call, counted from its first frame.
+     * @param overflow Bit i is set when the input of channel i exceeded the range of the ADC.
+     * @param supply Bit i is set when the analog supply was low while channel i was converted.
+     */
+    virtual void mark_status(uint32_t frame, uint32_t overflow, uint32_t supply) {}
+
+    /**
+     * @brief Periodically make the data written so far durable and readable.
+     *
+     * @param frames Number of frames between commits, 0 disables them.
+     */
+    virtual void set_commit_interval(uint64_t frames) {}
+
+    /**
+     * @brief Set the number of channels.
+     *
+     * @param num_channels The number of channels.
+     */
+    virtual void set_n_channels(uint16_t num_channels) = 0;
+
+    /**
+     * @brief Set the sample rate.
+     *
+     * @param sample_rate The sample rate in Hz.
+     */
+    virtual void set_sample_rate(uint32_t sample_rate) = 0;
+
+    /**
+     * @brief Set the number of bits per sample.
+     *
+     * @param bits_per_sample The number of bits in each sample.
+     */
+    virtual void set_bits_per_sample(uint16_t bits_per_sample) = 0;
+
+    /**
+     * @brief File name extension of the format, including the dot.
+     *
+     * @return std::string extension such as ".wav"
+     */
+    virtual std::string extension() const = 0;
+
+    /**
+     * @brief Files written for a file name, formats that split the channels over files write more than one.
+     *
+     * @param file_name The name given to open_file.
+     * @return std::vector<std::string> names of the files
+     */
+    virtual std::vector<std::string> file_names(const std::string &file_name) const { return {file_name}; }
+};
+
+#endif
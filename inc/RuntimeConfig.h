@@ -0,0 +1,104 @@
+/**
+ * @file RuntimeConfig.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Settings of the acquisition that can be changed while it runs
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef RUNTIMECONFIG_H
+#define RUNTIMECONFIG_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+
+#include "StreamServer.h"
+#include "AcquisitionPlan.h"
+#include "ShmRingLayout.h"
+#include "CrossCorrelator.h"
+#include "utils/ResponseExtension.h"
+
+constexpr std::chrono::seconds FILE_DURATION{30}; ///< Default length of a data file, files start on wall-clock multiples of the length.
+constexpr double SAMPLE_RATE = 1970;              ///< Default lowest sample rate per channel, about 2 kHz for 1 up to 4 geophones.
+
+/**
+ * @brief Settings of the PSD tiles.
+ */
+struct SpectrumSettings
+{
+    uint32_t fft_size = 4096;  ///< Length of each FFT window, a power of two.
+    double tile_seconds = 60;  ///< Time span averaged into one tile.
+
+    bool operator==(const SpectrumSettings &) const = default;
+};
+
+/**
+ * @brief Settings of the stacked cross-correlations.
+ */
+struct CorrelationSettings
+{
+    std::vector<ChannelPair> pairs; ///< Pairs of channel indices, 0 is the first active channel.
+    uint32_t window = 4096;         ///< Length of each correlated window in samples, a power of two.
+    double max_lag_seconds = 1.0;   ///< Largest lag that is stored.
+    double stack_seconds = 3600;    ///< Time span stacked into one file.
+
+    bool operator==(const CorrelationSettings &) const = default;
+};
+
+/**
+ * @brief Settings of the live TCP stream.
+ */
+struct StreamSettings
+{
+    uint16_t port = STREAM_DEFAULT_PORT;                                        ///< TCP port to listen on.
+    size_t ring_blocks = 16;                                                    ///< Blocks that can wait for each client.
+    StreamServer::SlowClientPolicy policy = StreamServer::SlowClientPolicy::SKIP; ///< What happens to a client that falls behind.
+
+    bool operator==(const StreamSettings &) const = default;
+};
+
+/**
+ * @brief Settings of the shared memory ring.
+ */
+struct SharedMemorySettings
+{
+    std::string name = SHM_RING_DEFAULT_NAME; ///< Name of the shared memory object.
+    double seconds = 10;                      ///< Length of the ring, how far a reader can fall behind.
+
+    bool operator==(const SharedMemorySettings &) const = default;
+};
+
+/**
+ * @brief Everything that can be changed without restarting the program, an empty optional disables its output.
+ *
+ * The file format and the way files are written are not part of it, they are fixed for the lifetime of the program.
+ */
+struct RuntimeConfig
+{
+    std::filesystem::path data_path = "drongo_data";     ///< Folder of the data files.
+    uint32_t n_channels = 4;                             ///< Number of connected geophones.
+    std::optional<ScanChannels> channels;                ///< ADC channels to scan, empty scans the inputs of the geophones.
+    double sample_rate = 0;                              ///< Lowest sample rate per channel the ADC settings have to reach, 0 for SAMPLE_RATE or the highest rate of the channels when that is lower.
+    PlanGoal rate_goal = PlanGoal::MIN_POWER;            ///< How the ADC settings are chosen among those that reach it.
+    std::chrono::seconds file_duration = FILE_DURATION;  ///< Length of a data file.
+
+    double lowpass_frequency = 450;                          ///< Cut-off of the low-pass in Hz, 0 disables it.
+    std::optional<ResponseExtensionConfig> response_extension; ///< Extension of the geophone response.
+
+    std::optional<double> qc_interval;                 ///< Time span of a quality control row in seconds.
+    std::optional<SpectrumSettings> spectrum;          ///< PSD tiles.
+    std::optional<CorrelationSettings> correlation;    ///< Stacked cross-correlations.
+    std::optional<StreamSettings> stream;              ///< Live TCP stream.
+    std::optional<SharedMemorySettings> shared_memory; ///< Shared memory ring for local programs.
+
+    bool operator==(const RuntimeConfig &) const = default;
+};
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * @file SampleBlock.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Block of processed frames as handed from the pipeline to its outputs
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SAMPLEBLOCK_H
+#define SAMPLEBLOCK_H
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief STATUS flags of a frame the ADC flagged.
+ */
+struct FrameStatus
+{
+    uint32_t frame;    ///< Frame in the block, counted from its first frame.
+    uint32_t overflow; ///< Channels whose input exceeded the range of the ADC.
+    uint32_t supply;   ///< Channels whose analog supply was low.
+};
+
+/**
+ * @brief Interleaved frames with their timing, never changed once published so outputs can share it.
+ */
+struct SampleBlock
+{
+    uint64_t sequence = 0;        ///< Number of the block since the pipeline started.
+    int64_t start_time_ns = 0;    ///< Time of the first frame, nanoseconds since the Unix epoch.
+    uint64_t first_sample = 0;    ///< Index of the first frame since the pipeline started.
+    double sample_rate = 0;       ///< Frames per second.
+    uint16_t n_channels = 0;      ///< Samples per frame.
+    uint32_t gap_mask = 0;        ///< Channels with samples that were filled in.
+    std::vector<int32_t> samples; ///< Interleaved samples, n_channels per frame.
+    std::vector<FrameStatus> status; ///< Flags of the frames the ADC flagged, in order.
+    int64_t file_start_ns = 0;    ///< When not 0 the block starts a new data file, which begins at this time.
+    int64_t next_file_start_ns = 0; ///< Start of the data file after that one, set together with file_start_ns.
+
+    uint32_t n_frames() const { return n_channels ? samples.size() / n_channels : 0; }
+};
+
+#endif
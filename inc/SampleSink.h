@@ -0,0 +1,42 @@
+/**
+ * @file SampleSink.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Common interface of the outputs that receive the processed blocks
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SAMPLESINK_H
+#define SAMPLESINK_H
+
+#include <memory>
+
+#include "SampleBlock.h"
+
+class SampleSink
+{
+public:
+    virtual ~SampleSink() = default;
+
+    /**
+     * @brief Name of the output, for the log.
+     */
+    virtual const char *sink_name() const = 0;
+
+    /**
+     * @brief Handle the next block, called in order on the thread of the sink.
+     *
+     * @param block block shared with the other sinks, it never changes and can be kept as long as needed
+     */
+    virtual void consume(const std::shared_ptr<const SampleBlock> &block) = 0;
+
+    /**
+     * @brief Called on the thread of the sink after the last block, to close files or connections.
+     */
+    virtual void finish() {}
+};
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * @file ShmRingLayout.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Layout of the shared memory ring with the live frames
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The shared memory object starts with a ShmRingHeader, followed at data_offset by capacity_frames frames of
+ * n_channels int32 samples. Frames are numbered from the creation of the ring and frame n lives in slot
+ * n % capacity_frames. The writer announces the frames it is about to overwrite in write_begin, copies them and
+ * then publishes them in write_end, so a reader knows its frames were not overwritten while it read them when
+ * write_begin has not passed them by more than the capacity afterwards.
+ *
+ * The stream description (sample rate, start time) is guarded by a sequence counter that is odd while it changes.
+ *
+ */
+
+#ifndef SHMRINGLAYOUT_H
+#define SHMRINGLAYOUT_H
+
+#include <atomic>
+#include <cstdint>
+
+constexpr uint32_t SHM_RING_MAGIC = 0x53475252; // "RRGS"
+constexpr uint32_t SHM_RING_VERSION = 1;
+constexpr const char *SHM_RING_DEFAULT_NAME = "/drongo";
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<double>::is_always_lock_free,
+              "the ring is shared between processes, its atomics must not need a lock");
+
+struct ShmRingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity_frames;
+    uint32_t n_channels;
+    uint32_t data_offset; ///< Bytes from the start of the object to the first frame.
+
+    // description of the current stream, guarded by sequence
+    alignas(64) std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> generation;     ///< Number of the stream, changes every time the writer starts a new one.
+    std::atomic<uint64_t> first_frame;    ///< Frame number of the first frame of the stream.
+    std::atomic<int64_t> start_time_ns;   ///< Time of that frame, nanoseconds since the Unix epoch.
+    std::atomic<double> sample_rate;      ///< Frames per second.
+
+    // kept on cache lines of their own, the writer changes them for every block
+    alignas(64) std::atomic<uint64_t> write_begin; ///< Frames that are written or being written.
+    alignas(64) std::atomic<uint64_t> write_end;   ///< Frames that can be read.
+    std::atomic<uint32_t> closed;                  ///< Set when the writer stopped, readers have to open the ring again.
+};
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ * @file ShmRingReader.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Follows the live frames in the shared memory ring without copying them
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SHMRINGREADER_H
+#define SHMRINGREADER_H
+
+#include <span>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+#include "ShmRingLayout.h"
+
+/**
+ * @brief Description of the stream in the ring.
+ */
+struct ShmStreamInfo
+{
+    uint32_t generation = 0; ///< Changes when the writer starts a new stream.
+    uint64_t first_frame = 0;
+    int64_t start_time_ns = 0;
+    double sample_rate = 0;
+    uint16_t n_channels = 0;
+
+    /**
+     * @brief Time of a frame of this stream, nanoseconds since the Unix epoch.
+     */
+    int64_t frame_time_ns(uint64_t frame) const
+    {
+        return start_time_ns + static_cast<int64_t>((static_cast<double>(frame) - static_cast<double>(first_frame)) * 1e9 / sample_rate);
+    }
+};
+
+/**
+ * @brief Frames that can be read straight from the ring, in at most two parts because the ring wraps.
+ */
+struct ShmRingView
+{
+    uint64_t first_frame = 0;
+    uint32_t n_frames = 0;
+    std::span<const int32_t> parts[2]; ///< Interleaved samples, the second part continues the first.
+};
+
+class ShmRingReader
+{
+private:
+    std::string _name;
+    const ShmRingHeader *_header = nullptr;
+    const int32_t *_data = nullptr;
+    size_t _size = 0;
+
+    uint64_t _position = 0;
+    uint64_t _lost = 0;
+
+public:
+    /**
+     * @brief Map the ring read-only and start at its newest frame.
+     *
+     * @param name name of the shared memory object
+     * @throws std::system_error when there is no ring, std::runtime_error when it is not a Drongo ring
+     */
+    ShmRingReader(const std::string &name = SHM_RING_DEFAULT_NAME);
+    ~ShmRingReader();
+
+    ShmRingReader(const ShmRingReader &) = delete;
+    ShmRingReader &operator=(const ShmRingReader &) = delete;
+
+    /**
+     * @brief Current description of the stream.
+     */
+    ShmStreamInfo info(void) const;
+
+    uint16_t n_channels(void) const { return _header->n_channels; }
+    uint64_t capacity(void) const { return _header->capacity_frames; }
+
+    /**
+     * @brief True when the writer stopped, the ring has to be opened again to follow a new run.
+     */
+    bool closed(void) const { return _header->closed.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Number of the next frame to read.
+     */
+    uint64_t position(void) const { return _position; }
+
+    /**
+     * @brief Go back to the oldest frame still in the ring.
+     */
+    void rewind(void);
+
+    /**
+     * @brief Frames that were overwritten before they were read.
+     */
+    uint64_t lost(void) const { return _lost; }
+
+    /**
+     * @brief Frames published but not read yet.
+     */
+    uint64_t available(void) const { return _header->write_end.load(std::memory_order_acquire) - _position; }
+
+    /**
+     * @brief Wait until there are frames to read, by polling so readers never slow down the writer.
+     *
+     * @param timeout longest time to wait
+     * @param interval time between two looks at the ring
+     * @return true when frames are available
+     */
+    bool wait(std::chrono::milliseconds timeout, std::chrono::microseconds interval = std::chrono::microseconds(1000)) const;
+
+    /**
+     * @brief Look at the next frames without copying them. Frames that were already overwritten are skipped
+     * and counted as lost.
+     *
+     * @param max_frames largest number of frames in the view
+     * @return frames that can be read, empty when there are none
+     */
+    ShmRingView peek(uint32_t max_frames = UINT32_MAX);
+
+    /**
+     * @brief Finish reading a view and move past it.
+     *
+     * @param view view returned by peek()
+     * @return true when the writer did not overwrite the frames while they were read, otherwise whatever was
+     *         computed from them has to be thrown away
+     */
+    bool consume(const ShmRingView &view);
+};
+
+#endif
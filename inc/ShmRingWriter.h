@@ -0,0 +1,77 @@
+/**
+ * @file ShmRingWriter.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Publishes the live frames in a shared memory ring for processes on the unit itself
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SHMRINGWRITER_H
+#define SHMRINGWRITER_H
+
+#include <span>
+#include <string>
+#include <cstdint>
+
+#include "SampleSink.h"
+#include "ShmRingLayout.h"
+
+class ShmRingWriter : public SampleSink
+{
+private:
+    std::string _name;
+    ShmRingHeader *_header = nullptr;
+    int32_t *_data = nullptr;
+    size_t _size = 0;
+
+public:
+    /**
+     * @param name name of the shared memory object, starting with a slash
+     */
+    ShmRingWriter(const std::string &name = SHM_RING_DEFAULT_NAME);
+    ~ShmRingWriter();
+
+    ShmRingWriter(const ShmRingWriter &) = delete;
+    ShmRingWriter &operator=(const ShmRingWriter &) = delete;
+
+    /**
+     * @brief Create the ring, replacing one left behind by an earlier run.
+     *
+     * @param n_channels samples per frame
+     * @param capacity_frames frames the ring holds, how far a reader can fall behind
+     * @throws std::system_error when the shared memory cannot be created
+     */
+    void open(uint16_t n_channels, uint64_t capacity_frames);
+
+    /**
+     * @brief Mark the ring closed for its readers and remove it.
+     */
+    void close(void);
+
+    /**
+     * @brief Start a new stream, the frames written from now on belong to it.
+     *
+     * @param sample_rate frames per second
+     * @param start_time_ns time of the next frame written, nanoseconds since the Unix epoch
+     */
+    void start_stream(double sample_rate, int64_t start_time_ns);
+
+    /**
+     * @brief Copy frames into the ring and publish them, without waiting for readers.
+     *
+     * @param frames interleaved samples
+     * @param n_frames number of frames
+     */
+    void write(std::span<const int32_t> frames, uint32_t n_frames);
+
+    bool is_open(void) const { return _header; }
+
+    const char *sink_name() const override { return "shared memory"; }
+    void consume(const std::shared_ptr<const SampleBlock> &block) override { write(block->samples, block->n_frames()); }
+    void finish() override { close(); }
+};
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @file SignalProcessor.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief The DSP stages applied to recorded frames: gap filling, low-pass filtering, response extension and decimation
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SIGNALPROCESSOR_H
+#define SIGNALPROCESSOR_H
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include "Iir.h"
+#include "utils/DirectForm2Neon.h"
+#include "utils/ResponseExtension.h"
+
+/**
+ * @brief Settings of the processing stages.
+ */
+struct SignalProcessorConfig
+{
+    double lowpass_frequency = 450;     ///< Cut-off of the 20th order Chebyshev II low-pass in Hz, 0 disables it.
+    double lowpass_stopband_db = 60;    ///< Stop band attenuation of the low-pass.
+    bool fill_gaps = true;              ///< Whether samples of 0, which the ADC did not deliver, are interpolated.
+    bool response_extension = false;    ///< Whether the geophone response is extended.
+    ResponseExtensionConfig response;   ///< Geophone and target response parameters.
+    uint32_t decimation = 1;            ///< Only every decimation-th frame is kept.
+};
+
+class SignalProcessor
+{
+private:
+    uint16_t _n_channels = 0;
+    double _sample_rate = 0;
+    SignalProcessorConfig _config;
+
+    std::vector<Iir::ChebyshevII::LowPass<20, Iir::DirectFormIINeon>> _lowpass;
+    std::vector<ResponseExtensionFilter> _responses;
+
+    std::vector<int32_t> _previous; ///< Last frame after gap filling.
+    std::vector<int32_t> _pending;  ///< Frame waiting for its successor, used by process.
+    bool _has_pending = false;
+    uint64_t _phase = 0; ///< Frames until the next kept frame.
+
+public:
+    /**
+     * @brief Set up the filters, their state is cleared.
+     *
+     * @param n_channels number of channels in each frame
+     * @param sample_rate sample rate of the incoming frames
+     * @param config settings of the stages
+     */
+    void setup(uint16_t n_channels, double sample_rate, const SignalProcessorConfig &config = {});
+
+    /**
+     * @brief Clear the filter state and the frames kept for gap filling.
+     */
+    void reset(void);
+
+    /**
+     * @brief Skip frames before the first kept frame, to keep decimated frames aligned over several files.
+     *
+     * @param frames number of incoming frames until the next kept frame
+     */
+    void set_decimation_phase(uint64_t frames);
+
+    /**
+     * @brief Sample rate of the frames that are kept.
+     */
+    double output_rate(void) const { return _sample_rate / _config.decimation; }
+
+    /**
+     * @brief Interpolate samples of 0 between the previous frame and the next frame.
+     *
+     * @param frame frame to fill, in place
+     * @param next the following frame
+     * @return uint32_t bit i is set when channel i was filled
+     */
+    uint32_t fill_gaps(std::span<int32_t> frame, std::span<const int32_t> next);
+
+    /**
+     * @brief Run a frame through the low-pass and response extension, in place.
+     *
+     * @param frame frame to filter
+     */
+    void filter(std::span<int32_t> frame);
+
+    /**
+     * @brief Count a filtered frame for decimation.
+     *
+     * @return true when the frame is kept
+     */
+    bool keep(void);
+
+    /**
+     * @brief Run every stage over interleaved frames, the last frame is held back until its successor arrives.
+     *
+     * @param frames interleaved frames
+     * @param n_frames number of frames
+     * @param out kept frames are appended here
+     * @return uint32_t channels that had filled in samples
+     */
+    uint32_t process(std::span<const int32_t> frames, size_t n_frames, std::vector<int32_t> &out);
+
+    /**
+     * @brief Process the held back frame at the end of the data.
+     *
+     * @param out the frame is appended here when it is kept
+     * @return uint32_t channels that had filled in samples
+     */
+    uint32_t flush(std::vector<int32_t> &out);
+};
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @file SinkFanout.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Hands every processed block to several outputs, each on a thread of its own
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SINKFANOUT_H
+#define SINKFANOUT_H
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+#include "SampleSink.h"
+
+/**
+ * @brief How many blocks may wait for a sink and what happens when more arrive.
+ */
+struct SinkOptions
+{
+    enum class Overflow
+    {
+        WAIT,       ///< Publishing waits until the sink has room, for outputs that must not lose data.
+        DROP_OLDEST ///< The oldest waiting block is dropped, for outputs that must never hold up acquisition.
+    };
+
+    size_t max_backlog = 16;
+    Overflow overflow = Overflow::DROP_OLDEST;
+};
+
+class SinkFanout
+{
+private:
+    struct Worker
+    {
+        SampleSink *sink;
+        SinkOptions options;
+
+        std::mutex mtx;
+        std::condition_variable cv_data;  ///< Signals the sink thread that a block arrived or the fan-out stops.
+        std::condition_variable cv_space; ///< Signals a waiting publisher that the sink took a block.
+        std::deque<std::shared_ptr<const SampleBlock>> queue;
+        bool stopping = false;
+
+        uint64_t dropped = 0;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    bool _running = false;
+
+    static void run(Worker &worker);
+    static void stop_worker(Worker &worker);
+
+public:
+    SinkFanout() = default;
+    ~SinkFanout();
+
+    SinkFanout(const SinkFanout &) = delete;
+    SinkFanout &operator=(const SinkFanout &) = delete;
+
+    /**
+     * @brief Add an output, the fan-out does not own it. Once started the output gets the blocks published after this.
+     */
+    void add(SampleSink &sink, SinkOptions options = {});
+
+    /**
+     * @brief Let an output handle its waiting blocks, call finish() on it and remove it.
+     *
+     * Like publish(), only to be called from the thread that publishes.
+     */
+    void remove(SampleSink &sink);
+
+    /**
+     * @brief Remove all outputs, only while stopped.
+     */
+    void clear(void);
+
+    size_t size(void) const { return _workers.size(); }
+
+    /**
+     * @brief Start a thread for every output.
+     */
+    void start(void);
+
+    /**
+     * @brief Hand a block to every output, the block itself is shared and never copied.
+     */
+    void publish(std::shared_ptr<const SampleBlock> block);
+
+    /**
+     * @brief Let every output handle its waiting blocks, call finish() on it and join its thread.
+     */
+    void stop(void);
+};
+
+#endif
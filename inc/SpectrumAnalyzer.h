@@ -0,0 +1,152 @@
+/**
+ * @file SpectrumAnalyzer.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Streaming Welch PSD estimation that writes averaged spectrum tiles as sidecar files
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <span>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+
+#include <fftw3.h>
+
+#include "SampleSink.h"
+#include "utils/SampleRing.h"
+
+/**
+ * @brief Magic bytes at the start of every PSD tile file.
+ */
+constexpr char PSD_TILE_MAGIC[4] = {'D', 'P', 'S', 'D'};
+
+/**
+ * @brief Version of the PSD tile layout.
+ */
+constexpr uint16_t PSD_TILE_VERSION = 1;
+
+/**
+ * @brief Header of a PSD tile file, followed by n_channels * n_bins float32 PSD values in V^2/Hz.
+ *
+ * Values are stored channel after channel, bin k is at frequency k * sample_rate / fft_size.
+ * All fields are little endian.
+ */
+struct __attribute__((packed)) PsdTileHeader
+{
+    char magic[4];           ///< PSD_TILE_MAGIC.
+    uint16_t version;        ///< PSD_TILE_VERSION.
+    uint16_t n_channels;     ///< Number of channels in the tile.
+    uint32_t fft_size;       ///< Length of each FFT window.
+    uint32_t n_bins;         ///< Number of one-sided frequency bins (fft_size / 2 + 1).
+    uint32_t n_averages;     ///< Number of windows averaged into this tile.
+    double sample_rate;      ///< Sample rate of the analysed data in Hz.
+    int64_t start_time_ns;   ///< Time of the first sample of the tile, nanoseconds since the unix epoch.
+    double duration_s;       ///< Time span covered by the tile in seconds.
+};
+
+class SpectrumAnalyzer : public SampleSink
+{
+private:
+    uint16_t _n_channels = 0; ///< Number of channels in each frame.
+    double _sample_rate = 0;  ///< Sampling rate of the incoming frames.
+
+    uint32_t _fft_size = 0;   ///< Length of each FFT window.
+    uint32_t _n_bins = 0;     ///< Number of one-sided frequency bins.
+    uint32_t _hop_size = 0;   ///< Number of frames between consecutive windows.
+    uint32_t _frames_per_tile = 0; ///< Number of frames per PSD tile.
+
+    std::vector<SampleRing<double>> _rings; ///< Sliding window history per channel.
+    std::vector<double> _window;            ///< Hann window coefficients.
+    double _psd_scale = 0;                  ///< Scale from |X|^2 to one-sided V^2/Hz.
+
+    double *_fft_in = nullptr;        ///< FFTW aligned input buffer, shared by all channels.
+    fftw_complex *_fft_out = nullptr; ///< FFTW aligned output buffer, shared by all channels.
+    fftw_plan _plan = nullptr;        ///< Forward real FFT plan, created once.
+
+    std::vector<double> _accumulator; ///< Summed |X|^2 per channel and bin.
+    uint32_t _n_averages = 0;         ///< Number of windows in the accumulator.
+
+    uint32_t _frames_since_window = 0; ///< Frames received since the last window was processed.
+    uint32_t _frames_in_tile = 0;      ///< Frames received in the current tile.
+    uint64_t _frames_total = 0;        ///< Frames received since the start time was set.
+
+    bool _sequence_known = false; ///< Whether a block was consumed since the start time was set.
+    uint64_t _next_sequence = 0;  ///< Sequence of the block that follows the last consumed one.
+    uint64_t _next_sample = 0;    ///< First frame of the block that follows the last consumed one.
+
+    std::filesystem::path _output_path;                      ///< Directory for the tile files.
+    std::chrono::system_clock::time_point _start_time;       ///< Timestamp of the first frame.
+
+    void release_plan(void);
+    void process_window(void);
+    void write_tile(void);
+    void skip_gap(uint64_t missed_blocks, uint64_t missed_frames);
+
+public:
+    SpectrumAnalyzer();
+    ~SpectrumAnalyzer();
+
+    SpectrumAnalyzer(const SpectrumAnalyzer &) = delete;
+    SpectrumAnalyzer &operator=(const SpectrumAnalyzer &) = delete;
+
+    /**
+     * @brief Allocate buffers and create the FFT plan.
+     *
+     * @param n_channels Number of channels in each frame.
+     * @param sample_rate Sampling rate in Hz.
+     * @param fft_size Length of each FFT window.
+     * @param overlap Fraction of overlap between consecutive windows, 0 <= overlap < 1.
+     * @param tile_seconds Time span that is averaged into a single tile.
+     */
+    void setup(uint16_t n_channels, double sample_rate, uint32_t fft_size = 4096, double overlap = 0.5, double tile_seconds = 60);
+
+    /**
+     * @brief Set the directory where tiles are written.
+     *
+     * @param path Filesystem path for the tile files.
+     */
+    void set_output_path(const std::filesystem::path &path);
+
+    /**
+     * @brief Set the time of the first frame, used to timestamp the tiles.
+     *
+     * @param start_time Timestamp of the next frame that will be pushed.
+     */
+    void set_start_time(const std::chrono::system_clock::time_point &start_time);
+
+    /**
+     * @brief Add a frame of raw ADC samples, one sample per channel.
+     *
+     * @param samples The samples of a single frame.
+     */
+    void push_frame(std::span<const int32_t> samples);
+
+    const char *sink_name() const override { return "spectrum"; }
+
+    /**
+     * @brief Add every frame of a processed block.
+     *
+     * Blocks the fan-out dropped show up as a jump in the sequence, the current tile is then written
+     * and the windows start again after the gap so no window spans it.
+     */
+    void consume(const std::shared_ptr<const SampleBlock> &block) override;
+
+    /**
+     * @brief Write the last tile.
+     */
+    void finish() override { flush(); }
+
+    /**
+     * @brief Write the current tile if it contains any averages.
+     */
+    void flush(void);
+};
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * @file StreamAggregator.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Merges the live streams of several units onto one time grid
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef STREAMAGGREGATOR_H
+#define STREAMAGGREGATOR_H
+
+#include <span>
+#include <cmath>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "StreamProtocol.h"
+
+/**
+ * @brief Counters of the merge, for the log.
+ */
+struct AggregatorStats
+{
+    uint64_t frames = 0;         ///< Merged frames handed out.
+    uint64_t missing_frames = 0; ///< Merged frames with at least one unit missing.
+    uint64_t late_frames = 0;    ///< Frames of a unit that arrived after their merged frame was handed out.
+    uint64_t early_frames = 0;   ///< Frames of a unit too far ahead of the others to be buffered.
+    uint64_t rejected_blocks = 0; ///< Blocks with another channel count or sample rate.
+};
+
+class StreamAggregator
+{
+public:
+    static constexpr size_t MAX_UNITS = 32; ///< One bit of the missing mask for every unit.
+
+    /**
+     * @brief Receives merged frames in order, every frame of a call has the same units missing.
+     *
+     * @param frames interleaved samples of all units, units after each other within a frame, 0 for missing units
+     * @param n_frames number of frames
+     * @param first_frame number of the first frame on the merged grid
+     * @param start_time_ns time of the first frame, nanoseconds since the Unix epoch
+     * @param missing_mask bit u is set when unit u has no data for these frames
+     */
+    using Output = std::function<void(std::span<const int32_t> frames, uint32_t n_frames, uint64_t first_frame, int64_t start_time_ns, uint32_t missing_mask)>;
+
+private:
+    struct Unit
+    {
+        uint32_t channel_offset = 0;
+        bool online = false;
+        bool has_data = false;
+        uint64_t next_sequence = 0;
+        int64_t expected_frame = 0; ///< Merged frame after the last block of the unit.
+    };
+
+    std::mutex _mtx;
+
+    std::vector<Unit> _units;
+    uint16_t _channels_per_unit;
+    uint32_t _frame_size;
+    double _max_delay;
+
+    // time grid, fixed by the first block
+    double _sample_rate = 0;
+    int64_t _start_time_ns = 0;
+
+    // frames that are not handed out yet, frame f lives in slot f % _capacity
+    std::vector<int32_t> _frames;
+    std::vector<uint32_t> _present; ///< Units with data in a slot.
+    uint64_t _capacity = 0;
+    uint64_t _next_frame = 0;   ///< First frame that is not handed out yet.
+    uint64_t _newest_frame = 0; ///< Frame after the newest buffered frame of any unit.
+
+    AggregatorStats _stats;
+
+    void setup_grid(const StreamBlockHeader &header);
+    int64_t frame_time_ns(uint64_t frame) const { return _start_time_ns + std::llround(frame * 1e9 / _sample_rate); }
+
+public:
+    /**
+     * @param n_units number of units, at most MAX_UNITS
+     * @param channels_per_unit channels every unit streams
+     * @param max_delay seconds a merged frame waits for units that are online but behind
+     * @throws std::invalid_argument when there are too many units
+     */
+    StreamAggregator(size_t n_units, uint16_t channels_per_unit, double max_delay = 5.0);
+
+    size_t n_units(void) const { return _units.size(); }
+    uint32_t n_channels(void) const { return _frame_size; }
+
+    /**
+     * @brief Sample rate of the grid, 0 until the first block arrived.
+     */
+    double sample_rate(void);
+
+    /**
+     * @brief Mark a unit as connected or not, merged frames do not wait for units that are offline.
+     */
+    void set_online(size_t unit, bool online);
+
+    /**
+     * @brief Place a block of a unit on the grid, the samples are copied into the merge buffer.
+     *
+     * @param unit number of the unit
+     * @param header header of the block
+     * @param samples interleaved samples of the block
+     * @return false when the block does not match the grid and was dropped
+     */
+    bool push(size_t unit, const StreamBlockHeader &header, std::span<const int32_t> samples);
+
+    /**
+     * @brief Hand out the merged frames that every online unit has delivered, and the frames that waited
+     * longer than max_delay for the others.
+     *
+     * @param now_ns current time, nanoseconds since the Unix epoch
+     * @param output receives the frames
+     * @param all hand out every buffered frame, when stopping
+     */
+    void drain(int64_t now_ns, const Output &output, bool all = false);
+
+    AggregatorStats take_stats(void);
+};
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ * @file StreamClient.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Receiving end of the live sample stream of a unit
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef STREAMCLIENT_H
+#define STREAMCLIENT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "StreamProtocol.h"
+
+class StreamClient
+{
+private:
+    int _fd = -1;
+    std::string _name;
+
+    bool receive_all(void *data, size_t size);
+
+public:
+    /**
+     * @brief Connect to the stream server of a unit.
+     *
+     * @param host name or address of the unit
+     * @param port port of the stream server
+     */
+    StreamClient(const std::string &host, uint16_t port = STREAM_DEFAULT_PORT);
+    ~StreamClient();
+
+    StreamClient(const StreamClient &) = delete;
+    StreamClient &operator=(const StreamClient &) = delete;
+
+    /**
+     * @brief Socket of the connection, to wait for several units at once.
+     */
+    int fd(void) const { return _fd; }
+
+    /**
+     * @brief Host and port the client is connected to.
+     */
+    const std::string &name(void) const { return _name; }
+
+    /**
+     * @brief Wait for the next block.
+     *
+     * @param header output, header of the block
+     * @param samples output, interleaved samples, resized to the block and reused between calls
+     * @return true when a block was received, false when the unit closed the connection
+     */
+    bool receive(StreamBlockHeader &header, std::vector<int32_t> &samples);
+};
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file StreamProtocol.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Layout of the live sample stream sent over TCP
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The stream is a sequence of blocks, each a header followed by n_frames * n_channels little endian int32
+ * samples, interleaved frame after frame. Blocks are numbered, a client that was too slow sees a jump in the
+ * sequence numbers and the first sample of the next block it gets.
+ *
+ */
+
+#ifndef STREAMPROTOCOL_H
+#define STREAMPROTOCOL_H
+
+#include <cstdint>
+
+#include "SampleBlock.h"
+
+constexpr uint32_t STREAM_MAGIC = 0x53475244; // "DRGS"
+constexpr uint16_t STREAM_VERSION = 1;
+constexpr uint16_t STREAM_DEFAULT_PORT = 7600;
+
+/**
+ * @brief Start of every block of the stream.
+ */
+struct StreamBlockHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t n_channels;
+    uint64_t sequence;     ///< Number of the block since the unit started streaming.
+    int64_t start_time_ns; ///< Time of the first frame, nanoseconds since the Unix epoch.
+    uint64_t first_sample; ///< Index of the first frame since the unit started streaming.
+    double sample_rate;
+    uint32_t n_frames;
+    uint32_t gap_mask; ///< Channels with samples that were filled in.
+};
+
+static_assert(sizeof(StreamBlockHeader) == 48);
+
+/**
+ * @brief Header of a block on the stream.
+ */
+inline StreamBlockHeader stream_header(const SampleBlock &block)
+{
+    return {.magic = STREAM_MAGIC,
+            .version = STREAM_VERSION,
+            .n_channels = block.n_channels,
+            .sequence = block.sequence,
+            .start_time_ns = block.start_time_ns,
+            .first_sample = block.first_sample,
+            .sample_rate = block.sample_rate,
+            .n_frames = block.n_frames(),
+            .gap_mask = block.gap_mask};
+}
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * @file StreamServer.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief TCP server that streams processed sample blocks live to any number of clients
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef STREAMSERVER_H
+#define STREAMSERVER_H
+
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "SampleSink.h"
+#include "StreamProtocol.h"
+
+/**
+ * @brief Sends every published block to all connected clients from a single network thread.
+ *
+ * Every client has its own ring of blocks waiting to be sent. The rings hold shared pointers, so a block is
+ * stored once however many clients there are and its samples are sent straight from it. Publishing never
+ * waits for the network: when the ring of a client is full the client is handled by the slow client policy.
+ */
+class StreamServer : public SampleSink
+{
+public:
+    enum class SlowClientPolicy
+    {
+        SKIP,      ///< Drop the oldest waiting block, the client continues with newer data.
+        DISCONNECT ///< Close the connection, the client can reconnect and continues with new data.
+    };
+
+private:
+    struct Client
+    {
+        int fd = -1;
+        std::string peer;
+
+        // ring of waiting blocks, guarded by _clients_mtx
+        std::vector<std::shared_ptr<const SampleBlock>> ring;
+        size_t head = 0;
+        size_t count = 0;
+        std::atomic<uint64_t> skipped = 0;
+        std::atomic_bool too_slow = false;
+
+        // block being sent, only used by the network thread
+        std::shared_ptr<const SampleBlock> sending;
+        StreamBlockHeader header;
+        size_t sent = 0;
+        uint64_t reported_skips = 0;
+        std::chrono::steady_clock::time_point report_time{};
+    };
+
+    uint16_t _port;
+    std::string _address;
+    size_t _ring_blocks;
+    SlowClientPolicy _policy;
+
+    int _listen_fd = -1;
+    int _wake_fd = -1; ///< eventfd that wakes the network thread when blocks are published.
+
+    std::thread _thread;
+    std::atomic_bool _running = false;
+
+    std::mutex _clients_mtx;
+    std::vector<std::unique_ptr<Client>> _clients;
+
+    void run(void);
+    void accept_clients(void);
+    bool send_blocks(Client &client);
+    void remove_client(size_t index);
+
+public:
+    /**
+     * @brief Construct a server, it listens once started.
+     *
+     * @param port TCP port, 0 picks a free port
+     * @param ring_blocks blocks that can wait for each client
+     * @param policy what happens to a client that does not keep up
+     * @param address local address to listen on, such as 127.0.0.1 for local clients only
+     */
+    StreamServer(uint16_t port = STREAM_DEFAULT_PORT, size_t ring_blocks = 16, SlowClientPolicy policy = SlowClientPolicy::SKIP,
+                 const std::string &address = "0.0.0.0");
+    ~StreamServer();
+
+    StreamServer(const StreamServer &) = delete;
+    StreamServer &operator=(const StreamServer &) = delete;
+
+    /**
+     * @brief Open the listening socket and start the network thread.
+     */
+    void start(void);
+
+    /**
+     * @brief Disconnect all clients and stop the network thread.
+     */
+    void stop(void);
+
+    /**
+     * @brief Port the server listens on, the picked port when it was constructed with 0.
+     */
+    uint16_t port(void) const { return _port; }
+
+    /**
+     * @brief Number of connected clients.
+     */
+    size_t n_clients(void);
+
+    /**
+     * @brief Queue a block for every connected client, returns without waiting for the network.
+     *
+     * @param block block that is not changed anymore
+     */
+    void publish(std::shared_ptr<const SampleBlock> block);
+
+    const char *sink_name() const override { return "stream"; }
+    void consume(const std::shared_ptr<const SampleBlock> &block) override { publish(block); }
+    void finish() override { stop(); }
+};
+
+#endif
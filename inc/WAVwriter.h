@@ -16,44 +16,88 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <span>
 #include <cmath>
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <sstream>
+#include <memory>
+#include <future>
 
-class WAVWriter
+#include "AsyncFileWriter.h"
+#include "RecordingWriter.h"
+
+class WAVWriter : public RecordingWriter
 {
 public:
+    /**
+     * @brief How sample data reaches the file.
+     */
+    enum class Mode
+    {
+        QUEUED, ///< Packed into pool buffers and written by the storage thread.
+        MAPPED  ///< Packed straight into a preallocated, memory-mapped file.
+    };
+
+    static constexpr const char *PREPARED_SUFFIX = ".part"; ///< Added to the name of a prepared file until it is opened, it holds no data.
+
 public:
     WAVWriter(uint8_t num_channels, uint32_t sample_rate, uint8_t bits_per_sample);
     WAVWriter();
-    ~WAVWriter();
+    ~WAVWriter() override;
+
+    std::string extension() const override { return ".wav"; }
 
     /**
      * @brief Set comments or metadata for the WAV file.
      * 
      * @param comment The comment or metadata string to be added to the file.
      */
-    void set_comments(const std::string &comment);
+    void set_comments(const std::string &comment) override;
 
     /**
      * @brief Set the datetime for the WAV file metadata.
      * 
      * @param datetime The timestamp to be recorded in the file.
      */
-    void set_datetime(const std::chrono::system_clock::time_point &datetime);
+    void set_datetime(const std::chrono::system_clock::time_point &datetime) override;
 
     /**
      * @brief Open a new file for writing WAV data.
      * 
      * @param file_name The name of the file to be created and written to.
      */
-    void open_file(const std::string &file_name);
+    void open_file(const std::string &file_name) override;
 
     /**
      * @brief Close the currently open WAV file.
+     *
+     * The remaining samples, the INFO chunk and the final sizes are queued, this does not wait for storage.
+     */
+    void close_file() override;
+
+    /**
+     * @brief Create the next file in the background, so a later open_file of the same name does not wait for it.
+     *
+     * Only MAPPED mode does blocking work when opening, in QUEUED mode this does nothing. The file carries
+     * PREPARED_SUFFIX until it is opened, so a crash in between leaves no empty file under a data file name.
+     *
+     * @param file_name The name of the file that will be opened next.
      */
-    void close_file();
+    void prepare_file(const std::string &file_name) override;
+
+    /**
+     * @brief Wait until everything queued so far has been written.
+     */
+    void flush() override;
+
+    /**
+     * @brief Get the write completion latency since the previous call.
+     *
+     * @return WriteLatency latency statistics of the storage thread
+     */
+    WriteLatency take_write_latency() override;
 
     /**
      * @brief Write a vector of samples to the WAV file as channels.
@@ -62,6 +106,14 @@ public:
      */
     void write_channels(const std::vector<int32_t> &samples);
 
+    /**
+     * @brief Write a block of interleaved frames to the WAV file with a single write.
+     *
+     * @param interleaved Samples ordered frame after frame, n_channels samples per frame.
+     * @param n_frames Number of frames to write from the start of interleaved.
+     */
+    void write_frames(std::span<const int32_t> interleaved, size_t n_frames) override;
+
     /**
      * @brief Write a vector of individual samples to the WAV file.
      * 
@@ -69,45 +121,185 @@ public:
      */
     void write_samples(const std::vector<int32_t> &samples);
 
+    /**
+     * @brief Select how sample data is written, takes effect at the next open_file.
+     *
+     * In MAPPED mode every file is allocated at its full size when it is opened and the header
+     * holds the final sizes from the start, or the committed sizes when commits are enabled. A file that ends early is truncated when it is closed,
+     * a file that runs longer grows by another frames_per_file frames.
+     *
+     * @param mode Write mode.
+     * @param frames_per_file Number of frames a file is expected to hold, required for MAPPED.
+     */
+    void set_mode(Mode mode, uint64_t frames_per_file = 0);
+
+    /**
+     * @brief Periodically make the data written so far durable and valid.
+     *
+     * Every interval the data is synced to storage, then the RIFF and data sizes are updated
+     * to cover it and synced as well. After a crash the file holds at least the committed data
+     * with a header that describes it, see recover_file.
+     *
+     * @param frames Number of frames between commits, 0 disables them.
+     */
+    void set_commit_interval(uint64_t frames) override;
+
+    /**
+     * @brief Repair a file that was not closed, for example after a power cut.
+     *
+     * Only the header and the file length are read. The data chunk is cut back to the last committed
+     * size, or to the last whole frame in the file when nothing was committed, and the sizes are fixed.
+     *
+     * @param file_name The file to check.
+     * @return true if the file was repaired, false if it was complete or is not a file written by WAVWriter
+     */
+    static bool recover_file(const std::string &file_name);
+
     /**
      * @brief Set the number of channels for the WAV file.
      * 
      * @param num_channels The number of audio channels.
      */
-    void set_n_channels(uint16_t num_channels);
+    void set_n_channels(uint16_t num_channels) override;
 
     /**
      * @brief Set the sample rate for the WAV file.
      * 
      * @param sample_rate The sample rate in Hz.
      */
-    void set_sample_rate(uint32_t sample_rate);
+    void set_sample_rate(uint32_t sample_rate) override;
 
     /**
      * @brief Set the number of bits per sample for the WAV file.
      * 
      * @param bits_per_sample The number of bits in each audio sample.
      */
-    void set_bits_per_sample(uint16_t bits_per_sample);
+    void set_bits_per_sample(uint16_t bits_per_sample) override;
 
 private:
     // Private member variables with their comments
 
+    /**
+     * @brief An allocated and mapped file of MAPPED mode.
+     */
+    struct MappedFile
+    {
+        int fd = -1;
+        uint8_t *map = nullptr;
+        size_t map_size = 0;   ///< Length of the mapping and of the file.
+        uint64_t capacity = 0; ///< Bytes of sample data the mapping has room for.
+        uint64_t synced = 0;   ///< File offset up to which writeback has been started.
+    };
+
+    /**
+     * @brief A file that is being created on the storage thread.
+     */
+    struct PreparedFile
+    {
+        std::string name;
+        std::future<MappedFile> file;
+    };
+
     /**
      * @brief Write the header of the WAV file.
      */
     void write_wav_header();
 
+    /**
+     * @brief Build the 44 byte header.
+     *
+     * @param riff_size Size of the RIFF chunk, the file length minus 8.
+     * @param data_size Size of the data chunk.
+     * @return std::vector<uint8_t> header bytes
+     */
+    std::vector<uint8_t> build_wav_header(uint32_t riff_size, uint32_t data_size);
+
     /**
      * @brief Write the 'INFO' chunk to the WAV file for additional metadata.
      */
     void write_info_chunk();
 
+    /**
+     * @brief Build the 'INFO' chunk, preceded by the pad byte of an odd sized data chunk.
+     *
+     * @return std::vector<uint8_t> bytes that follow the sample data
+     */
+    std::vector<uint8_t> build_info_chunk();
+
     /**
      * @brief Finalize the WAV file by updating the header with the correct file size.
      */
     void finalize_wav_header();
 
+    /**
+     * @brief Pack samples to the output sample width and append them to the data chunk.
+     *
+     * @param samples Samples to write.
+     * @param n_samples Number of samples.
+     */
+    void append_samples(const int32_t *samples, size_t n_samples);
+
+    /**
+     * @brief Queue the buffer that is being filled for writing.
+     */
+    void submit_buffer();
+
+    /**
+     * @brief Queue a sync of the data, an update of the sizes and a sync of those sizes.
+     */
+    void commit();
+
+    /**
+     * @brief Take the prepared file for MAPPED mode, or create, allocate and map it now.
+     *
+     * @param file_name The name of the file to be created.
+     */
+    void open_mapped(const std::string &file_name);
+
+    /**
+     * @brief Build the INFO chunk and final sizes, then queue writing them, unmapping and closing the file.
+     */
+    void close_mapped();
+
+    /**
+     * @brief Queue removal of a prepared file that is not going to be opened.
+     */
+    void discard_prepared();
+
+    /**
+     * @brief Build the header of a MAPPED file with room for capacity bytes of sample data.
+     *
+     * @param capacity Size of the data chunk.
+     * @param committed Data size of the last commit, used instead of capacity when commits are enabled.
+     * @return std::vector<uint8_t> header bytes
+     */
+    std::vector<uint8_t> build_mapped_header(uint64_t capacity, uint32_t committed);
+
+    /**
+     * @brief Create a file and map it, see map_file.
+     *
+     * @param file_name The name of the file to be created.
+     * @param capacity Size of the data chunk.
+     * @param header Header from build_mapped_header.
+     * @return MappedFile the mapped file
+     */
+    static MappedFile create_mapped(const std::string &file_name, uint64_t capacity, const std::vector<uint8_t> &header);
+
+    /**
+     * @brief Allocate and map the file for a data chunk of file.capacity bytes.
+     *
+     * Writes the header and a JUNK chunk that reserves room for the INFO chunk.
+     *
+     * @param file File with an open descriptor and the capacity set.
+     * @param header Header from build_mapped_header.
+     */
+    static void map_file(MappedFile &file, const std::vector<uint8_t> &header);
+
+    /**
+     * @brief Queue writeback of every completed chunk of the mapping.
+     */
+    void sync_mapped();
+
     // Sample size and speed information
     uint16_t _n_channels = 0;
     uint32_t _sample_rate = 0;
@@ -117,9 +309,23 @@ private:
     int16_t _block_align = 0;
     int32_t _byte_rate = 0;
 
-    // Stream objects;
-    std::ofstream _output_file;
-    std::streampos _current_data_chunk_pos;
+    // Storage objects, every file operation runs on the storage thread of _io
+    AsyncFileWriter _io{1 << 16, 3};
+    AsyncFileWriter::FileId _file = 0;
+    bool _is_open = false;
+
+    IoBuffer *_buffer = nullptr; ///< Buffer that is being filled with packed samples.
+    uint64_t _buffer_offset = 0; ///< File offset of the first byte in _buffer.
+    uint32_t _data_size = 0; ///< Bytes written to the data chunk, tracked instead of queried from the stream.
+    uint32_t _info_size = 0; ///< Bytes of the LIST/INFO chunk, including the pad byte of the data chunk.
+    uint64_t _commit_frames = 0; ///< Frames between commits, 0 when disabled.
+    uint32_t _committed = 0; ///< Data size at the last commit.
+
+    // Memory-mapped storage, only used in MAPPED mode
+    Mode _mode = Mode::QUEUED;
+    uint64_t _frames_per_file = 0; ///< Frames a file is allocated for.
+    MappedFile _mapped; ///< File that is being written.
+    std::unique_ptr<PreparedFile> _prepared; ///< Next file, created ahead on the storage thread.
 
     // Metadata
     std::chrono::system_clock::time_point _datetime;
@@ -114,6 +114,23 @@ public:
      */
     bool wait_for_event(int line_id);
 
+    /**
+     * @brief let thread wait for event on pin, sleeping in the kernel until the edge comes
+     * 
+     * @param line_id BCM gpio pin
+     * @param timeout maximum waiting time
+     * @return true pin was triggered within timeout timeframe
+     * @return false pin was not triggered within timeout timeframe
+     */
+    bool wait_for_event(int line_id, std::chrono::nanoseconds timeout);
+
+    /**
+     * @brief drop the events the kernel queued on a pin, so the next wait is for a new edge
+     * 
+     * @param line_id BCM gpio pin
+     */
+    void clear_events(int line_id);
+
     /**
      * @brief Set the timeout of trigger event
      * 
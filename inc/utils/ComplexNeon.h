@@ -0,0 +1,67 @@
+/**
+ * @file ComplexNeon.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief NEON kernels for interleaved complex spectra
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef COMPLEXNEON_H
+#define COMPLEXNEON_H
+
+#include <cstddef>
+
+#if defined(__ARM_NEON)
+extern "C"
+{
+#include <arm_neon.h>
+}
+#endif
+
+/**
+ * @brief Accumulate the cross spectrum acc += scale * a * conj(b).
+ *
+ * All arrays hold n interleaved complex values (re, im), the layout used by fftw_complex.
+ *
+ * @param a spectrum of the first signal
+ * @param b spectrum of the second signal
+ * @param acc accumulator for the cross spectrum
+ * @param scale weight of this contribution
+ * @param n number of complex values
+ */
+inline void conj_multiply_accumulate(const double *a, const double *b, double *acc, const double scale, const size_t n)
+{
+#if defined(__ARM_NEON)
+    const float64x2_t sign = {scale, -scale};
+    const float64x2_t weight = vdupq_n_f64(scale);
+
+    for (size_t k = 0; k < n; k++)
+    {
+        const float64x2_t va = vld1q_f64(a + 2 * k);
+        const float64x2_t vb = vld1q_f64(b + 2 * k);
+
+        // (ar, ai) * br + (ai, ar) * bi * (1, -1) = (ar br + ai bi, ai br - ar bi)
+        const float64x2_t swapped = vextq_f64(va, va, 1);
+
+        float64x2_t sum = vld1q_f64(acc + 2 * k);
+        sum = vfmaq_f64(sum, va, vmulq_laneq_f64(weight, vb, 0));
+        sum = vfmaq_f64(sum, swapped, vmulq_laneq_f64(sign, vb, 1));
+
+        vst1q_f64(acc + 2 * k, sum);
+    }
+#else
+    for (size_t k = 0; k < n; k++)
+    {
+        const double ar = a[2 * k], ai = a[2 * k + 1];
+        const double br = b[2 * k], bi = b[2 * k + 1];
+
+        acc[2 * k] += scale * (ar * br + ai * bi);
+        acc[2 * k + 1] += scale * (ai * br - ar * bi);
+    }
+#endif
+}
+
+#endif
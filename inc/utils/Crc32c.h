@@ -0,0 +1,79 @@
+/**
+ * @file Crc32c.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief CRC32C (Castagnoli) checksums, using the ARMv8 CRC instructions when available
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/**
+ * @brief Lookup table of the reflected polynomial 0x82f63b78, for the fallback.
+ */
+constexpr std::array<uint32_t, 256> crc32c_table()
+{
+    std::array<uint32_t, 256> table{};
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+
+        for (int bit = 0; bit < 8; bit++)
+            crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+
+        table[i] = crc;
+    }
+
+    return table;
+}
+
+/**
+ * @brief Checksum of a block of bytes.
+ *
+ * @param data bytes to checksum
+ * @param n number of bytes
+ * @param crc checksum of the preceding bytes, to continue a checksum over several blocks
+ * @return uint32_t checksum of the preceding and these bytes
+ */
+inline uint32_t crc32c(const void *data, size_t n, uint32_t crc = 0)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+
+    crc = ~crc;
+
+#if defined(__ARM_FEATURE_CRC32)
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+
+        crc = __crc32cd(crc, word);
+    }
+
+    for (; n; n--)
+        crc = __crc32cb(crc, *p++);
+#else
+    static constexpr std::array<uint32_t, 256> table = crc32c_table();
+
+    for (; n; n--)
+        crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+#endif
+
+    return ~crc;
+}
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * @file Pack24Neon.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief NEON kernels for packing int32 samples into 24 bit little endian and back
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PACK24NEON_H
+#define PACK24NEON_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__ARM_NEON)
+extern "C"
+{
+#include <arm_neon.h>
+}
+#endif
+
+/**
+ * @brief Pack the low 3 bytes of every sample, little endian, into a contiguous byte stream.
+ *
+ * @param in samples to pack
+ * @param out destination of 3 * n bytes
+ * @param n number of samples
+ */
+inline void pack_int24(const int32_t *in, uint8_t *out, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    // byte m of each 48 byte output block comes from byte (m % 3) of sample (m / 3)
+    static constexpr uint8_t shuffle[48] = {
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 16, 17, 18, 20,
+        21, 22, 24, 25, 26, 28, 29, 30, 32, 33, 34, 36, 37, 38, 40, 41,
+        42, 44, 45, 46, 48, 49, 50, 52, 53, 54, 56, 57, 58, 60, 61, 62};
+
+    const uint8x16_t idx0 = vld1q_u8(shuffle);
+    const uint8x16_t idx1 = vld1q_u8(shuffle + 16);
+    const uint8x16_t idx2 = vld1q_u8(shuffle + 32);
+
+    for (; i + 16 <= n; i += 16)
+    {
+        const uint8x16x4_t table = vld1q_u8_x4(reinterpret_cast<const uint8_t *>(in + i));
+
+        vst1q_u8(out + 3 * i, vqtbl4q_u8(table, idx0));
+        vst1q_u8(out + 3 * i + 16, vqtbl4q_u8(table, idx1));
+        vst1q_u8(out + 3 * i + 32, vqtbl4q_u8(table, idx2));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        const uint32_t value = static_cast<uint32_t>(in[i]);
+
+        out[3 * i] = value;
+        out[3 * i + 1] = value >> 8;
+        out[3 * i + 2] = value >> 16;
+    }
+}
+
+/**
+ * @brief Sign extend contiguous 24 bit little endian samples to int32.
+ *
+ * @param in packed samples, 3 * n bytes
+ * @param out destination of n samples
+ * @param n number of samples
+ */
+inline void unpack_int24(const uint8_t *in, int32_t *out, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    // sample j takes bytes 3j to 3j + 2 into the upper three bytes of its lane, the sign is extended by shifting back
+    static constexpr uint8_t shuffle[64] = {
+        255, 0, 1, 2, 255, 3, 4, 5, 255, 6, 7, 8, 255, 9, 10, 11,
+        255, 12, 13, 14, 255, 15, 16, 17, 255, 18, 19, 20, 255, 21, 22, 23,
+        255, 24, 25, 26, 255, 27, 28, 29, 255, 30, 31, 32, 255, 33, 34, 35,
+        255, 36, 37, 38, 255, 39, 40, 41, 255, 42, 43, 44, 255, 45, 46, 47};
+
+    const uint8x16x4_t idx = vld1q_u8_x4(shuffle);
+
+    for (; i + 16 <= n; i += 16)
+    {
+        const uint8x16x3_t table = vld1q_u8_x3(in + 3 * i);
+
+        vst1q_s32(out + i, vshrq_n_s32(vreinterpretq_s32_u8(vqtbl3q_u8(table, idx.val[0])), 8));
+        vst1q_s32(out + i + 4, vshrq_n_s32(vreinterpretq_s32_u8(vqtbl3q_u8(table, idx.val[1])), 8));
+        vst1q_s32(out + i + 8, vshrq_n_s32(vreinterpretq_s32_u8(vqtbl3q_u8(table, idx.val[2])), 8));
+        vst1q_s32(out + i + 12, vshrq_n_s32(vreinterpretq_s32_u8(vqtbl3q_u8(table, idx.val[3])), 8));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        const uint32_t value = in[3 * i] | (in[3 * i + 1] << 8) | (static_cast<uint32_t>(in[3 * i + 2]) << 16);
+
+        out[i] = static_cast<int32_t>(value << 8) >> 8;
+    }
+}
+
+#endif
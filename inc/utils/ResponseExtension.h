@@ -0,0 +1,83 @@
+/**
+ * @file ResponseExtension.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Inverse filter that extends a geophone response below its natural frequency
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef RESPONSEEXTENSION_H
+#define RESPONSEEXTENSION_H
+
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+#include "Iir.h"
+#include "utils/DirectForm2Neon.h"
+
+/**
+ * @brief Two second order sections: the response correction and a DC blocker.
+ */
+typedef Iir::Custom::SOSCascade<2, Iir::DirectFormIINeon> ResponseExtensionFilter;
+
+/**
+ * @brief Parameters of a geophone response and the response it is extended to.
+ */
+struct ResponseExtensionConfig
+{
+    double natural_frequency = 4.5; ///< Natural frequency of the geophone in Hz.
+    double damping = 0.7;           ///< Damping ratio of the geophone.
+    double target_frequency = 1.0;  ///< Natural frequency of the corrected response in Hz.
+    double target_damping = 0.707;  ///< Damping ratio of the corrected response.
+
+    bool operator==(const ResponseExtensionConfig &) const = default;
+};
+
+/**
+ * @brief Set up a response extension filter.
+ *
+ * A geophone behaves as H(s) = s^2 / (s^2 + 2 z0 w0 s + w0^2). The first section cancels its poles with
+ * zeros and replaces them with poles at the target frequency and damping:
+ * C(s) = (s^2 + 2 z0 w0 s + w0^2) / (s^2 + 2 z1 w1 s + w1^2), mapped to the z-domain with the bilinear
+ * transform. Its gain is 1 well above w0 and (w0 / w1)^2 at DC, so the second section is a first order
+ * high pass at a tenth of the target frequency that keeps the ADC offset from being amplified.
+ * Both sections are minimum phase and stable for positive frequencies and damping ratios.
+ *
+ * @param filter filter to set up, its state is left untouched
+ * @param sample_rate sample rate in Hz
+ * @param config geophone and target parameters
+ */
+inline void setup_response_extension(ResponseExtensionFilter &filter, const double sample_rate, const ResponseExtensionConfig &config)
+{
+    if (config.natural_frequency <= 0 || config.target_frequency <= 0 || config.damping <= 0 || config.target_damping <= 0)
+        throw std::invalid_argument("geophone frequencies and damping ratios have to be positive");
+
+    if (config.natural_frequency >= sample_rate / 2 || config.target_frequency >= sample_rate / 2)
+        throw std::invalid_argument("geophone frequencies have to be below the nyquist frequency");
+
+    const double k = 2 * sample_rate;
+    const double k2 = k * k;
+
+    const double w0 = 2 * std::numbers::pi * config.natural_frequency;
+    const double w1 = 2 * std::numbers::pi * config.target_frequency;
+    const double wc = w1 / 10;
+
+    const double b1 = 2 * config.damping * w0, b0 = w0 * w0;
+    const double a1 = 2 * config.target_damping * w1, a0 = w1 * w1;
+
+    const double norm = k2 + a1 * k + a0;
+
+    const double sos[2][6] = {
+        {(k2 + b1 * k + b0) / norm, 2 * (b0 - k2) / norm, (k2 - b1 * k + b0) / norm,
+         1.0, 2 * (a0 - k2) / norm, (k2 - a1 * k + a0) / norm},
+        {k / (k + wc), -k / (k + wc), 0.0,
+         1.0, (wc - k) / (k + wc), 0.0}};
+
+    filter.setup(sos);
+}
+
+#endif
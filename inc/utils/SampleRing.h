@@ -0,0 +1,104 @@
+/**
+ * @file SampleRing.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Mirrored ring buffer that exposes the latest samples as one contiguous span
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+#include <vector>
+#include <span>
+#include <cstddef>
+#include <stdexcept>
+#include <algorithm>
+
+/**
+ * @brief Fixed capacity ring buffer where every sample is stored twice.
+ *
+ * Each value is written at its ring position and at the same position plus the capacity.
+ * Because of this any window of up to capacity samples ending at the head is contiguous in
+ * memory and can be handed out as a span, so sliding windows never have to be copied or shifted.
+ *
+ * @tparam T sample type
+ */
+template <typename T>
+class SampleRing
+{
+private:
+    std::vector<T> _buffer; ///< Storage of twice the capacity.
+    size_t _capacity = 0;   ///< Maximum window length.
+    size_t _head = 0;       ///< Position where the next sample is written.
+    size_t _count = 0;      ///< Number of valid samples, saturates at the capacity.
+
+public:
+    SampleRing() = default;
+
+    explicit SampleRing(size_t capacity)
+    {
+        resize(capacity);
+    }
+
+    /**
+     * @brief Change the capacity of the ring, this clears the content.
+     *
+     * @param capacity maximum window length
+     */
+    void resize(size_t capacity)
+    {
+        _capacity = capacity;
+        _buffer.assign(capacity * 2, T{});
+
+        clear();
+    }
+
+    /**
+     * @brief Drop all samples without releasing memory.
+     */
+    void clear(void)
+    {
+        _head = 0;
+        _count = 0;
+    }
+
+    /**
+     * @brief Append a sample, overwriting the oldest one when the ring is full.
+     *
+     * @param value sample to append
+     */
+    void push(const T value)
+    {
+        _buffer[_head] = value;
+        _buffer[_head + _capacity] = value;
+
+        _head = _head + 1 < _capacity ? _head + 1 : 0;
+        _count = std::min(_count + 1, _capacity);
+    }
+
+    /**
+     * @brief Get the newest samples in chronological order.
+     *
+     * @param length number of samples, at most the capacity
+     * @return std::span<const T> view into the ring, valid until the next push
+     */
+    std::span<const T> latest(size_t length) const
+    {
+        if (length > _count)
+            throw std::out_of_range("not enough samples in ring");
+
+        return {_buffer.data() + _head + _capacity - length, length};
+    }
+
+    size_t size(void) const { return _count; }
+
+    size_t capacity(void) const { return _capacity; }
+
+    bool full(void) const { return _count == _capacity; }
+};
+
+#endif
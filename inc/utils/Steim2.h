@@ -0,0 +1,288 @@
+/**
+ * @file Steim2.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Steim2 difference compression of MiniSEED data records
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef STEIM2_H
+#define STEIM2_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__ARM_NEON)
+extern "C"
+{
+#include <arm_neon.h>
+}
+#endif
+
+constexpr uint32_t STEIM_FRAME_SIZE = 64; ///< Bytes per Steim frame, 16 words.
+
+/**
+ * @brief Bits needed for a value as a signed integer.
+ */
+constexpr uint8_t signed_width(int32_t value)
+{
+    const uint32_t folded = static_cast<uint32_t>(value ^ (value >> 31));
+
+    return folded ? 33 - __builtin_clz(folded) : 1;
+}
+
+/**
+ * @brief First differences and the number of bits each difference needs as a signed value.
+ *
+ * @param x samples
+ * @param n number of samples
+ * @param previous sample before x[0]
+ * @param diff output, x[i] - x[i - 1]
+ * @param width output, bits of diff[i] including the sign bit
+ */
+constexpr void steim2_differences(const int32_t *x, size_t n, int32_t previous, int32_t *diff, uint8_t *width)
+{
+    if (n == 0)
+        return;
+
+    diff[0] = x[0] - previous;
+    width[0] = signed_width(diff[0]);
+
+    size_t i = 1;
+
+#if defined(__ARM_NEON)
+    // the compile time check of the layout runs the scalar loop
+    if (!std::is_constant_evaluated())
+    {
+        const int32x4_t v33 = vdupq_n_s32(33);
+
+        for (; i + 8 <= n; i += 8)
+        {
+            const int32x4_t d0 = vsubq_s32(vld1q_s32(x + i), vld1q_s32(x + i - 1));
+            const int32x4_t d1 = vsubq_s32(vld1q_s32(x + i + 4), vld1q_s32(x + i + 3));
+
+            vst1q_s32(diff + i, d0);
+            vst1q_s32(diff + i + 4, d1);
+
+            // clz of 0 is 32, so 0 and -1 get a width of one bit like in signed_width
+            const int32x4_t w0 = vsubq_s32(v33, vclzq_s32(veorq_s32(d0, vshrq_n_s32(d0, 31))));
+            const int32x4_t w1 = vsubq_s32(v33, vclzq_s32(veorq_s32(d1, vshrq_n_s32(d1, 31))));
+
+            const uint16x8_t w = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(w0)), vmovn_u32(vreinterpretq_u32_s32(w1)));
+
+            vst1_u8(width + i, vmovn_u16(w));
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        diff[i] = x[i] - x[i - 1];
+        width[i] = signed_width(diff[i]);
+    }
+}
+
+/**
+ * @brief Compress samples into the Steim2 frames of one data record.
+ *
+ * Encodes as many samples as fit in the frames, unused words are left zero.
+ *
+ * @param x samples
+ * @param n number of samples available
+ * @param previous last sample of the previous record of the stream, or x[0] when there is none
+ * @param out n_frames * STEIM_FRAME_SIZE bytes, big endian
+ * @param n_frames number of Steim frames in the record
+ * @param frames_used output, number of frames that hold data
+ * @return size_t number of samples encoded
+ */
+constexpr size_t steim2_encode(const int32_t *x, size_t n, int32_t previous, uint8_t *out, uint32_t n_frames, uint32_t &frames_used)
+{
+    // largest possible number of samples, 7 per word
+    const size_t n_max = std::min<size_t>(n, n_frames * 15 * 7);
+
+    std::vector<int32_t> diff(n_max);
+    std::vector<uint8_t> width(n_max);
+
+    steim2_differences(x, n_max, previous, diff.data(), width.data());
+
+    std::vector<uint32_t> words(n_frames * 16, 0);
+
+    // samples per word, bits per sample, nibble and dnib, densest first
+    struct Packing
+    {
+        uint32_t count, bits, nibble, dnib;
+    };
+
+    constexpr Packing packings[] = {
+        {7, 4, 3, 2}, {6, 5, 3, 1}, {5, 6, 3, 0}, {4, 8, 1, 0}, {3, 10, 2, 3}, {2, 15, 2, 2}, {1, 30, 2, 1}};
+
+    size_t pos = 0;
+    uint32_t frame = 0, word = 3; // words 1 and 2 of the first frame hold the integration constants
+
+    while (pos < n_max && frame < n_frames)
+    {
+        const Packing *packing = nullptr;
+
+        for (const Packing &p : packings)
+        {
+            if (p.count > n_max - pos)
+                continue;
+
+            bool fits = true;
+
+            for (uint32_t j = 0; j < p.count; j++)
+                fits &= width[pos + j] <= p.bits;
+
+            if (fits)
+            {
+                packing = &p;
+                break;
+            }
+        }
+
+        if (!packing)
+            throw std::runtime_error("difference too large for Steim2");
+
+        uint32_t value = 0;
+
+        if (packing->nibble == 1)
+        {
+            for (uint32_t j = 0; j < 4; j++)
+                value = (value << 8) | (static_cast<uint32_t>(diff[pos + j]) & 0xff);
+        }
+        else
+        {
+            const uint32_t mask = (1u << packing->bits) - 1;
+
+            for (uint32_t j = 0; j < packing->count; j++)
+                value = (value << packing->bits) | (static_cast<uint32_t>(diff[pos + j]) & mask);
+
+            // the differences are right aligned, 7 x 4 bits leaves the two bits after dnib unused
+            value |= packing->dnib << 30;
+        }
+
+        words[frame * 16 + word] = value;
+        words[frame * 16] |= packing->nibble << (30 - 2 * word);
+
+        pos += packing->count;
+
+        if (++word == 16)
+        {
+            frame++;
+            word = 1;
+        }
+    }
+
+    frames_used = frame + (word > 1 ? 1 : 0);
+
+    // forward and reverse integration constants
+    words[1] = static_cast<uint32_t>(x[0]);
+    words[2] = static_cast<uint32_t>(x[pos - 1]);
+
+    for (size_t w = 0; w < words.size(); w++)
+    {
+        out[4 * w] = words[w] >> 24;
+        out[4 * w + 1] = words[w] >> 16;
+        out[4 * w + 2] = words[w] >> 8;
+        out[4 * w + 3] = words[w];
+    }
+
+    return pos;
+}
+
+/**
+ * @brief Decompress the Steim2 frames of one data record, following the layout of the SEED manual.
+ *
+ * @param in n_frames * STEIM_FRAME_SIZE bytes, big endian
+ * @param n_frames number of Steim frames in the record
+ * @param n number of samples in the record
+ * @param x output, n samples
+ * @return true if the samples end at the reverse integration constant
+ */
+constexpr bool steim2_decode(const uint8_t *in, uint32_t n_frames, size_t n, int32_t *x)
+{
+    auto word_at = [&](size_t w)
+    { return uint32_t(in[4 * w]) << 24 | uint32_t(in[4 * w + 1]) << 16 | uint32_t(in[4 * w + 2]) << 8 | uint32_t(in[4 * w + 3]); };
+
+    // sign extends the low bits of a word
+    auto field = [](uint32_t value, uint32_t shift, uint32_t bits)
+    { return static_cast<int32_t>((value >> shift) << (32 - bits)) >> (32 - bits); };
+
+    size_t pos = 0;
+    int32_t sample = static_cast<int32_t>(word_at(1));
+
+    auto add = [&](int32_t diff)
+    {
+        if (pos >= n)
+            return;
+
+        // the first difference leads up to the forward integration constant, which is the first sample
+        sample = pos ? sample + diff : sample;
+        x[pos++] = sample;
+    };
+
+    for (uint32_t frame = 0; frame < n_frames && pos < n; frame++)
+    {
+        const uint32_t nibbles = word_at(frame * 16);
+
+        for (uint32_t word = frame ? 1 : 3; word < 16 && pos < n; word++)
+        {
+            const uint32_t value = word_at(frame * 16 + word);
+            const uint32_t nibble = (nibbles >> (30 - 2 * word)) & 0b11;
+            const uint32_t dnib = value >> 30;
+
+            uint32_t count = 0, bits = 0;
+
+            if (nibble == 1)
+                count = 4, bits = 8;
+            else if (nibble == 2)
+                count = dnib == 1 ? 1 : dnib == 2 ? 2 : 3, bits = 30 / count;
+            else if (nibble == 3)
+                count = dnib == 0 ? 5 : dnib == 1 ? 6 : 7, bits = dnib == 0 ? 6 : dnib == 1 ? 5 : 4;
+
+            for (uint32_t j = 0; j < count; j++)
+                add(field(value, (count - 1 - j) * bits, bits));
+        }
+    }
+
+    return pos == n && n && x[n - 1] == static_cast<int32_t>(word_at(2));
+}
+
+/**
+ * @brief Encode a signal that needs every packing into one record and decode it again.
+ */
+constexpr bool steim2_round_trip(void)
+{
+    constexpr uint32_t n_frames = 7;
+    constexpr int32_t steps[] = {3, -5, 7, -8, 1, 0, -2, 12, -15, 31, -32, 100, -128, 500, -512, 16000, -16384, 1 << 28, -(1 << 29)};
+
+    std::array<int32_t, 256> x{};
+    int32_t value = 1000;
+
+    for (size_t i = 0; i < x.size(); i++)
+        x[i] = value += steps[(i / 7) % std::size(steps)];
+
+    std::array<uint8_t, n_frames * STEIM_FRAME_SIZE> record{};
+    uint32_t frames_used = 0;
+
+    const size_t n = steim2_encode(x.data(), x.size(), 1000, record.data(), n_frames, frames_used);
+
+    std::array<int32_t, 256> decoded{};
+
+    if (!n || !steim2_decode(record.data(), n_frames, n, decoded.data()))
+        return false;
+
+    return std::equal(x.begin(), x.begin() + n, decoded.begin());
+}
+
+static_assert(steim2_round_trip(), "Steim2 records have to decode to the same samples");
+
+#endif
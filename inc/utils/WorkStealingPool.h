@@ -0,0 +1,133 @@
+/**
+ * @file WorkStealingPool.h
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief Runs a batch of independent tasks on all cores, idle workers steal tasks from the others
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+
+class WorkStealingPool
+{
+private:
+    struct Queue
+    {
+        std::mutex mtx;
+        std::deque<size_t> tasks;
+    };
+
+    size_t _n_workers;
+
+public:
+    /**
+     * @brief Create a pool.
+     *
+     * @param n_workers number of worker threads, 0 uses one per core
+     */
+    explicit WorkStealingPool(size_t n_workers = 0)
+        : _n_workers(n_workers ? n_workers : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    size_t n_workers() const { return _n_workers; }
+
+    /**
+     * @brief Run tasks 0 to n_tasks - 1 and wait until all of them are done.
+     *
+     * Each worker starts on its own consecutive range of tasks and takes them from the front, so neighbouring
+     * tasks run on the same worker. A worker that runs out steals from the back of another worker's range, which
+     * keeps all cores busy when tasks differ in length. The first exception thrown by a task is rethrown here
+     * after the other tasks have finished.
+     *
+     * @param n_tasks number of tasks
+     * @param task called with the task number and the number of the worker running it
+     */
+    void run(size_t n_tasks, const std::function<void(size_t task, size_t worker)> &task)
+    {
+        const size_t n_workers = std::min(_n_workers, std::max<size_t>(n_tasks, 1));
+
+        std::vector<Queue> queues(n_workers);
+
+        for (size_t t = 0; t < n_tasks; t++)
+            queues[t * n_workers / n_tasks].tasks.push_back(t);
+
+        std::mutex error_mtx;
+        std::exception_ptr error;
+
+        auto next_task = [&](size_t worker, size_t &t)
+        {
+            {
+                std::lock_guard lock(queues[worker].mtx);
+
+                if (!queues[worker].tasks.empty())
+                {
+                    t = queues[worker].tasks.front();
+                    queues[worker].tasks.pop_front();
+                    return true;
+                }
+            }
+
+            // tasks are only added before the workers start, so nothing is left once every queue is empty
+            for (size_t i = 1; i < n_workers; i++)
+            {
+                Queue &victim = queues[(worker + i) % n_workers];
+                std::lock_guard lock(victim.mtx);
+
+                if (!victim.tasks.empty())
+                {
+                    t = victim.tasks.back();
+                    victim.tasks.pop_back();
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        auto work = [&](size_t worker)
+        {
+            size_t t;
+
+            while (next_task(worker, t))
+            {
+                try
+                {
+                    task(t, worker);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(error_mtx);
+
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+
+        for (size_t w = 1; w < n_workers; w++)
+            threads.emplace_back(work, w);
+
+        work(0);
+
+        for (auto &thread : threads)
+            thread.join();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+#endif
@@ -17,7 +17,7 @@
 #include <system_error>
 #include <unistd.h>
 
-void set_thread_priority(int prio = 0, int scheduler = SCHED_FIFO)
+inline void set_thread_priority(int prio = 0, int scheduler = SCHED_FIFO)
 {
     pthread_t this_thread = pthread_self();
     struct sched_param params;
@@ -54,7 +54,7 @@ void set_thread_priority(int prio = 0, int scheduler = SCHED_FIFO)
 
 
 // Function that sets the thread affinity to a single core
-void set_thread_affinity(int core_id)
+inline void set_thread_affinity(int core_id)
 {
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
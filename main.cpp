@@ -1,4 +1,12 @@
+#include <set>
+#include <array>
+#include <mutex>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <csignal>
+#include <algorithm>
 
 #include "argparse/argparse.hpp"
 
@@ -8,11 +16,420 @@
 #include "utils/easylogging_setup.h"
 
 #include "DataHandler.h"
+#include "ConfigFile.h"
+#include "ControlServer.h"
+
+#ifndef DRONGO_CONFIG_FILE
+#define DRONGO_CONFIG_FILE "Drongo.conf"
+#endif
 
 using namespace std::chrono_literals;
 
 INITIALIZE_EASYLOGGINGPP
 
+/**
+ * @brief Settings that can be changed while measuring, by the config file, SIGHUP or the control socket.
+ */
+const std::set<std::string> RUNTIME_SETTINGS = {
+    "output", "number_channels", "channels", "sample_rate", "adc_goal", "file_duration", "archive_minutes", "lowpass", "extend_response", "extended_damping",
+    "geophone_frequency", "geophone_damping", "qc", "qc_interval", "psd", "psd_fft_size", "psd_tile_seconds", "xcorr",
+    "xcorr_window", "xcorr_max_lag", "xcorr_stack_seconds", "stream", "stream_port", "stream_ring",
+    "stream_disconnect_slow", "shm", "shm_name", "shm_seconds"};
+
+/**
+ * @brief Settings that are only read at startup.
+ */
+const std::set<std::string> STARTUP_SETTINGS = {
+    "commit_interval", "flac", "mseed", "mseed_record_length", "seed_network", "seed_station", "seed_location",
+    "seed_channels", "archive", "raw", "preallocate", "direct_read", "control", "control_socket"};
+
+/**
+ * @brief Where the value of a setting comes from, in order of precedence.
+ */
+struct SettingSources
+{
+    const argparse::ArgumentParser &program; ///< Command line, with the defaults of every setting.
+    ConfigFile file;                         ///< Config file.
+    ConfigFile overrides;                    ///< Values set over the control socket, they last until the next reload.
+};
+
+/**
+ * @brief Read the config file, with the keys it used to have renamed to the names of the arguments.
+ *
+ * @param path config file
+ * @return ConfigFile values by argument name, without the leading dashes
+ */
+ConfigFile read_config_file(const std::filesystem::path &path)
+{
+    ConfigFile file;
+    file.load(path);
+
+    file.rename("output_dir", "output");
+    file.rename("n_channels", "number_channels");
+
+    for (const std::string &key : file.keys())
+        if (!RUNTIME_SETTINGS.contains(key) && !STARTUP_SETTINGS.contains(key))
+            LOG(WARNING) << path.string() << ": unknown setting " << key;
+
+    return file;
+}
+
+template <typename T>
+T parse_setting(const std::string &key, const std::string &text)
+{
+    size_t used = 0;
+    T value{};
+
+    try
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            std::string lower = text;
+            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+            if (lower != "true" && lower != "false" && lower != "yes" && lower != "no" && lower != "on" && lower != "off" && lower != "1" && lower != "0")
+                throw std::invalid_argument("not a boolean");
+
+            value = lower == "true" || lower == "yes" || lower == "on" || lower == "1";
+            used = text.size();
+        }
+        else if constexpr (std::is_same_v<T, int>)
+            value = std::stoi(text, &used);
+        else if constexpr (std::is_same_v<T, double>)
+            value = std::stod(text, &used);
+        else
+        {
+            value = text;
+            used = text.size();
+        }
+    }
+    catch (const std::exception &)
+    {
+        used = 0;
+    }
+
+    if (used != text.size() || (text.empty() && !std::is_same_v<T, std::string>))
+        throw std::invalid_argument("invalid value for " + key + ": " + text);
+
+    return value;
+}
+
+/**
+ * @brief Value of a setting: set over the control socket, else given on the command line, else in the config
+ * file, else the default of the argument.
+ *
+ * @param sources values of every source
+ * @param key argument name without the leading dashes
+ */
+template <typename T>
+T setting(const SettingSources &sources, const std::string &key)
+{
+    if (auto text = sources.overrides.get(key))
+        return parse_setting<T>(key, *text);
+
+    if (sources.program.is_used("--" + key))
+        return sources.program.get<T>("--" + key);
+
+    if (auto text = sources.file.get(key))
+        return parse_setting<T>(key, *text);
+
+    return sources.program.get<T>("--" + key);
+}
+
+/**
+ * @brief Parse a list of channel pairs such as "0:1,0:2".
+ *
+ * @param text comma separated pairs of channel indices
+ * @return std::vector<ChannelPair> parsed pairs
+ */
+std::vector<ChannelPair> parse_channel_pairs(const std::string &text)
+{
+    std::vector<ChannelPair> pairs;
+    std::stringstream ss(text);
+    std::string item;
+
+    while (std::getline(ss, item, ','))
+    {
+        auto separator = item.find(':');
+
+        if (separator == std::string::npos)
+            throw std::invalid_argument("channel pair has to be formatted as a:b, got " + item);
+
+        pairs.push_back({std::stoi(item.substr(0, separator)), std::stoi(item.substr(separator + 1))});
+    }
+
+    return pairs;
+}
+
+/**
+ * @brief Names of the system readings in the channels setting, by their bit in SYSRED.
+ */
+constexpr std::array<std::pair<const char *, uint8_t>, 5> SYSTEM_CHANNEL_NAMES = {
+    {{"offset", 0}, {"vcc", 2}, {"temp", 3}, {"gain", 4}, {"ref", 5}}};
+
+/**
+ * @brief Parse a set of ADC channels such as "diff0,diff1,ain4,temp".
+ *
+ * @param text comma separated channels: diff0 up to diff7, ain0 up to ain15 (or se0 up to se15), offset, vcc, temp,
+ * gain and ref
+ * @return std::optional<ScanChannels> channels to scan, empty when the text names none
+ */
+std::optional<ScanChannels> parse_scan_channels(const std::string &text)
+{
+    ScanChannels channels;
+    std::stringstream ss(text);
+    std::string item;
+
+    // the number of an input, -1 when the item is not the prefix followed by only digits
+    auto input = [](const std::string &item, const std::string &prefix) -> int
+    {
+        if (item.size() <= prefix.size() || item.size() > prefix.size() + 2 || item.compare(0, prefix.size(), prefix) != 0 ||
+            !std::all_of(item.begin() + prefix.size(), item.end(), ::isdigit))
+            return -1;
+
+        return std::stoi(item.substr(prefix.size()));
+    };
+
+    while (std::getline(ss, item, ','))
+    {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        std::transform(item.begin(), item.end(), item.begin(), ::tolower);
+
+        if (item.empty())
+            continue;
+
+        const auto system = std::find_if(SYSTEM_CHANNEL_NAMES.begin(), SYSTEM_CHANNEL_NAMES.end(),
+                                          [&](const auto &name)
+                                          { return item == name.first; });
+
+        if (const int n = input(item, "diff"); n >= 0 && n < 8)
+            channels.differential |= 1u << n;
+        else if (const int n = std::max(input(item, "ain"), input(item, "se")); n >= 0 && n < 16)
+            channels.single |= 1u << n;
+        else if (system != SYSTEM_CHANNEL_NAMES.end())
+            channels.system |= 1u << system->second;
+        else
+            throw std::invalid_argument("unknown channel " + item + ", channels are diff0-diff7, ain0-ain15, offset, vcc, temp, gain and ref");
+    }
+
+    if (!channels.size())
+        return std::nullopt;
+
+    return channels;
+}
+
+/**
+ * @brief Format a set of ADC channels as the channels setting, in the scan order of the ADC.
+ *
+ * @param channels channels to scan
+ * @return std::string comma separated channels
+ */
+std::string format_scan_channels(const ScanChannels &channels)
+{
+    std::vector<std::string> names;
+
+    for (int n = 0; n < 8; n++)
+        if ((channels.differential >> n) & 1)
+            names.push_back("diff" + std::to_string(n));
+
+    for (int n = 0; n < 16; n++)
+        if ((channels.single >> n) & 1)
+            names.push_back("ain" + std::to_string(n));
+
+    for (const auto &[name, bit] : SYSTEM_CHANNEL_NAMES)
+        if ((channels.system >> bit) & 1)
+            names.push_back(name);
+
+    std::string text;
+
+    for (size_t i = 0; i < names.size(); i++)
+        text += (i ? "," : "") + names[i];
+
+    return text;
+}
+
+/**
+ * @brief Parse how the ADC settings are chosen.
+ *
+ * @param text power or rate
+ * @return PlanGoal goal of the acquisition planner
+ */
+PlanGoal parse_plan_goal(const std::string &text)
+{
+    if (text == "power")
+        return PlanGoal::MIN_POWER;
+
+    if (text == "rate")
+        return PlanGoal::MAX_RATE;
+
+    throw std::invalid_argument("adc_goal has to be power or rate, got " + text);
+}
+
+/**
+ * @brief Collect the SEED identifiers from the settings.
+ *
+ * @param sources values of the settings
+ * @return SeedCodes identifiers of the MiniSEED streams
+ */
+SeedCodes parse_seed_codes(const SettingSources &sources)
+{
+    SeedCodes codes{.network = setting<std::string>(sources, "seed_network"),
+                    .station = setting<std::string>(sources, "seed_station"),
+                    .location = setting<std::string>(sources, "seed_location")};
+
+    std::stringstream ss(setting<std::string>(sources, "seed_channels"));
+    std::string item;
+
+    while (std::getline(ss, item, ','))
+        codes.channels.push_back(item);
+
+    return codes;
+}
+
+/**
+ * @brief Collect the settings that can be changed while measuring.
+ *
+ * @param sources values of the settings
+ * @param archive whether archive files are written, their length is given in minutes
+ * @return RuntimeConfig settings for the data handler
+ */
+RuntimeConfig read_runtime_config(const SettingSources &sources, bool archive)
+{
+    RuntimeConfig config;
+
+    config.data_path = expand_home(setting<std::string>(sources, "output"));
+    config.n_channels = std::max(0, setting<int>(sources, "number_channels"));
+    config.channels = parse_scan_channels(setting<std::string>(sources, "channels"));
+    config.sample_rate = setting<double>(sources, "sample_rate");
+    config.rate_goal = parse_plan_goal(setting<std::string>(sources, "adc_goal"));
+    config.file_duration = archive ? std::chrono::minutes(setting<int>(sources, "archive_minutes"))
+                                   : std::chrono::seconds(setting<int>(sources, "file_duration"));
+
+    config.lowpass_frequency = setting<double>(sources, "lowpass");
+
+    if (setting<double>(sources, "extend_response") > 0)
+        config.response_extension = ResponseExtensionConfig{.natural_frequency = setting<double>(sources, "geophone_frequency"),
+                                                            .damping = setting<double>(sources, "geophone_damping"),
+                                                            .target_frequency = setting<double>(sources, "extend_response"),
+                                                            .target_damping = setting<double>(sources, "extended_damping")};
+
+    if (setting<bool>(sources, "qc"))
+        config.qc_interval = setting<double>(sources, "qc_interval");
+
+    if (setting<bool>(sources, "psd"))
+        config.spectrum = SpectrumSettings{.fft_size = static_cast<uint32_t>(setting<int>(sources, "psd_fft_size")),
+                                           .tile_seconds = setting<double>(sources, "psd_tile_seconds")};
+
+    if (const std::string pairs = setting<std::string>(sources, "xcorr"); !pairs.empty())
+        config.correlation = CorrelationSettings{.pairs = parse_channel_pairs(pairs),
+                                                 .window = static_cast<uint32_t>(setting<int>(sources, "xcorr_window")),
+                                                 .max_lag_seconds = setting<double>(sources, "xcorr_max_lag"),
+                                                 .stack_seconds = setting<double>(sources, "xcorr_stack_seconds")};
+
+    if (setting<bool>(sources, "stream"))
+        config.stream = StreamSettings{.port = static_cast<uint16_t>(setting<int>(sources, "stream_port")),
+                                       .ring_blocks = static_cast<size_t>(std::max(1, setting<int>(sources, "stream_ring"))),
+                                       .policy = setting<bool>(sources, "stream_disconnect_slow") ? StreamServer::SlowClientPolicy::DISCONNECT
+                                                                                                  : StreamServer::SlowClientPolicy::SKIP};
+
+    if (setting<bool>(sources, "shm"))
+        config.shared_memory = SharedMemorySettings{.name = setting<std::string>(sources, "shm_name"),
+                                                    .seconds = setting<double>(sources, "shm_seconds")};
+
+    return config;
+}
+
+/**
+ * @brief Settings in use, in the format of the config file.
+ *
+ * @param config runtime settings of the data handler
+ * @param sample_rate frames per second
+ * @return std::string one setting per line
+ */
+std::string describe_config(const RuntimeConfig &config, double sample_rate)
+{
+    std::stringstream ss;
+
+    ss << "output = " << config.data_path.string() << "\n"
+       << "number_channels = " << config.n_channels << "\n"
+       << "channels = " << (config.channels ? format_scan_channels(*config.channels) : "") << "\n"
+       << "sample_rate = " << config.sample_rate << " # " << sample_rate << " Hz in use\n"
+       << "adc_goal = " << (config.rate_goal == PlanGoal::MAX_RATE ? "rate" : "power") << "\n"
+       << "file_duration = " << config.file_duration.count() << "\n"
+       << "lowpass = " << config.lowpass_frequency << "\n"
+       << "extend_response = " << (config.response_extension ? config.response_extension->target_frequency : 0) << "\n"
+       << "qc = " << (config.qc_interval ? "true" : "false") << "\n";
+
+    if (config.qc_interval)
+        ss << "qc_interval = " << *config.qc_interval << "\n";
+
+    ss << "psd = " << (config.spectrum ? "true" : "false") << "\n";
+
+    if (config.spectrum)
+        ss << "psd_fft_size = " << config.spectrum->fft_size << "\n"
+           << "psd_tile_seconds = " << config.spectrum->tile_seconds << "\n";
+
+    ss << "xcorr = ";
+
+    if (config.correlation)
+        for (size_t i = 0; i < config.correlation->pairs.size(); i++)
+            ss << (i ? "," : "") << config.correlation->pairs[i].first << ":" << config.correlation->pairs[i].second;
+
+    ss << "\n"
+       << "stream = " << (config.stream ? "true" : "false") << "\n";
+
+    if (config.stream)
+        ss << "stream_port = " << config.stream->port << "\n";
+
+    ss << "shm = " << (config.shared_memory ? "true" : "false") << "\n";
+
+    if (config.shared_memory)
+        ss << "shm_name = " << config.shared_memory->name << "\n";
+
+    return ss.str();
+}
+
+/**
+ * @brief Report the counters of the ADC watchdog and the flagged samples as comments, below the settings of describe_config.
+ */
+std::string describe_health(const AdcHealth &stats)
+{
+    std::stringstream ss;
+
+    const double days = std::chrono::duration<double>(std::chrono::system_clock::now() - stats.started).count() / 86400;
+
+    ss << "# adc recoveries: " << stats.recoveries;
+
+    if (days > 0)
+        ss << " (" << stats.recoveries / days << " per day)";
+
+    ss << "\n# adc missed frames: " << stats.missed_frames << "\n";
+
+    if (stats.recoveries)
+    {
+        const time_t last = std::chrono::system_clock::to_time_t(stats.last_recovery);
+
+        ss << "# last adc recovery: " << std::put_time(std::localtime(&last), "%Y-%m-%d %H:%M:%S") << ", took "
+           << stats.last_recovery_ms << " ms, longest " << stats.longest_recovery_ms << " ms\n";
+    }
+
+    auto list = [&](const std::vector<uint64_t> &counts)
+    {
+        for (size_t c = 0; c < counts.size(); c++)
+            ss << (c ? "," : "") << counts[c];
+
+        ss << "\n";
+    };
+
+    ss << "# overflow samples per channel: ";
+    list(stats.overflow_samples);
+
+    ss << "# low supply samples per channel: ";
+    list(stats.supply_samples);
+
+    return ss.str();
+}
+
 int main(int argc, char *argv[])
 {
     easylogging_config();
@@ -27,11 +444,206 @@ int main(int argc, char *argv[])
         .required();
 
     program.add_argument("-n", "--number_channels")
-        .help("specify how many geophones are connected")
+        .help("specify how many geophones are connected, 1 up to 5")
         .default_value(4)
         .scan<'i', int>()
         .required();
 
+    program.add_argument("--channels")
+        .help("ADC channels to scan instead of the geophone inputs, such as diff0,ain4,temp: diff0-diff7, ain0-ain15, offset, vcc, temp, gain and ref")
+        .default_value(std::string(""));
+
+    program.add_argument("--sample_rate")
+        .help("lowest sample rate per channel in Hz, the ADC settings are chosen to reach it, 0 takes 1970 Hz or the highest rate of the channels when that is lower (about 1582 Hz for 5 geophones)")
+        .default_value(0.0)
+        .scan<'g', double>();
+
+    program.add_argument("--adc_goal")
+        .help("power for the slowest ADC settings that reach the sample rate, rate for the fastest")
+        .default_value(std::string("power"));
+
+    program.add_argument("--config")
+        .help("config file with a setting per line, such as psd = true, the command line takes precedence")
+        .default_value(std::string(DRONGO_CONFIG_FILE));
+
+    program.add_argument("--file_duration")
+        .help("length of a data file in seconds, files start on wall-clock multiples of it")
+        .default_value(int(FILE_DURATION.count()))
+        .scan<'i', int>();
+
+    program.add_argument("--commit_interval")
+        .help("seconds between making the open file durable with valid sizes, 0 disables it")
+        .default_value(5.0)
+        .scan<'g', double>();
+
+    program.add_argument("--flac")
+        .help("write lossless FLAC files instead of WAV files, one per geophone above 8 channels")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--mseed")
+        .help("write MiniSEED files with Steim2 compressed records instead of WAV files")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--mseed_record_length")
+        .help("bytes per MiniSEED record, 512 or 4096")
+        .default_value(4096)
+        .scan<'i', int>();
+
+    program.add_argument("--seed_network")
+        .help("SEED network code of the MiniSEED streams")
+        .default_value(std::string("XX"));
+
+    program.add_argument("--seed_station")
+        .help("SEED station code of the MiniSEED streams")
+        .default_value(std::string("DRONG"));
+
+    program.add_argument("--seed_location")
+        .help("SEED location code of the MiniSEED streams")
+        .default_value(std::string(""));
+
+    program.add_argument("--seed_channels")
+        .help("comma separated SEED channel code per channel, for example GPZ,GPN,GPE, empty derives them from the sample rate")
+        .default_value(std::string(""));
+
+    program.add_argument("--archive")
+        .help("write long archive files of checksummed, time-indexed blocks instead of WAV files")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--archive_minutes")
+        .help("length of an archive file in minutes")
+        .default_value(60)
+        .scan<'i', int>();
+
+    program.add_argument("--raw")
+        .help("store the unfiltered ADC codes and STATUS flags in archive files, to be filtered later with drongo_reprocess")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--stream")
+        .help("stream the processed samples live over TCP")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--stream_port")
+        .help("port of the live stream")
+        .default_value(int(STREAM_DEFAULT_PORT))
+        .scan<'i', int>();
+
+    program.add_argument("--stream_ring")
+        .help("blocks that can wait for each stream client")
+        .default_value(16)
+        .scan<'i', int>();
+
+    program.add_argument("--stream_disconnect_slow")
+        .help("disconnect stream clients that do not keep up instead of skipping blocks for them")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--shm")
+        .help("publish the processed samples in a shared memory ring for local programs")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--shm_name")
+        .help("name of the shared memory ring")
+        .default_value(std::string(SHM_RING_DEFAULT_NAME));
+
+    program.add_argument("--shm_seconds")
+        .help("length of the shared memory ring in seconds")
+        .default_value(10.0)
+        .scan<'g', double>();
+
+    program.add_argument("--control")
+        .help("accept commands such as reload and set on a unix socket")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--control_socket")
+        .help("path of the control socket")
+        .default_value(std::string(CONTROL_DEFAULT_SOCKET));
+
+    program.add_argument("--direct_read")
+        .help("read every conversion once directly after DRDY, with 4 SPI bytes instead of 5 per read")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--preallocate")
+        .help("allocate every data file at its full size and write it through a memory mapping")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--psd")
+        .help("write averaged power spectral density tiles next to the data")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--psd_fft_size")
+        .help("length of the fft windows used for the psd tiles")
+        .default_value(4096)
+        .scan<'i', int>();
+
+    program.add_argument("--psd_tile_seconds")
+        .help("time span in seconds that is averaged into one psd tile")
+        .default_value(60.0)
+        .scan<'g', double>();
+
+    program.add_argument("--lowpass")
+        .help("cut-off frequency of the low-pass filter in Hz, 0 disables it")
+        .default_value(450.0)
+        .scan<'g', double>();
+
+    program.add_argument("--extend_response")
+        .help("extend the geophone response down to this natural frequency in Hz, 0 disables it")
+        .default_value(0.0)
+        .scan<'g', double>();
+
+    program.add_argument("--extended_damping")
+        .help("damping ratio of the extended response")
+        .default_value(0.707)
+        .scan<'g', double>();
+
+    program.add_argument("--geophone_frequency")
+        .help("natural frequency of the geophones in Hz")
+        .default_value(4.5)
+        .scan<'g', double>();
+
+    program.add_argument("--geophone_damping")
+        .help("damping ratio of the geophones")
+        .default_value(0.7)
+        .scan<'g', double>();
+
+    program.add_argument("--qc")
+        .help("write quality control statistics next to every data file")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--qc_interval")
+        .help("time span in seconds summarized in one row of quality control statistics")
+        .default_value(10.0)
+        .scan<'g', double>();
+
+    program.add_argument("--xcorr")
+        .help("cross-correlate channel pairs and store the stacks, for example 0:1,0:2")
+        .default_value(std::string(""));
+
+    program.add_argument("--xcorr_window")
+        .help("length in samples of the cross-correlated windows")
+        .default_value(4096)
+        .scan<'i', int>();
+
+    program.add_argument("--xcorr_max_lag")
+        .help("largest lag in seconds that is stored")
+        .default_value(1.0)
+        .scan<'g', double>();
+
+    program.add_argument("--xcorr_stack_seconds")
+        .help("time span in seconds that is stacked into one file")
+        .default_value(3600.0)
+        .scan<'g', double>();
+
     try
     {
         program.parse_args(argc, argv);
@@ -45,18 +657,198 @@ int main(int argc, char *argv[])
 
     LOG(INFO) << "hello world!";
 
+    SettingSources sources{.program = program};
+    const std::filesystem::path config_path = program.get("--config");
+
+    // the default config file is optional, one given on the command line is not
+    try
+    {
+        if (program.is_used("--config") || std::filesystem::exists(config_path))
+            sources.file = read_config_file(config_path);
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what();
+        return 1;
+    }
+
+    // ctrl-c and systemd stop are handled by a thread, so the open files are closed properly, SIGHUP reloads the settings
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    sigaddset(&stop_signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
     DataHandler handler;
 
-    handler.set_data_path(program.get("--output"));
+    // raw data is always stored in archive files
+    const bool archive = setting<bool>(sources, "archive") || setting<bool>(sources, "raw");
+
+    try
+    {
+        handler.set_commit_interval(setting<double>(sources, "commit_interval"));
+        handler.configure(read_runtime_config(sources, archive));
+
+        if (setting<bool>(sources, "flac"))
+            handler.enable_flac();
+
+        if (setting<bool>(sources, "mseed"))
+            handler.enable_miniseed(parse_seed_codes(sources), setting<int>(sources, "mseed_record_length"));
+
+        if (archive)
+            handler.enable_archive();
+
+        if (setting<bool>(sources, "preallocate"))
+            handler.enable_mapped_files();
+
+        if (setting<bool>(sources, "direct_read"))
+            handler.enable_direct_read();
+
+        if (setting<bool>(sources, "raw"))
+            handler.enable_raw_mode();
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what();
+        return 1;
+    }
+
+    // SIGHUP and the control socket change the settings from different threads
+    std::mutex settings_mtx;
+
+    auto reload = [&]()
+    {
+        std::lock_guard lock(settings_mtx);
+
+        SettingSources reloaded{.program = program};
+
+        if (std::filesystem::exists(config_path))
+            reloaded.file = read_config_file(config_path);
+
+        for (const std::string &key : STARTUP_SETTINGS)
+            if (reloaded.file.get(key) != sources.file.get(key))
+                LOG(WARNING) << key << " only changes after a restart";
+
+        handler.reconfigure(read_runtime_config(reloaded, archive));
+
+        // values set over the control socket are replaced by the file
+        sources.file = reloaded.file;
+        sources.overrides.clear();
+
+        LOG(INFO) << "reloaded " << config_path.string();
+    };
+
+    auto handle_command = [&](const std::string &command) -> std::string
+    {
+        std::stringstream ss(command);
+        std::string verb, key, value;
+        ss >> verb >> key;
+        std::getline(ss >> std::ws, value);
+
+        if (verb == "reload")
+        {
+            reload();
+            return "ok, applied at the next block";
+        }
 
-    auto n_channels = program.get<int>("--number_channels");
+        if (verb == "set")
+        {
+            if (key == "output_dir")
+                key = "output";
+            else if (key == "n_channels")
+                key = "number_channels";
 
-    handler.setup_adc(n_channels ,10);
+            if (STARTUP_SETTINGS.contains(key))
+                throw std::invalid_argument(key + " only changes after a restart");
+
+            if (!RUNTIME_SETTINGS.contains(key))
+                throw std::invalid_argument("unknown setting " + key);
+
+            std::lock_guard lock(settings_mtx);
+
+            SettingSources changed{.program = program, .file = sources.file, .overrides = sources.overrides};
+            changed.overrides.set(key, value);
+
+            handler.reconfigure(read_runtime_config(changed, archive));
+
+            sources.overrides = changed.overrides;
+
+            return "ok, applied at the next block";
+        }
+
+        if (verb == "status")
+            return describe_config(handler.config(), handler.sample_rate()) + describe_health(handler.adc_health());
+
+        throw std::invalid_argument("unknown command " + verb + ", expected reload, set {setting} {value} or status");
+    };
+
+    std::unique_ptr<ControlServer> control;
+
+    if (setting<bool>(sources, "control"))
+    {
+        try
+        {
+            control = std::make_unique<ControlServer>(setting<std::string>(sources, "control_socket"), handle_command);
+            control->start();
+        }
+        catch (const std::exception &err)
+        {
+            LOG(ERROR) << "control socket disabled: " << err.what();
+            control.reset();
+        }
+    }
+
+    std::thread signal_thread([&]()
+                              {
+                                  while (true)
+                                  {
+                                      int signal;
+                                      sigwait(&stop_signals, &signal);
+
+                                      if (signal == SIGHUP)
+                                      {
+                                          try
+                                          {
+                                              reload();
+                                          }
+                                          catch (const std::exception &err)
+                                          {
+                                              LOG(ERROR) << "settings not reloaded: " << err.what();
+                                          }
+
+                                          continue;
+                                      }
+
+                                      LOG(INFO) << "stopping on signal " << signal;
+
+                                      handler.stop();
+                                      return;
+                                  } });
+
+    int result = 0;
 
     handler.irq_thread_start();
     std::this_thread::sleep_for(10ms);
-    handler.storing_thread_func();
 
+    try
+    {
+        handler.storing_thread_func();
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what();
+        result = 1;
+
+        // the signal thread is still waiting, a stop signal of our own ends it
+        pthread_kill(signal_thread.native_handle(), SIGTERM);
+    }
+
+    handler.irq_thread_stop();
+    signal_thread.join();
+
+    if (control)
+        control->stop();
 
-    return 0;
+    return result;
 }
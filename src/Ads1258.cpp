@@ -12,6 +12,8 @@
 #include <iostream>
 #include <bitset>
 #include <thread>
+#include <bit>
+#include <cmath>
 
 #include "easylogging++.h"
 
@@ -32,6 +34,31 @@ enum Pins
     PWDN = PhysicalToBCM::PIN16
 };
 
+constexpr uint32_t ADC_SPI_SPEED = 12000000; ///< Default SPI clock in Hz.
+
+constexpr auto ID_POLL_INTERVAL = 50us;   ///< Pause between two reads of the ID register while waiting for the ADC.
+constexpr auto ADC_RESET_PULSE = 100us;   ///< How long RESET and PWDN are held low, far longer than the few clock cycles needed.
+constexpr auto ADC_READY_TIMEOUT = 100ms; ///< Longest wait for the ADC to answer after a reset before trying again.
+
+constexpr auto DRDY_TIMEOUT = 1ms; ///< Shortest wait for a DRDY edge before a direct read batch gives up.
+
+/**
+ * @brief Decode a STATUS byte and the 24 bit conversion result that follows it.
+ */
+static ChannelData decode_sample(const char *bytes)
+{
+    const StatusByte stats = {.raw_data = bytes[0]};
+
+    const uint32_t msb_first = static_cast<uint32_t>(static_cast<uint8_t>(bytes[1])) << 24 |
+                               static_cast<uint32_t>(static_cast<uint8_t>(bytes[2])) << 16 |
+                               static_cast<uint32_t>(static_cast<uint8_t>(bytes[3])) << 8;
+
+    const int32_t value = static_cast<int32_t>(msb_first) >> 8;
+
+    // the flag bits keep their place in the STATUS byte
+    return {static_cast<uint8_t>(stats.bits.CHID), static_cast<uint8_t>(stats.raw_data & (SAMPLE_NEW | SAMPLE_OVERFLOW | SAMPLE_SUPPLY)), value};
+}
+
 int count_set_bits(int n)
 {
     int count = 0;
@@ -46,20 +73,20 @@ int count_set_bits(int n)
 Ads1258::Ads1258(std::filesystem::path spi, std::filesystem::path gpio) : _spi(spi), _gpio(gpio), _channels_active(0x0)
 {
     _spi.set_mode(MODE_3);
-    _spi.set_speed(12e6);
+    set_spi_speed(ADC_SPI_SPEED);
     _spi.set_bits_per_word(8);
 
     _gpio.set_direction(Pins::CLKSEL, Direction::OUTPUT);
     _gpio.set_direction(Pins::START, Direction::OUTPUT);
     _gpio.set_direction(Pins::RST, Direction::OUTPUT);
     _gpio.set_direction(Pins::PWDN, Direction::OUTPUT);
+    _gpio.set_detection(Pins::DRDY, Detection::FALLING);
 
     _gpio.set_output(Pins::CLKSEL, Values::LOW);
     _gpio.set_output(Pins::START, Values::LOW);
     _gpio.set_output(Pins::RST, Values::LOW);
     _gpio.set_output(Pins::PWDN, Values::LOW);
 
-    // _gpio.set_detection(Pins::DRDY, Detection::FALLING);
     _gpio.set_timeout(5us);
 
     reset_local_registers();
@@ -67,15 +94,7 @@ Ads1258::Ads1258(std::filesystem::path spi, std::filesystem::path gpio) : _spi(s
 
 void Ads1258::reset_local_registers(void)
 {
-    registers[RegisterAdressses::CONFIG0] = CONFIG0_DEFAULT.raw_data;
-    registers[RegisterAdressses::CONFIG1] = CONFIG1_DEFAULT.raw_data;
-    registers[RegisterAdressses::MUXSCH] = MUXSCH_DEFAULT.raw_data;
-    registers[RegisterAdressses::MUXDIF] = MUXDIF_DEFAULT.raw_data;
-    registers[RegisterAdressses::MUXSG0] = MUXSG0_DEFAULT.raw_data;
-    registers[RegisterAdressses::MUXSG1] = MUXSG1_DEFAULT.raw_data;
-    registers[RegisterAdressses::GPIOC] = GPIOC_DEFAULT.raw_data;
-    registers[RegisterAdressses::GPIOD] = GPIOD_DEFAULT.raw_data;
-    registers[RegisterAdressses::SYSRED] = SYSRED_DEFAULT.raw_data;
+    registers = DEFAULT_REGISTERS;
 }
 
 void Ads1258::reset_channel_data(void)
@@ -95,6 +114,9 @@ Ads1258::~Ads1258()
 
 void Ads1258::start(bool start)
 {
+    // edges queued before the start belong to conversions that are long gone
+    _gpio.clear_events(Pins::DRDY);
+
     _gpio.set_output(Pins::START, start ? HIGH : LOW);
 
     if (_gpio.get_input(Pins::START) == LOW)
@@ -144,15 +166,15 @@ void Ads1258::set_all_registers(void)
 {
     constexpr CommandByte command = {.bits = {0x0, true, Commands::WRITE_REGISTERS}};
 
-    std::vector<char> message(NUM_REGISTERS - 1 - 1);
+    // command byte followed by every writable register, the ID register is read only
+    std::vector<char> message(registers.size() + 1);
     message[0] = command.raw_data;
 
-    for (auto reg_data : registers)
-    {
-        message[reg_data.first + 1] = reg_data.second;
-    }
+    std::copy(registers.begin(), registers.end(), message.begin() + 1);
 
     _spi.transmit(message);
+
+    _current_channel = 0;
 }
 
 char Ads1258::get_register(RegisterAdressses address)
@@ -357,7 +379,7 @@ void Ads1258::set_system_readings(SystemChannels channels)
     registers[RegisterAdressses::SYSRED] = channels.raw_data;
 
     _channels_active = channels.channels.offset << 24 | (~(0x1 << 24) & _channels_active);
-    _channels_active = channels.raw_data << (25 - 2) | (~(0b1111 << 25) & _channels_active);
+    _channels_active = ((channels.raw_data >> 2) & 0b1111) << 26 | (~(0b1111 << 26) & _channels_active);
 
     _n_channels_active = count_set_bits(_channels_active);
 
@@ -389,9 +411,19 @@ bool Ads1258::verify_settings(void)
 {
     std::vector<char> adc_data = get_all_registers();
 
-    for (auto reg : registers)
+    for (size_t reg = 0; reg < registers.size(); reg++)
     {
-        if (adc_data[reg.first + 1] != reg.second)
+        char expected = registers[reg];
+        char actual = adc_data[reg + 1];
+
+        // GPIOD reads back the level of the pins configured as input
+        if (reg == RegisterAdressses::GPIOD)
+        {
+            expected &= ~registers[RegisterAdressses::GPIOC];
+            actual &= ~registers[RegisterAdressses::GPIOC];
+        }
+
+        if (actual != expected)
             return false;
     }
 
@@ -403,6 +435,97 @@ void Ads1258::update_settings(void)
     set_all_registers();
 }
 
+void Ads1258::write_registers(const RegisterImage &image)
+{
+    registers = image;
+
+    set_all_registers();
+    update_active_channels();
+}
+
+void Ads1258::update_active_channels(void)
+{
+    const uint32_t single = static_cast<uint8_t>(registers[RegisterAdressses::MUXSG0]) |
+                            static_cast<uint8_t>(registers[RegisterAdressses::MUXSG1]) << 8;
+    const uint32_t system = static_cast<uint8_t>(registers[RegisterAdressses::SYSRED]);
+
+    // same layout as the CHID numbering: differential, single ended, offset and, after an unused id, the other
+    // system readings
+    _channels_active = static_cast<uint8_t>(registers[RegisterAdressses::MUXDIF]) | single << 8 | (system & 0x1) << 24 |
+                       ((system >> 2) & 0b1111) << 26;
+
+    _n_channels_active = std::popcount(_channels_active);
+
+    _channel_ids = get_active_channels();
+}
+
+void Ads1258::initialize(const RegisterImage &image, const uint32_t max_tries)
+{
+    uint32_t tries = 0;
+
+    do
+    {
+        pwdn(true);
+        reset(true);
+
+        std::this_thread::sleep_for(ADC_RESET_PULSE);
+
+        pwdn(false);
+        reset(false);
+
+        // the ADC answers as soon as its oscillator runs, then all registers go out in one burst
+        if (wait_until_ready(ADC_READY_TIMEOUT))
+        {
+            write_registers(image);
+
+            if (verify_settings())
+                break;
+        }
+        else
+        {
+            LOG(WARNING) << "adc did not answer after a reset";
+        }
+
+        tries++;
+
+        LOG(WARNING) << "tried setting up adc " << tries << " times";
+
+    } while (tries < max_tries);
+
+    if (tries >= max_tries)
+        throw std::runtime_error("could not setup adc");
+}
+
+bool Ads1258::wait_until_ready(std::chrono::microseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    do
+    {
+        const uint8_t id = get_id().raw_data;
+
+        // an ADC still in reset leaves MISO idle, which reads as all zeros or all ones
+        if (id != 0x00 && id != 0xFF && (id & 0x10) == ADS1258_ID)
+            return true;
+
+        std::this_thread::sleep_for(ID_POLL_INTERVAL);
+
+    } while (std::chrono::steady_clock::now() < deadline);
+
+    return false;
+}
+
+void Ads1258::set_spi_speed(uint32_t speed)
+{
+    _spi.set_speed(speed);
+    _spi_speed = speed;
+}
+
+uint32_t Ads1258::get_spi_speed(void) const
+{
+    return _spi_speed;
+}
+
 IdReg Ads1258::get_id(void)
 {
     return {.raw_data = get_register(RegisterAdressses::ID)};
@@ -417,15 +540,10 @@ std::pair<ChannelData, ChannelData> Ads1258::get_data_read(void)
 
     std::vector<char> rx = _spi.transceive({command.raw_data, 0x0, 0x0, 0x0, 0x0, command.raw_data, 0x0, 0x0, 0x0, 0x0});
 
-    StatusByte stats = {.raw_data = rx[1]};
-
-    data_1 = {static_cast<char>(stats.bits.CHID), static_cast<int32_t>((uint32_t)rx[4] << 8 | ((uint32_t)rx[3] << 16) | ((uint32_t)(rx[2]) << 24)) >> 8};
-
-    stats = {.raw_data = rx[6]};
+    data_1 = decode_sample(&rx[1]);
+    data_2 = decode_sample(&rx[6]);
 
-    data_2 = {static_cast<char>(stats.bits.CHID), static_cast<int32_t>((uint32_t)rx[9] << 8 | ((uint32_t)rx[8] << 16) | ((uint32_t)(rx[7]) << 24)) >> 8};
-
-    _current_channel = data_1.first;
+    _current_channel = data_1.channel;
 
     return {data_1, data_2};
 }
@@ -440,13 +558,7 @@ ChannelData Ads1258::get_data_direct(void)
 
     if (cf0.bits.stat)
     {
-        StatusByte stats = {.raw_data = rx[0]};
-
-        int32_t value = static_cast<int32_t>((uint32_t)rx[3] << 8 | ((uint32_t)rx[2] << 16) | ((uint32_t)(rx[1]) << 24));
-
-        value >>= 8;
-
-        return {static_cast<char>(stats.bits.CHID), value};
+        return decode_sample(rx.data());
     }
     else
     {
@@ -455,14 +567,41 @@ ChannelData Ads1258::get_data_direct(void)
 
         value >>= 8;
 
-        return {0, value};
+        return {0, 0, value};
     }
 }
 
-// bool Ads1258::await_data_ready(void)
-// {
-//     return _gpio.wait_for_event(Pins::DRDY);
-// }
+bool Ads1258::await_data_ready(std::chrono::microseconds timeout)
+{
+    // the thread sleeps in the kernel until DRDY falls, instead of reading the pin over and over
+    return _gpio.wait_for_event(Pins::DRDY, timeout);
+}
+
+size_t Ads1258::get_data_direct(std::span<ChannelData> out, std::chrono::nanoseconds period)
+{
+    const Config0 cf0 = {.raw_data = registers[RegisterAdressses::CONFIG0]};
+
+    if (!cf0.bits.stat)
+        throw std::logic_error("direct reads need the STATUS byte, without it a conversion can neither be placed nor told apart from a repeated read");
+
+    const auto timeout = std::chrono::duration_cast<std::chrono::microseconds>(std::max<std::chrono::nanoseconds>(DRDY_TIMEOUT, 2 * period));
+
+    size_t n_read = 0;
+
+    // every conversion is read right after its own DRDY edge, an edge that queued up while the thread was late
+    // reads the newest conversion, which comes without SAMPLE_NEW when it was read before
+    while (n_read < out.size() && await_data_ready(timeout))
+    {
+        std::vector<char> rx = _spi.receive(4);
+
+        out[n_read++] = decode_sample(rx.data());
+    }
+
+    if (n_read)
+        _current_channel = out[n_read - 1].channel;
+
+    return n_read;
+}
 
 std::vector<uint8_t> Ads1258::get_active_channels(void)
 {
@@ -0,0 +1,409 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "utils/Crc32c.h"
+#include "utils/Pack24Neon.h"
+
+#include "ArchiveWriter.h"
+
+template <class T>
+void append_struct(std::vector<uint8_t> &bytes, const T &obj)
+{
+    const uint8_t *ptr = reinterpret_cast<const uint8_t *>(&obj);
+
+    bytes.insert(bytes.end(), ptr, ptr + sizeof(obj));
+}
+
+/**
+ * @brief Index entries followed by the trailer, appended when a file is closed.
+ */
+std::vector<uint8_t> build_index(const std::vector<ArchiveIndexEntry> &index, uint64_t index_offset, uint32_t index_interval)
+{
+    std::vector<uint8_t> bytes;
+
+    for (const ArchiveIndexEntry &entry : index)
+        append_struct(bytes, entry);
+
+    ArchiveTrailer trailer{};
+    trailer.index_offset = index_offset;
+    trailer.n_entries = index.size();
+    trailer.index_crc = crc32c(bytes.data(), bytes.size());
+    trailer.index_interval = index_interval;
+    trailer.crc = crc32c(&trailer, offsetof(ArchiveTrailer, crc));
+    std::memcpy(trailer.magic, ARCHIVE_INDEX_MAGIC, sizeof(trailer.magic));
+
+    append_struct(bytes, trailer);
+
+    return bytes;
+}
+
+ArchiveWriter::ArchiveWriter(double block_seconds, uint32_t index_interval)
+    : _block_seconds(block_seconds),
+      _index_interval(std::max<uint32_t>(index_interval, 1))
+{
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+    close_file();
+}
+
+void ArchiveWriter::set_comments(const std::string &comment)
+{
+}
+
+void ArchiveWriter::set_datetime(const std::chrono::system_clock::time_point &datetime)
+{
+    _datetime = datetime;
+}
+
+void ArchiveWriter::set_n_channels(uint16_t num_channels)
+{
+    if (_is_open)
+        throw std::runtime_error("cannot update number of channels while file is open");
+
+    _n_channels = num_channels;
+}
+
+void ArchiveWriter::set_sample_rate(uint32_t sample_rate)
+{
+    set_exact_sample_rate(sample_rate);
+}
+
+void ArchiveWriter::set_exact_sample_rate(double sample_rate)
+{
+    if (_is_open)
+        throw std::runtime_error("cannot update sample rate while file is open");
+
+    _sample_rate = sample_rate;
+}
+
+void ArchiveWriter::set_bits_per_sample(uint16_t bits_per_sample)
+{
+    if (_is_open)
+        throw std::runtime_error("cannot update bits per sample while file is open");
+
+    if (bits_per_sample == 0 || bits_per_sample > 32)
+        throw std::invalid_argument("archive supports 1 to 32 bits per sample");
+
+    _bits_per_sample = bits_per_sample;
+    _bytes_per_sample = (bits_per_sample + 7) / 8;
+}
+
+void ArchiveWriter::set_channel_mask(uint32_t channel_mask)
+{
+    _channel_mask = channel_mask;
+}
+
+void ArchiveWriter::set_raw(bool raw)
+{
+    _file_flags = raw ? _file_flags | ARCHIVE_RAW : _file_flags & ~ARCHIVE_RAW;
+}
+
+void ArchiveWriter::set_merged(bool merged)
+{
+    _file_flags = merged ? _file_flags | ARCHIVE_MERGED : _file_flags & ~ARCHIVE_MERGED;
+}
+
+void ArchiveWriter::set_commit_interval(uint64_t frames)
+{
+    _commit_frames = frames;
+}
+
+void ArchiveWriter::mark_gaps(uint32_t channel_mask)
+{
+    _next_gaps |= channel_mask;
+}
+
+void ArchiveWriter::mark_status(uint32_t frame, uint32_t overflow, uint32_t supply)
+{
+    _next_status.push_back({frame, overflow, supply});
+}
+
+void ArchiveWriter::open_file(const std::string &file_name)
+{
+    if (_is_open)
+        close_file();
+
+    if (_n_channels == 0 || _sample_rate <= 0 || _bits_per_sample == 0)
+        throw std::runtime_error("archive format is not configured");
+
+    // a block with its header, a STATUS record for every frame and padding has to fit in one pool buffer
+    const uint32_t frame_room = _n_channels * _bytes_per_sample + sizeof(ArchiveStatusRecord);
+    const uint32_t max_frames = (BUFFER_SIZE - sizeof(ArchiveBlockHeader) - 8) / frame_room;
+
+    _frames_per_block = std::clamp<uint32_t>(std::lround(_sample_rate * _block_seconds), 1, max_frames);
+
+    _io.start();
+
+    _file = _io.open(file_name);
+    _is_open = true;
+    _n_blocks = 0;
+    _index.clear();
+    _file_first_sample = _sample_index;
+    _frames_since_commit = 0;
+
+    ArchiveFileHeader header{};
+    std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = ARCHIVE_VERSION;
+    header.n_channels = _n_channels;
+    header.bits_per_sample = _bits_per_sample;
+    header.bytes_per_sample = _bytes_per_sample;
+    header.sample_rate = _sample_rate;
+    header.channel_mask = _channel_mask;
+    header.frames_per_block = _frames_per_block;
+    header.flags = _file_flags;
+    header.crc = crc32c(&header, offsetof(ArchiveFileHeader, crc));
+
+    std::vector<uint8_t> bytes;
+    append_struct(bytes, header);
+
+    _io.write(_file, 0, std::move(bytes));
+    _offset = sizeof(ArchiveFileHeader);
+}
+
+void ArchiveWriter::close_file()
+{
+    if (!_is_open)
+        return;
+
+    if (!_pending.empty())
+        write_block(_pending.data(), _pending.size() / _n_channels, _gap_mask);
+
+    _pending.clear();
+    _gap_mask = 0;
+    _status.clear();
+
+    submit_buffer();
+
+    _io.write(_file, _offset, build_index(_index, _offset, _index_interval));
+    _io.close(_file);
+    _is_open = false;
+}
+
+void ArchiveWriter::flush()
+{
+    _io.wait_idle();
+}
+
+WriteLatency ArchiveWriter::take_write_latency()
+{
+    return _io.take_latency();
+}
+
+void ArchiveWriter::write_frames(std::span<const int32_t> interleaved, size_t n_frames)
+{
+    if (!_is_open)
+        throw std::runtime_error("File is not open for writing samples.");
+
+    if (interleaved.size() < n_frames * _n_channels)
+        throw std::runtime_error("Not enough samples for the requested number of frames");
+
+    const int32_t *frames = interleaved.data();
+    size_t done = 0;
+
+    // flags follow the frames into _pending, so they are counted from the start of the next block
+    for (ArchiveStatusRecord record : _next_status)
+    {
+        record.frame += _pending.size() / _n_channels;
+        _status.push_back(record);
+    }
+
+    _next_status.clear();
+
+    while (done < n_frames)
+    {
+        // whole blocks are written straight from the caller's frames
+        if (_pending.empty() && n_frames - done >= _frames_per_block)
+        {
+            write_block(frames + done * _n_channels, _frames_per_block, _next_gaps);
+            done += _frames_per_block;
+            continue;
+        }
+
+        const size_t n_fit = std::min<size_t>(_frames_per_block - _pending.size() / _n_channels, n_frames - done);
+
+        _pending.insert(_pending.end(), frames + done * _n_channels, frames + (done + n_fit) * _n_channels);
+        done += n_fit;
+
+        if (_pending.size() == size_t(_frames_per_block) * _n_channels)
+        {
+            write_block(_pending.data(), _frames_per_block, _gap_mask | _next_gaps);
+
+            _pending.clear();
+            _gap_mask = 0;
+        }
+    }
+
+    if (!_pending.empty())
+        _gap_mask |= _next_gaps;
+
+    _next_gaps = 0;
+
+    _frames_since_commit += n_frames;
+
+    // blocks are checked on their own, so everything written so far is readable once it is durable
+    if (_commit_frames && _frames_since_commit >= _commit_frames)
+    {
+        submit_buffer();
+        _io.sync(_file);
+
+        _frames_since_commit = 0;
+    }
+}
+
+void ArchiveWriter::write_block(const int32_t *frames, uint32_t n_frames, uint32_t gap_mask)
+{
+    // the records of this block come first, they are kept in frame order
+    auto status_end = std::find_if(_status.begin(), _status.end(), [&](const ArchiveStatusRecord &r)
+                                   { return r.frame >= n_frames; });
+
+    const uint32_t n_status = std::distance(_status.begin(), status_end);
+    const uint32_t frames_size = n_frames * _n_channels * _bytes_per_sample;
+    const uint32_t payload_size = frames_size + n_status * sizeof(ArchiveStatusRecord);
+    const uint64_t block_size = archive_block_size(payload_size);
+
+    if (_buffer && _buffer->capacity - _buffer->size < block_size)
+        submit_buffer();
+
+    if (!_buffer)
+    {
+        _buffer = _io.acquire_buffer();
+        _buffer_offset = _offset;
+    }
+
+    uint8_t *block = _buffer->data + _buffer->size;
+    uint8_t *payload = block + sizeof(ArchiveBlockHeader);
+    const size_t n_samples = size_t(n_frames) * _n_channels;
+
+    if (_bytes_per_sample == 3)
+        pack_int24(frames, payload, n_samples);
+    else
+        for (size_t i = 0; i < n_samples; i++)
+            std::memcpy(payload + i * _bytes_per_sample, frames + i, _bytes_per_sample);
+
+    if (n_status)
+        std::memcpy(payload + frames_size, _status.data(), n_status * sizeof(ArchiveStatusRecord));
+
+    _status.erase(_status.begin(), status_end);
+
+    for (ArchiveStatusRecord &record : _status)
+        record.frame -= n_frames;
+
+    std::memset(payload + payload_size, 0, block_size - sizeof(ArchiveBlockHeader) - payload_size);
+
+    const double seconds = (_sample_index - _file_first_sample) / _sample_rate;
+
+    ArchiveBlockHeader header{};
+    header.magic = ARCHIVE_BLOCK_MAGIC;
+    header.payload_size = payload_size;
+    header.start_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_datetime.time_since_epoch()).count() +
+                           std::llround(seconds * 1e9);
+    header.first_sample = _sample_index;
+    header.n_frames = n_frames;
+    header.channel_mask = _channel_mask;
+    header.gap_mask = gap_mask;
+    header.flags = (_discontinuity ? ARCHIVE_DISCONTINUITY : 0) | (n_status ? ARCHIVE_STATUS : 0);
+    header.payload_crc = crc32c(payload, payload_size);
+    header.header_crc = crc32c(&header, offsetof(ArchiveBlockHeader, header_crc));
+
+    std::memcpy(block, &header, sizeof(header));
+
+    if (_n_blocks % _index_interval == 0)
+        _index.push_back({header.start_time_ns, header.first_sample, _offset});
+
+    _buffer->size += block_size;
+    _offset += block_size;
+    _sample_index += n_frames;
+    _n_blocks++;
+    _discontinuity = false;
+}
+
+void ArchiveWriter::submit_buffer()
+{
+    if (!_buffer)
+        return;
+
+    // the buffer belongs to the storage thread until it has been written
+    _io.write(_file, _buffer_offset, _buffer);
+    _buffer = nullptr;
+}
+
+bool ArchiveWriter::recover_file(const std::string &file_name)
+{
+    int fd = ::open(file_name.c_str(), O_RDWR | O_CLOEXEC);
+
+    if (fd < 0)
+        return false;
+
+    ArchiveFileHeader header;
+    ArchiveTrailer trailer;
+    struct stat st;
+
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || fstat(fd, &st) < 0 ||
+        std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(header.magic)) ||
+        header.crc != crc32c(&header, offsetof(ArchiveFileHeader, crc)))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    const uint64_t length = st.st_size;
+
+    // a closed file ends with a valid trailer
+    if (length >= sizeof(header) + sizeof(trailer) &&
+        pread(fd, &trailer, sizeof(trailer), length - sizeof(trailer)) == sizeof(trailer) &&
+        !std::memcmp(trailer.magic, ARCHIVE_INDEX_MAGIC, sizeof(trailer.magic)) &&
+        trailer.crc == crc32c(&trailer, offsetof(ArchiveTrailer, crc)))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // keep every block up to the first one that is incomplete or damaged
+    std::vector<ArchiveIndexEntry> index;
+    std::vector<uint8_t> payload;
+    uint64_t offset = sizeof(header);
+    uint64_t n_blocks = 0;
+
+    while (offset + sizeof(ArchiveBlockHeader) <= length)
+    {
+        ArchiveBlockHeader block;
+
+        if (pread(fd, &block, sizeof(block), offset) != sizeof(block) || block.magic != ARCHIVE_BLOCK_MAGIC ||
+            block.header_crc != crc32c(&block, offsetof(ArchiveBlockHeader, header_crc)) ||
+            offset + archive_block_size(block.payload_size) > length)
+            break;
+
+        payload.resize(block.payload_size);
+
+        if (pread(fd, payload.data(), payload.size(), offset + sizeof(block)) != static_cast<ssize_t>(payload.size()) ||
+            block.payload_crc != crc32c(payload.data(), payload.size()))
+            break;
+
+        if (n_blocks++ % ARCHIVE_INDEX_INTERVAL == 0)
+            index.push_back({block.start_time_ns, block.first_sample, offset});
+
+        offset += archive_block_size(block.payload_size);
+    }
+
+    std::vector<uint8_t> bytes = build_index(index, offset, ARCHIVE_INDEX_INTERVAL);
+
+    const bool repaired = ftruncate(fd, offset) == 0 &&
+                          pwrite(fd, bytes.data(), bytes.size(), offset) == static_cast<ssize_t>(bytes.size()) &&
+                          fdatasync(fd) == 0;
+
+    ::close(fd);
+
+    if (!repaired)
+        throw std::runtime_error("could not repair " + file_name + ": " + std::strerror(errno));
+
+    return true;
+}
@@ -0,0 +1,488 @@
+/**
+ * @file AsyncFileWriter.cpp
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef DRONGO_HAVE_IO_URING
+#include <liburing.h>
+#endif
+
+#include "easylogging++.h"
+
+#include "AsyncFileWriter.h"
+
+constexpr unsigned URING_ENTRIES = 32;
+
+AsyncFileWriter::AsyncFileWriter(size_t buffer_size, size_t n_buffers)
+    : _buffer_size((buffer_size + IO_BUFFER_ALIGNMENT - 1) & ~(IO_BUFFER_ALIGNMENT - 1)),
+      _buffers(n_buffers)
+{
+    if (n_buffers < 2)
+        throw std::invalid_argument("at least two buffers are needed");
+
+    for (auto &buffer : _buffers)
+    {
+        buffer.data = static_cast<uint8_t *>(std::aligned_alloc(IO_BUFFER_ALIGNMENT, _buffer_size));
+
+        if (!buffer.data)
+            throw std::bad_alloc();
+
+        buffer.capacity = _buffer_size;
+        _free_buffers.push_back(&buffer);
+    }
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+    stop();
+
+    for (auto &buffer : _buffers)
+        std::free(buffer.data);
+}
+
+void AsyncFileWriter::start(void)
+{
+    if (_run_thread)
+        return;
+
+#ifdef DRONGO_HAVE_IO_URING
+    auto ring = new io_uring;
+
+    if (io_uring_queue_init(URING_ENTRIES, ring, 0) == 0)
+    {
+        _ring = ring;
+        _use_uring = true;
+    }
+    else
+    {
+        delete ring;
+        LOG(WARNING) << "io_uring is not available, falling back to pwrite";
+    }
+#endif
+
+    _run_thread = true;
+
+    _thread = std::thread(&AsyncFileWriter::thread_func, this);
+}
+
+void AsyncFileWriter::stop(void)
+{
+    if (!_thread.joinable())
+        return;
+
+    {
+        std::lock_guard lock(_mtx);
+        _run_thread = false;
+    }
+
+    _cv_queue.notify_one();
+
+    _thread.join();
+
+    close_ring();
+}
+
+void AsyncFileWriter::close_ring(void)
+{
+#ifdef DRONGO_HAVE_IO_URING
+    if (_ring)
+    {
+        io_uring_queue_exit(static_cast<io_uring *>(_ring));
+        delete static_cast<io_uring *>(_ring);
+    }
+#endif
+
+    _ring = nullptr;
+    _use_uring = false;
+}
+
+void AsyncFileWriter::enqueue(IoRequest &&request)
+{
+    request.queued = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard lock(_mtx);
+
+        if (!_run_thread)
+            throw std::runtime_error("storage thread is not running");
+
+        _queue.push_back(std::move(request));
+    }
+
+    _cv_queue.notify_one();
+}
+
+AsyncFileWriter::FileId AsyncFileWriter::open(const std::filesystem::path &path)
+{
+    FileId file = _next_file_id++;
+
+    enqueue({.type = IoRequest::OPEN, .file = file, .path = path});
+
+    return file;
+}
+
+IoBuffer *AsyncFileWriter::acquire_buffer(void)
+{
+    std::unique_lock lock(_mtx);
+
+    if (_free_buffers.empty())
+    {
+        LOG(WARNING) << "storage is falling behind, waiting for a free buffer";
+
+        _cv_buffers.wait(lock, [&]()
+                         { return !_free_buffers.empty(); });
+    }
+
+    IoBuffer *buffer = _free_buffers.back();
+    _free_buffers.pop_back();
+
+    buffer->size = 0;
+
+    return buffer;
+}
+
+void AsyncFileWriter::write(FileId file, uint64_t offset, IoBuffer *buffer)
+{
+    enqueue({.type = IoRequest::WRITE, .file = file, .offset = offset, .buffer = buffer});
+}
+
+void AsyncFileWriter::write(FileId file, uint64_t offset, std::vector<uint8_t> &&bytes)
+{
+    enqueue({.type = IoRequest::WRITE, .file = file, .offset = offset, .bytes = std::move(bytes)});
+}
+
+void AsyncFileWriter::sync(FileId file)
+{
+    enqueue({.type = IoRequest::SYNC, .file = file});
+}
+
+void AsyncFileWriter::truncate(FileId file, uint64_t length)
+{
+    enqueue({.type = IoRequest::TRUNCATE, .file = file, .offset = length});
+}
+
+void AsyncFileWriter::close(FileId file)
+{
+    enqueue({.type = IoRequest::CLOSE, .file = file});
+}
+
+void AsyncFileWriter::run(std::function<void()> task)
+{
+    enqueue({.type = IoRequest::TASK, .task = std::move(task)});
+}
+
+void AsyncFileWriter::wait_idle(void)
+{
+    std::unique_lock lock(_mtx);
+
+    _cv_idle.wait(lock, [&]()
+                  { return (_queue.empty() && !_busy) || !_run_thread; });
+}
+
+WriteLatency AsyncFileWriter::take_latency(void)
+{
+    std::lock_guard lock(_mtx);
+
+    WriteLatency latency = _latency;
+    latency.mean_ms = latency.writes ? _latency_sum_ms / latency.writes : 0;
+
+    _latency = {};
+    _latency_sum_ms = 0;
+
+    return latency;
+}
+
+std::string AsyncFileWriter::take_error(void)
+{
+    std::lock_guard lock(_mtx);
+
+    return std::exchange(_last_error, {});
+}
+
+void AsyncFileWriter::fail(const std::string &error)
+{
+    LOG(ERROR) << error;
+
+    std::lock_guard lock(_mtx);
+    _last_error = error;
+}
+
+void AsyncFileWriter::thread_func(void)
+{
+    std::unique_lock lock(_mtx);
+
+    while (true)
+    {
+        _cv_queue.wait(lock, [&]()
+                       { return !_queue.empty() || !_run_thread; });
+
+        if (_queue.empty())
+            break;
+
+        std::deque<IoRequest> taken;
+        taken.swap(_queue);
+        _busy = true;
+
+        lock.unlock();
+
+        // consecutive writes are submitted together, everything else is ordered behind them
+        std::vector<IoRequest *> writes;
+
+        for (auto &request : taken)
+        {
+            if (request.type == IoRequest::WRITE)
+            {
+                writes.push_back(&request);
+                continue;
+            }
+
+            execute_writes(writes);
+            writes.clear();
+
+            execute(request);
+        }
+
+        execute_writes(writes);
+
+        lock.lock();
+
+        _busy = false;
+
+        if (_queue.empty())
+            _cv_idle.notify_all();
+    }
+
+    // files that were never closed by their owner
+    for (auto [file, fd] : _fds)
+        ::close(fd);
+
+    _fds.clear();
+
+    _cv_idle.notify_all();
+}
+
+void AsyncFileWriter::execute(IoRequest &request)
+{
+    if (request.type == IoRequest::TASK)
+    {
+        request.task();
+        return;
+    }
+
+    auto fd_it = _fds.find(request.file);
+
+    if (request.type == IoRequest::OPEN)
+    {
+        int fd = ::open(request.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (fd < 0)
+            fail("Could not open file for writing: " + request.path.string() + ": " + std::strerror(errno));
+        else
+            _fds[request.file] = fd;
+
+        return;
+    }
+
+    if (fd_it == _fds.end())
+        return;
+
+    switch (request.type)
+    {
+    case IoRequest::SYNC:
+        if (fdatasync(fd_it->second) < 0)
+            fail(std::string("fdatasync failed: ") + std::strerror(errno));
+        break;
+    case IoRequest::TRUNCATE:
+        if (ftruncate(fd_it->second, request.offset) < 0)
+            fail(std::string("ftruncate failed: ") + std::strerror(errno));
+        break;
+    case IoRequest::CLOSE:
+        if (::close(fd_it->second) < 0)
+            fail(std::string("close failed: ") + std::strerror(errno));
+        _fds.erase(fd_it);
+        break;
+    default:
+        break;
+    }
+}
+
+bool AsyncFileWriter::pwrite_all(int fd, const uint8_t *data, size_t size, uint64_t offset)
+{
+    while (size)
+    {
+        ssize_t written = pwrite(fd, data, size, offset);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            fail(std::string("write failed: ") + std::strerror(errno));
+            return false;
+        }
+
+        data += written;
+        size -= written;
+        offset += written;
+    }
+
+    return true;
+}
+
+void AsyncFileWriter::execute_writes(std::vector<IoRequest *> &writes)
+{
+    auto data_of = [](const IoRequest &r)
+    { return r.buffer ? r.buffer->data : r.bytes.data(); };
+
+    auto size_of = [](const IoRequest &r)
+    { return r.buffer ? r.buffer->size : r.bytes.size(); };
+
+    size_t i = 0;
+
+#ifdef DRONGO_HAVE_IO_URING
+    io_uring *ring = static_cast<io_uring *>(_ring);
+
+    auto overlaps = [&](const IoRequest &a, const IoRequest &b)
+    { return a.file == b.file && a.offset < b.offset + size_of(b) && b.offset < a.offset + size_of(a); };
+
+    while (_use_uring && i < writes.size())
+    {
+        std::vector<IoRequest *> submitted;
+
+        for (; i < writes.size() && submitted.size() < URING_ENTRIES; i++)
+        {
+            IoRequest &request = *writes[i];
+            auto fd_it = _fds.find(request.file);
+
+            if (fd_it == _fds.end())
+            {
+                complete_write(request, false);
+                continue;
+            }
+
+            // writes of one batch complete in any order, so a header rewritten over its placeholder waits for the next batch
+            if (std::any_of(submitted.begin(), submitted.end(), [&](const IoRequest *earlier)
+                            { return overlaps(*earlier, request); }))
+                break;
+
+            io_uring_sqe *sqe = io_uring_get_sqe(ring);
+
+            io_uring_prep_write(sqe, fd_it->second, data_of(request), size_of(request), request.offset);
+            io_uring_sqe_set_data(sqe, &request);
+
+            submitted.push_back(&request);
+        }
+
+        if (submitted.empty())
+            continue;
+
+        // liburing returns -errno, the entries the kernel did not take are still in the submission queue
+        const int submit_result = io_uring_submit_and_wait(ring, submitted.size());
+        const size_t n_taken = submitted.size() - std::min<size_t>(io_uring_sq_ready(ring), submitted.size());
+
+        bool ring_failed = submit_result < 0 || n_taken < submitted.size();
+
+        if (ring_failed)
+            fail(std::string("io_uring submission failed, falling back to pwrite: ") + std::strerror(submit_result < 0 ? -submit_result : EAGAIN));
+
+        // every write the kernel took is reaped before its buffer can return to the pool
+        std::vector<IoRequest *> pending(submitted.begin(), submitted.begin() + n_taken);
+
+        while (!pending.empty())
+        {
+            io_uring_cqe *cqe;
+            const int wait_result = io_uring_wait_cqe(ring, &cqe);
+
+            if (wait_result == -EINTR)
+                continue;
+
+            if (wait_result < 0)
+            {
+                fail(std::string("io_uring completion failed, falling back to pwrite: ") + std::strerror(-wait_result));
+                ring_failed = true;
+                break;
+            }
+
+            IoRequest &request = *static_cast<IoRequest *>(io_uring_cqe_get_data(cqe));
+            const int32_t result = cqe->res;
+
+            io_uring_cqe_seen(ring, cqe);
+
+            pending.erase(std::find(pending.begin(), pending.end(), &request));
+
+            const size_t size = size_of(request);
+            bool success = result >= 0;
+
+            if (!success)
+                fail(std::string("write failed: ") + std::strerror(-result));
+            else if (static_cast<size_t>(result) < size)
+                success = pwrite_all(_fds[request.file], data_of(request) + result, size - result, request.offset + result);
+
+            complete_write(request, success);
+        }
+
+        if (ring_failed)
+        {
+            // closing the ring cancels what is left in flight, rewriting the same bytes at the same offsets is harmless
+            close_ring();
+
+            pending.insert(pending.end(), submitted.begin() + n_taken, submitted.end());
+
+            for (IoRequest *request : pending)
+                complete_write(*request, pwrite_all(_fds[request->file], data_of(*request), size_of(*request), request->offset));
+        }
+    }
+#endif
+
+    for (; i < writes.size(); i++)
+    {
+        IoRequest *request = writes[i];
+        auto fd_it = _fds.find(request->file);
+
+        bool success = fd_it != _fds.end() && pwrite_all(fd_it->second, data_of(*request), size_of(*request), request->offset);
+
+        complete_write(*request, success);
+    }
+}
+
+void AsyncFileWriter::complete_write(IoRequest &request, bool success)
+{
+    const double latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - request.queued).count();
+
+    {
+        std::lock_guard lock(_mtx);
+
+        if (success)
+        {
+            _latency.writes++;
+            _latency.bytes += request.buffer ? request.buffer->size : request.bytes.size();
+            _latency.max_ms = std::max(_latency.max_ms, latency_ms);
+            _latency_sum_ms += latency_ms;
+        }
+
+        if (request.buffer)
+        {
+            request.buffer->size = 0;
+            _free_buffers.push_back(request.buffer);
+            request.buffer = nullptr;
+        }
+    }
+
+    _cv_buffers.notify_one();
+}
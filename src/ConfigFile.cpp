@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "ConfigFile.h"
+
+static std::string trim(const std::string &text)
+{
+    const size_t begin = text.find_first_not_of(" \t\r");
+
+    if (begin == std::string::npos)
+        return "";
+
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+void ConfigFile::load(const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+
+    if (!file)
+        throw std::runtime_error("could not read " + path.string());
+
+    std::map<std::string, std::string> values;
+    std::string line;
+    size_t line_number = 0;
+
+    while (std::getline(file, line))
+    {
+        line_number++;
+
+        line = trim(line.substr(0, line.find('#')));
+
+        if (line.empty())
+            continue;
+
+        const size_t separator = line.find('=');
+
+        if (separator == std::string::npos || separator == 0)
+            throw std::runtime_error(path.string() + ":" + std::to_string(line_number) + ": expected key = value, got " + line);
+
+        std::string value = trim(line.substr(separator + 1));
+
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+            value = value.substr(1, value.size() - 2);
+
+        values[trim(line.substr(0, separator))] = value;
+    }
+
+    // nothing is replaced when the file turns out to be broken
+    _values = std::move(values);
+    _path = path;
+}
+
+std::optional<std::string> ConfigFile::get(const std::string &key) const
+{
+    auto value = _values.find(key);
+
+    if (value == _values.end())
+        return std::nullopt;
+
+    return value->second;
+}
+
+void ConfigFile::set(const std::string &key, const std::string &value)
+{
+    _values[key] = value;
+}
+
+void ConfigFile::rename(const std::string &old_key, const std::string &new_key)
+{
+    auto value = _values.find(old_key);
+
+    if (value == _values.end())
+        return;
+
+    // a value under the new key wins
+    _values.try_emplace(new_key, value->second);
+    _values.erase(value);
+}
+
+std::vector<std::string> ConfigFile::keys(void) const
+{
+    std::vector<std::string> keys;
+
+    for (const auto &[key, value] : _values)
+        keys.push_back(key);
+
+    return keys;
+}
+
+std::filesystem::path expand_home(const std::string &path)
+{
+    const char *home = std::getenv("HOME");
+
+    if (home && (path == "~" || path.starts_with("~/")))
+        return std::filesystem::path(home) / path.substr(std::min<size_t>(path.size(), 2));
+
+    return path;
+}
@@ -0,0 +1,178 @@
+#include <poll.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include "easylogging++.h"
+
+#include "ControlServer.h"
+
+constexpr size_t CONTROL_MAX_LINE = 4096; ///< Longest accepted command, a client sending more is disconnected.
+
+ControlServer::ControlServer(const std::filesystem::path &path, Handler handler) : _path(path), _handler(std::move(handler))
+{
+}
+
+ControlServer::~ControlServer()
+{
+    stop();
+}
+
+void ControlServer::start(void)
+{
+    if (_running)
+        return;
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+
+    if (_path.string().size() >= sizeof(addr.sun_path))
+        throw std::invalid_argument("control socket path is too long: " + _path.string());
+
+    std::strncpy(addr.sun_path, _path.c_str(), sizeof(addr.sun_path) - 1);
+
+    _listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (_listen_fd < 0)
+        throw std::system_error(errno, std::system_category(), "could not create control socket");
+
+    // a socket file of an earlier run that was killed would make bind fail
+    ::unlink(_path.c_str());
+
+    if (bind(_listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(_listen_fd, 4) < 0)
+    {
+        const int error = errno;
+        ::close(_listen_fd);
+        throw std::system_error(error, std::system_category(), "could not listen on " + _path.string());
+    }
+
+    _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    _running = true;
+    _thread = std::thread(&ControlServer::run, this);
+
+    LOG(INFO) << "accepting commands on " << _path.string();
+}
+
+void ControlServer::stop(void)
+{
+    if (!_running)
+        return;
+
+    _running = false;
+
+    uint64_t one = 1;
+    (void)!write(_wake_fd, &one, sizeof(one));
+
+    _thread.join();
+
+    for (auto &client : _clients)
+        ::close(client->fd);
+
+    _clients.clear();
+
+    ::close(_listen_fd);
+    ::close(_wake_fd);
+    ::unlink(_path.c_str());
+}
+
+void ControlServer::run(void)
+{
+    std::vector<pollfd> fds;
+
+    while (_running)
+    {
+        fds.assign({{_listen_fd, POLLIN, 0}, {_wake_fd, POLLIN, 0}});
+
+        for (auto &client : _clients)
+            fds.push_back({client->fd, POLLIN, 0});
+
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            LOG(ERROR) << "control socket poll failed: " << std::strerror(errno);
+            break;
+        }
+
+        if (fds[1].revents & POLLIN)
+            continue;
+
+        for (size_t i = fds.size() - 2; i-- > 0;)
+        {
+            if (fds[i + 2].revents & (POLLIN | POLLERR | POLLHUP) && !handle_input(*_clients[i]))
+            {
+                ::close(_clients[i]->fd);
+                _clients.erase(_clients.begin() + i);
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            int fd;
+
+            while ((fd = accept4(_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+            {
+                auto client = std::make_unique<Client>();
+                client->fd = fd;
+                _clients.push_back(std::move(client));
+            }
+        }
+    }
+}
+
+bool ControlServer::handle_input(Client &client)
+{
+    char buffer[512];
+    const ssize_t n = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+    if (n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+
+    if (n == 0)
+        return false;
+
+    client.received.append(buffer, n);
+
+    size_t end;
+
+    while ((end = client.received.find('\n')) != std::string::npos)
+    {
+        std::string command = client.received.substr(0, end);
+        client.received.erase(0, end + 1);
+
+        if (!command.empty() && command.back() == '\r')
+            command.pop_back();
+
+        if (command.empty())
+            continue;
+
+        std::string reply;
+
+        try
+        {
+            reply = _handler(command);
+        }
+        catch (const std::exception &e)
+        {
+            reply = std::string("error: ") + e.what();
+        }
+
+        if (!reply.empty() && reply.back() != '\n')
+            reply += '\n';
+
+        reply += '\n';
+
+        // replies are short, the socket buffer takes them without waiting
+        if (send(client.fd, reply.data(), reply.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(reply.size()))
+            return false;
+    }
+
+    return client.received.size() <= CONTROL_MAX_LINE;
+}
@@ -0,0 +1,436 @@
+/**
+ * @file CrossCorrelator.cpp
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include "easylogging++.h"
+#include "utils/linux_scheduling.h"
+#include "utils/ComplexNeon.h"
+
+#include "Ads1258.h"
+#include "CrossCorrelator.h"
+
+CrossCorrelator::CrossCorrelator()
+{
+}
+
+CrossCorrelator::~CrossCorrelator()
+{
+    stop();
+    release_plans();
+}
+
+void CrossCorrelator::release_plans(void)
+{
+    if (_forward)
+        fftw_destroy_plan(_forward);
+
+    if (_inverse)
+        fftw_destroy_plan(_inverse);
+
+    fftw_free(_fft_in);
+    fftw_free(_fft_out);
+
+    _forward = nullptr;
+    _inverse = nullptr;
+    _fft_in = nullptr;
+    _fft_out = nullptr;
+}
+
+void CrossCorrelator::setup(uint16_t n_channels, double sample_rate, const std::vector<ChannelPair> &pairs,
+                            uint32_t window_size, double overlap, double max_lag_seconds, double stack_seconds)
+{
+    if (_run_worker)
+        throw std::runtime_error("cannot set up cross correlation while it is running");
+
+    if (pairs.empty())
+        throw std::invalid_argument("at least one channel pair is required");
+
+    if (window_size < 16 || (window_size & (window_size - 1)))
+        throw std::invalid_argument("window size has to be a power of two of at least 16");
+
+    if (overlap < 0 || overlap >= 1)
+        throw std::invalid_argument("overlap has to be in the range [0, 1)");
+
+    _max_lag = std::lround(max_lag_seconds * sample_rate);
+
+    if (_max_lag >= window_size)
+        throw std::invalid_argument("maximum lag has to be shorter than the window");
+
+    if (stack_seconds * sample_rate < window_size)
+        throw std::invalid_argument("a stack has to contain at least one window");
+
+    release_plans();
+
+    _n_channels = n_channels;
+    _sample_rate = sample_rate;
+    _pairs = pairs;
+
+    _used_channels.clear();
+
+    for (auto [a, b] : pairs)
+    {
+        if (a >= n_channels || b >= n_channels)
+            throw std::invalid_argument("channel pair refers to a channel that is not sampled");
+
+        _used_channels.push_back(a);
+        _used_channels.push_back(b);
+    }
+
+    std::sort(_used_channels.begin(), _used_channels.end());
+    _used_channels.erase(std::unique(_used_channels.begin(), _used_channels.end()), _used_channels.end());
+
+    auto slot = [&](uint16_t channel)
+    {
+        return static_cast<uint16_t>(std::lower_bound(_used_channels.begin(), _used_channels.end(), channel) - _used_channels.begin());
+    };
+
+    _pair_slots.clear();
+
+    for (auto [a, b] : pairs)
+        _pair_slots.push_back({slot(a), slot(b)});
+
+    const size_t n_used = _used_channels.size();
+
+    _window_size = window_size;
+    _fft_size = window_size * 2; // zero padding keeps the circular correlation free of wrap around
+    _n_bins = _fft_size / 2 + 1;
+    _bin_stride = (_n_bins + 3) & ~3u; // keeps every channel slice as aligned as the planned buffer
+    _hop_size = std::max<uint32_t>(1, std::lround(window_size * (1 - overlap)));
+    _frames_per_stack = std::llround(stack_seconds * sample_rate);
+
+    _rings.assign(n_used, SampleRing<double>(window_size));
+    _pending.assign(n_used * window_size, 0.0);
+    _segment.assign(n_used * window_size, 0.0);
+    _pending_ready = false;
+    _dropped_windows = 0;
+    _end_stack = false;
+
+    _fft_in = fftw_alloc_real(_fft_size);
+    _fft_out = fftw_alloc_complex(_bin_stride * n_used);
+
+    // every channel spectrum is written into its own slice of _fft_out with the same plan
+    _forward = fftw_plan_dft_r2c_1d(_fft_size, _fft_in, _fft_out, FFTW_MEASURE);
+    _inverse = fftw_plan_dft_c2r_1d(_fft_size, _fft_out, _fft_in, FFTW_MEASURE);
+
+    if (!_forward || !_inverse)
+        throw std::runtime_error("could not create fft plans");
+
+    _stack.assign(_pairs.size() * _n_bins * 2, 0.0);
+    _stack_count.assign(_pairs.size(), 0);
+
+    _frames_since_window = 0;
+    _frames_total = 0;
+    _sequence_known = false;
+
+    LOG(INFO) << "cross correlating " << _pairs.size() << " channel pairs over " << window_size << " sample windows";
+}
+
+void CrossCorrelator::set_output_path(const std::filesystem::path &path)
+{
+    _output_path = path;
+}
+
+void CrossCorrelator::set_start_time(const std::chrono::system_clock::time_point &start_time)
+{
+    _start_time = start_time;
+    _frames_total = 0;
+    _sequence_known = false;
+}
+
+void CrossCorrelator::start(int core_id)
+{
+    if (!_forward)
+        throw std::runtime_error("cross correlation is not set up");
+
+    if (_run_worker)
+        return;
+
+    _run_worker = true;
+
+    _worker = std::thread([this, core_id]()
+                          {
+        if (core_id >= 0)
+        {
+            try
+            {
+                set_thread_affinity(core_id);
+            }
+            catch (const std::exception &e)
+            {
+                LOG(WARNING) << "cross correlation: " << e.what();
+            }
+        }
+
+        worker_func(); });
+}
+
+void CrossCorrelator::stop(void)
+{
+    if (!_worker.joinable())
+        return;
+
+    {
+        std::lock_guard lock(_mtx);
+        _run_worker = false;
+    }
+
+    _cv.notify_one();
+
+    _worker.join();
+}
+
+void CrossCorrelator::consume(const std::shared_ptr<const SampleBlock> &block)
+{
+    if (_sequence_known && block->sequence != _next_sequence)
+        skip_gap(block->sequence - _next_sequence, block->first_sample > _next_sample ? block->first_sample - _next_sample : 0);
+
+    _sequence_known = true;
+    _next_sequence = block->sequence + 1;
+    _next_sample = block->first_sample + block->n_frames();
+
+    const std::span<const int32_t> samples(block->samples);
+
+    for (size_t offset = 0; offset + block->n_channels <= samples.size(); offset += block->n_channels)
+        push_frame(samples.subspan(offset, block->n_channels));
+}
+
+void CrossCorrelator::skip_gap(uint64_t missed_blocks, uint64_t missed_frames)
+{
+    LOG(WARNING) << "cross correlation missed " << missed_blocks << " blocks (" << missed_frames << " frames), restarting the windows after the gap";
+
+    for (auto &ring : _rings)
+        ring.clear();
+
+    _frames_since_window = 0;
+
+    // keeps the next stack timestamped at its first frame after the gap
+    _frames_total += missed_frames;
+
+    {
+        std::lock_guard lock(_mtx);
+
+        // a window still waiting would be stacked after the stack is ended, it is dropped instead
+        _pending_ready = false;
+        _end_stack = true;
+    }
+}
+
+void CrossCorrelator::push_frame(std::span<const int32_t> samples)
+{
+    if (samples.size() != _n_channels)
+        throw std::runtime_error("Incorrect number of channels");
+
+    for (size_t u = 0; u < _used_channels.size(); u++)
+        _rings[u].push(samples[_used_channels[u]] * ADC_RAW_TO_DOUBLE_RATIO);
+
+    _frames_total++;
+
+    if (++_frames_since_window < _hop_size || !_rings.front().full())
+        return;
+
+    _frames_since_window = 0;
+
+    {
+        std::lock_guard lock(_mtx);
+
+        if (_pending_ready)
+        {
+            if (++_dropped_windows % 100 == 1)
+                LOG(WARNING) << "cross correlation is falling behind, " << _dropped_windows << " windows skipped";
+
+            return;
+        }
+
+        for (size_t u = 0; u < _rings.size(); u++)
+        {
+            std::span<const double> history = _rings[u].latest(_window_size);
+            std::copy(history.begin(), history.end(), _pending.begin() + u * _window_size);
+        }
+
+        _pending_frame = _frames_total - 1;
+        _pending_ready = true;
+    }
+
+    _cv.notify_one();
+}
+
+void CrossCorrelator::worker_func(void)
+{
+    LOG(INFO) << "cross correlation thread starting";
+
+    std::unique_lock lock(_mtx);
+
+    while (true)
+    {
+        _cv.wait(lock, [&]()
+                 { return _pending_ready || !_run_worker; });
+
+        if (!_pending_ready)
+            break;
+
+        // swapping keeps the producer free to fill the next window while this one is processed
+        std::swap(_pending, _segment);
+        const uint64_t last_frame = _pending_frame;
+        const bool end_stack = _end_stack;
+        _pending_ready = false;
+        _end_stack = false;
+
+        lock.unlock();
+
+        // the windows stacked so far are all from before the gap
+        if (end_stack)
+            write_stack();
+
+        process_segment(last_frame);
+
+        lock.lock();
+    }
+
+    lock.unlock();
+
+    write_stack();
+
+    LOG(INFO) << "cross correlation thread stopped";
+}
+
+void CrossCorrelator::process_segment(uint64_t last_frame)
+{
+    const size_t n_used = _used_channels.size();
+
+    std::vector<double> energy(n_used);
+
+    if (std::all_of(_stack_count.begin(), _stack_count.end(), [](uint32_t n)
+                    { return n == 0; }))
+        _stack_start_frame = last_frame + 1 - _window_size;
+
+    for (size_t u = 0; u < n_used; u++)
+    {
+        const double *segment = _segment.data() + u * _window_size;
+
+        const double mean = std::accumulate(segment, segment + _window_size, 0.0) / _window_size;
+
+        double sum_sq = 0;
+
+        for (uint32_t i = 0; i < _window_size; i++)
+        {
+            _fft_in[i] = segment[i] - mean;
+            sum_sq += _fft_in[i] * _fft_in[i];
+        }
+
+        std::fill(_fft_in + _window_size, _fft_in + _fft_size, 0.0);
+
+        fftw_execute_dft_r2c(_forward, _fft_in, _fft_out + u * _bin_stride);
+
+        energy[u] = sum_sq;
+    }
+
+    for (size_t p = 0; p < _pair_slots.size(); p++)
+    {
+        auto [a, b] = _pair_slots[p];
+
+        if (energy[a] <= 0 || energy[b] <= 0)
+            continue;
+
+        // normalized so the stacked lags are correlation coefficients after the inverse transform
+        const double scale = 1.0 / (std::sqrt(energy[a] * energy[b]) * _fft_size);
+
+        conj_multiply_accumulate(reinterpret_cast<const double *>(_fft_out + a * _bin_stride),
+                                 reinterpret_cast<const double *>(_fft_out + b * _bin_stride),
+                                 _stack.data() + p * _n_bins * 2, scale, _n_bins);
+
+        _stack_count[p]++;
+    }
+
+    _stack_end_frame = last_frame;
+
+    if (_stack_end_frame + 1 - _stack_start_frame >= _frames_per_stack)
+        write_stack();
+}
+
+void CrossCorrelator::write_stack(void)
+{
+    const uint32_t n_stacked = *std::max_element(_stack_count.begin(), _stack_count.end());
+
+    if (n_stacked == 0)
+        return;
+
+    const auto stack_start = _start_time + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                               std::chrono::duration<double>(_stack_start_frame / _sample_rate));
+
+    std::stringstream ss;
+    time_t in_time_t = std::chrono::system_clock::to_time_t(stack_start);
+    ss << std::put_time(std::localtime(&in_time_t), "date-%Y-%m-%d-time-%H-%M-%S");
+
+    // a stack ended early by a gap can start in the same second as the next one
+    std::string file_name = ss.str() + ".xcorr";
+
+    for (int n = 1; std::filesystem::exists(_output_path / file_name); n++)
+        file_name = ss.str() + "-" + std::to_string(n) + ".xcorr";
+
+    std::ofstream file(_output_path / file_name, std::ios::binary);
+
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "could not open cross correlation file " << file_name;
+    }
+    else
+    {
+        const uint32_t n_lags = 2 * _max_lag + 1;
+
+        XcorrHeader header = {
+            .magic = {XCORR_MAGIC[0], XCORR_MAGIC[1], XCORR_MAGIC[2], XCORR_MAGIC[3]},
+            .version = XCORR_VERSION,
+            .n_pairs = static_cast<uint16_t>(_pairs.size()),
+            .window_size = _window_size,
+            .max_lag = _max_lag,
+            .n_lags = n_lags,
+            .n_stacked = n_stacked,
+            .sample_rate = _sample_rate,
+            .start_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stack_start.time_since_epoch()).count(),
+            .duration_s = (_stack_end_frame + 1 - _stack_start_frame) / _sample_rate};
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        for (auto [a, b] : _pairs)
+        {
+            file.write(reinterpret_cast<const char *>(&a), sizeof(a));
+            file.write(reinterpret_cast<const char *>(&b), sizeof(b));
+        }
+
+        std::vector<float> lags(n_lags);
+
+        for (size_t p = 0; p < _pairs.size(); p++)
+        {
+            const double *stack = _stack.data() + p * _n_bins * 2;
+
+            std::copy(stack, stack + _n_bins * 2, reinterpret_cast<double *>(_fft_out));
+
+            fftw_execute(_inverse);
+
+            const double norm = _stack_count[p] ? 1.0 / _stack_count[p] : 0.0;
+
+            for (int32_t l = -static_cast<int32_t>(_max_lag); l <= static_cast<int32_t>(_max_lag); l++)
+                lags[l + _max_lag] = _fft_in[l >= 0 ? l : _fft_size + l] * norm;
+
+            file.write(reinterpret_cast<const char *>(lags.data()), lags.size() * sizeof(float));
+        }
+    }
+
+    std::fill(_stack.begin(), _stack.end(), 0.0);
+    std::fill(_stack_count.begin(), _stack_count.end(), 0);
+}
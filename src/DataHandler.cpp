@@ -9,160 +9,585 @@
  *
  */
 
+#include <array>
 #include <thread>
 #include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <bit>
 #include <ranges>
+#include <algorithm>
 #include <condition_variable>
 
 #include "easylogging++.h"
 #include "utils/linux_scheduling.h"
 
-#include "Iir.h"
-#include "utils/DirectForm2Neon.h"
-
 #include "DataHandler.h"
 
 using namespace std::chrono_literals;
 
+/**
+ * @brief ADC settings for the channels and sample rate of a configuration, the channels of the geophones when it
+ * names none.
+ *
+ * @throws std::invalid_argument when the ADC cannot scan that many channels at the sample rate
+ */
+static AcquisitionPlan acquisition_plan(const RuntimeConfig &config)
+{
+    const ScanChannels channels = config.channels ? *config.channels : geophone_channels(config.n_channels);
+    const double max_rate = plan_acquisition(channels, 0, PlanGoal::MAX_RATE)->sample_rate;
+
+    if (config.sample_rate < 0)
+        throw std::invalid_argument("the sample rate cannot be negative");
+
+    // without a rate the default is taken, as far as the ADC gets with these channels, 5 geophones reach about 1582 Hz
+    const double target_rate = config.sample_rate ? config.sample_rate : std::min(SAMPLE_RATE, max_rate);
+    const std::optional<AcquisitionPlan> plan = plan_acquisition(channels, target_rate, config.rate_goal);
+
+    if (!plan)
+        throw std::invalid_argument((config.channels ? std::to_string(channels.size()) + " channels" : std::to_string(config.n_channels) + " geophones") +
+                                    " can be sampled at " + std::to_string(max_rate) + " Hz at most");
+
+    return *plan;
+}
+
+// the default sample rate gives the settings that were tuned by hand for 1 up to 4 geophones
+static_assert(plan_acquisition(geophone_channels(1), SAMPLE_RATE, PlanGoal::MIN_POWER)->drate == 1 && plan_acquisition(geophone_channels(1), SAMPLE_RATE, PlanGoal::MIN_POWER)->dly == 0);
+static_assert(plan_acquisition(geophone_channels(2), SAMPLE_RATE, PlanGoal::MIN_POWER)->drate == 2 && plan_acquisition(geophone_channels(2), SAMPLE_RATE, PlanGoal::MIN_POWER)->dly == 2);
+static_assert(plan_acquisition(geophone_channels(3), SAMPLE_RATE, PlanGoal::MIN_POWER)->drate == 3 && plan_acquisition(geophone_channels(3), SAMPLE_RATE, PlanGoal::MIN_POWER)->dly == 1);
+static_assert(plan_acquisition(geophone_channels(4), SAMPLE_RATE, PlanGoal::MIN_POWER)->drate == 3 && plan_acquisition(geophone_channels(4), SAMPLE_RATE, PlanGoal::MIN_POWER)->dly == 0);
+
+// direct reads need the STATUS byte to place every conversion and to drop repeated reads
+static_assert(AcquisitionPlan{.channels = geophone_channels(1)}.registers()[RegisterAdressses::CONFIG0] & 1 << 1);
+
+constexpr uint32_t ADC_STALL_SCANS = 10;   ///< Scan periods without new data before the ADC counts as stalled.
+constexpr auto ADC_STALL_MIN = 5ms;        ///< Shortest stall timeout, so a busy SPI bus is not taken for a stall.
+constexpr uint32_t ADC_FOREIGN_WINDOW = 4; ///< Scans over which samples of channels outside the scan are counted.
+constexpr uint32_t ADC_FOREIGN_LIMIT = 3;  ///< Samples of channels outside the scan within the window that trigger a recovery.
+constexpr uint32_t ADC_RECOVERY_TRIES = 3; ///< Resets per recovery attempt.
+constexpr auto ADC_RECOVERY_RETRY = 1s;    ///< Pause before the next attempt when the ADC could not be brought back.
+
 DataHandler::DataHandler() : _adc("/dev/spidev0.0", "/dev/gpiochip0")
 {
 }
 
 DataHandler::~DataHandler()
 {
-    _writer.close_file();
-}
-
-void DataHandler::setup_adc(const uint32_t n_channels, const uint32_t max_tries)
-{
-    uint32_t tries = 0;
-
-    uint16_t dly = 0, speed = 0, channels = 0, sample_speed = 0, delay = 0;
-
-    switch (n_channels)
-    {
-    case 1:
-        dly = DelayConfig::DLY_0us;
-        speed = DrateConfig::DRATE_1;
-        channels = 0b1110000000000000;
-        sample_speed = AUTO_DRATE1;
-        delay = DLY0;
-        break;
-    case 2:
-        dly = DelayConfig::DLY_16us;
-        speed = DrateConfig::DRATE_2;
-        channels = 0b1111110000000000;
-        sample_speed = AUTO_DRATE2;
-        delay = DLY2;
-        break;
-    case 3:
-        dly = DelayConfig::DLY_8us;
-        speed = DrateConfig::DRATE_3;
-        channels = 0b1111111110000000;
-        sample_speed = AUTO_DRATE3;
-        delay = DLY1;
-        break;
-    case 4:
-        dly = DelayConfig::DLY_0us;
-        speed = DrateConfig::DRATE_3;
-        channels = 0b1111111111110000;
-        sample_speed = AUTO_DRATE3;
-        delay = DLY0;
-        break;
-    default:
-        throw std::invalid_argument("n_channels has to be between 1 and 4");
-        break;
+    _sinks.stop();
+    _qc.close_file();
+}
+
+void DataHandler::setup_adc(const AcquisitionPlan &plan, const uint32_t max_tries)
+{
+    const auto begin = std::chrono::steady_clock::now();
+
+    _adc.initialize(plan.registers(), max_tries);
+
+    std::lock_guard lock(_config_mtx);
+
+    _plan = plan;
+    _active_channels = _adc.get_active_channels();
+    _n_active_channels = _active_channels.size();
+
+    _sample_rate = plan.sample_rate;
+
+    LOG(INFO) << "will sample " << (uint32_t)_n_active_channels << " channels at " << _sample_rate << "Hz with DRATE "
+              << (uint32_t)plan.drate << " and DLY " << (uint32_t)plan.dly << ", " << plan.scan_skew * 1e6
+              << " us from the first to the last channel, adc set up in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() << " ms";
+}
+
+void DataHandler::recover_adc(const RegisterImage &registers, const std::string &reason, const std::chrono::steady_clock::time_point &last_sample)
+{
+    const auto detected = std::chrono::steady_clock::now();
+
+    LOG(WARNING) << "adc " << reason << ", setting it up again";
+
+    while (_run_irq_thread)
+    {
+        try
+        {
+            _adc.start(false);
+
+            // registers changed by a glitch only need to be written again, a brown-out needs a full reset
+            _adc.write_registers(registers);
+
+            if (!_adc.verify_settings())
+                _adc.initialize(registers, ADC_RECOVERY_TRIES);
+
+            _adc.start(true);
+            break;
+        }
+        catch (const std::exception &e)
+        {
+            LOG(ERROR) << "adc recovery failed: " << e.what() << ", trying again in "
+                       << std::chrono::duration_cast<std::chrono::seconds>(ADC_RECOVERY_RETRY).count() << " s";
+
+            std::this_thread::sleep_for(ADC_RECOVERY_RETRY);
+        }
     }
 
-    do
+    if (!_run_irq_thread)
+        return;
+
+    const auto resumed = std::chrono::steady_clock::now();
+
+    std::lock_guard lock(_mailbox_mtx);
+
+    _adc_gaps.push_back({resumed - last_sample, resumed - detected, reason});
+    _raw_data_queue.push_back({ADC_GAP_CHANNEL, 0, 0});
+}
+
+void DataHandler::record_gap(const AdcGap &gap, const std::chrono::system_clock::time_point &start, uint64_t frames)
+{
+    const double recovery_ms = std::chrono::duration<double, std::milli>(gap.recovery).count();
+    const auto end = start + std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(frames / _sample_rate));
+
+    auto format_time = [](const std::chrono::system_clock::time_point &time)
     {
-        _adc.pwdn(true);
-        _adc.reset(true);
+        std::stringstream ss;
+        time_t in_time_t = std::chrono::system_clock::to_time_t(time);
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000;
+        ss << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S") << '.' << std::setfill('0') << std::setw(3) << ms;
+        return ss.str();
+    };
 
-        std::this_thread::sleep_for(200ms);
+    LOG(WARNING) << "adc recovered in " << recovery_ms << " ms, filled in " << frames << " frames from " << format_time(start)
+                 << " to " << format_time(end);
 
-        _adc.pwdn(false);
+    {
+        std::lock_guard lock(_health_mtx);
 
-        std::this_thread::sleep_for(200ms);
+        _health.recoveries++;
+        _health.missed_frames += frames;
+        _health.last_recovery_ms = recovery_ms;
+        _health.longest_recovery_ms = std::max(_health.longest_recovery_ms, recovery_ms);
+        _health.last_recovery = end;
+    }
 
-        _adc.reset(false);
+    std::stringstream line;
 
-        std::this_thread::sleep_for(200ms);
+    line << format_time(start) << ',' << format_time(end) << ',' << frames << ','
+         << std::chrono::duration<double, std::milli>(gap.stalled).count() << ',' << recovery_ms << ',' << gap.reason << '\n';
 
-        _adc.enable_sleep_mode(false);
-        _adc.enable_bypass(false);
-        _adc.enable_status(true);
-        _adc.enable_external_clock(false);
-        _adc.enable_auto(true);
+    // the data path can sit on a slow card, the storing thread only queues the line
+    _gap_log.run([log_path = _config.data_path / "adc_recoveries.csv", line = line.str()]()
+                 {
+                     const bool new_log = !std::filesystem::exists(log_path);
 
-        _adc.set_drate(speed);
-        _adc.set_delay(dly);
-        _adc.set_auto_single_channel({.raw_data = channels});
+                     std::ofstream log(log_path, std::ios::app);
 
-        if (_adc.verify_settings())
-            break;
-        else
-            tries++;
+                     if (!log)
+                     {
+                         LOG(ERROR) << "could not write " << log_path;
+                         return;
+                     }
+
+                     if (new_log)
+                         log << "start,end,missing_frames,stalled_ms,recovery_ms,reason\n";
 
-        LOG(WARNING) << "tried setting up adc " << tries << " times";
+                     log << line; });
+}
 
-    } while (tries < max_tries);
+void DataHandler::reconfigure_adc(const AcquisitionPlan &plan)
+{
+    const auto begin = std::chrono::steady_clock::now();
 
-    if (tries >= max_tries)
-        throw std::runtime_error("could not setup adc");
+    // the ADC keeps its other settings, only the scanned channels and their timing change while it is stopped
+    _adc.start(false);
+
+    _adc.write_registers(plan.registers());
+
+    if (!_adc.verify_settings())
+    {
+        LOG(WARNING) << "adc did not take the new channels, setting it up again";
 
+        setup_adc(plan);
+        return;
+    }
+
+    std::lock_guard lock(_config_mtx);
+
+    _plan = plan;
     _active_channels = _adc.get_active_channels();
     _n_active_channels = _active_channels.size();
 
-    _sample_rate = channel_drate_delay_to_frequency(_n_active_channels, sample_speed, delay);
+    _sample_rate = plan.sample_rate;
+
+    LOG(INFO) << "switched to " << (uint32_t)_n_active_channels << " channels at " << _sample_rate << "Hz with DRATE "
+              << (uint32_t)plan.drate << " and DLY " << (uint32_t)plan.dly << " in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() << " ms";
+}
+
+void DataHandler::configure(const RuntimeConfig &config)
+{
+    check_config(config);
+
+    prepare_data_path(config.data_path);
+    setup_adc(acquisition_plan(config));
+
+    std::lock_guard lock(_config_mtx);
+
+    _config = config;
+}
+
+void DataHandler::reconfigure(const RuntimeConfig &config)
+{
+    check_config(config);
+
+    std::lock_guard lock(_config_mtx);
+
+    _pending_config = config;
+}
+
+void DataHandler::check_config(const RuntimeConfig &config) const
+{
+    // the rate follows from the channels, so the low-pass can be checked before the ADC changes
+    const AcquisitionPlan plan = acquisition_plan(config);
+    const double rate = plan.sample_rate;
+
+    if (config.data_path.empty())
+        throw std::invalid_argument("the data path cannot be empty");
+
+    if (config.file_duration.count() <= 0)
+        throw std::invalid_argument("data files need a positive length");
+
+    if (config.lowpass_frequency < 0 || config.lowpass_frequency >= rate / 2)
+        throw std::invalid_argument("low-pass frequency has to be below the nyquist frequency of " + std::to_string(rate / 2) + " Hz");
+
+    if (config.qc_interval && *config.qc_interval <= 0)
+        throw std::invalid_argument("quality control intervals need a positive length");
 
-    LOG(INFO) << "will sample " << (uint32_t)_n_active_channels << " channels at " << _sample_rate << "Hz";
+    if (config.shared_memory && config.shared_memory->seconds <= 0)
+        throw std::invalid_argument("the shared memory ring needs a positive length");
 
-    _n_samples_per_file = _sample_rate * 30;
+    if (_output_format == OutputFormat::MINISEED && !_seed_codes.channels.empty() && _seed_codes.channels.size() != plan.channels.size())
+        throw std::invalid_argument("the SEED channel codes are for " + std::to_string(_seed_codes.channels.size()) + " channels");
+}
+
+RuntimeConfig DataHandler::config(void)
+{
+    std::lock_guard lock(_config_mtx);
 
-    _writer.set_n_channels(_n_active_channels);
-    _writer.set_bits_per_sample(24);
-    _writer.set_sample_rate(_sample_rate);
+    return _config;
 }
 
-void DataHandler::set_data_path(std::filesystem::path path)
+double DataHandler::sample_rate(void)
 {
-    if (std::filesystem::is_directory(path))
+    std::lock_guard lock(_config_mtx);
+
+    return _sample_rate;
+}
+
+AdcHealth DataHandler::adc_health(void)
+{
+    std::lock_guard lock(_health_mtx);
+
+    return _health;
+}
+
+SignalProcessorConfig DataHandler::processing_config(void) const
+{
+    SignalProcessorConfig processing;
+    processing.lowpass_frequency = _config.lowpass_frequency;
+    processing.response_extension = _config.response_extension && !_raw_mode;
+    processing.response = _config.response_extension.value_or(ResponseExtensionConfig{});
+
+    // raw mode leaves out the filters, gaps are only filled in for the statistics
+    if (_raw_mode)
+        processing.lowpass_frequency = 0;
+
+    return processing;
+}
+
+void DataHandler::create_writer(void)
+{
+    _n_samples_per_file = std::ceil(_sample_rate * _config.file_duration.count());
+
+    std::unique_ptr<RecordingWriter> file_writer;
+
+    if (_output_format == OutputFormat::FLAC)
     {
-        _data_path = path;
+        file_writer = std::make_unique<FlacWriter>();
+    }
+    else if (_output_format == OutputFormat::MINISEED)
+    {
+        auto writer = std::make_unique<MiniSeedWriter>(_seed_codes, _seed_record_length);
+
+        // the start time of every record follows from the exact rate
+        writer->set_exact_sample_rate(_sample_rate);
+
+        file_writer = std::move(writer);
+    }
+    else if (_output_format == OutputFormat::ARCHIVE)
+    {
+        auto writer = std::make_unique<ArchiveWriter>();
+
+        uint32_t channel_mask = 0;
+
+        for (uint8_t channel : _active_channels)
+            channel_mask |= 1u << channel;
+
+        writer->set_exact_sample_rate(_sample_rate);
+        writer->set_channel_mask(channel_mask);
+        writer->set_raw(_raw_mode);
+
+        file_writer = std::move(writer);
     }
     else
     {
-        if (std::filesystem::create_directory(path))
-        {
-            _data_path = path;
-        }
-        else
-        {
-            throw std::runtime_error("Could not create file directory for data");
-        }
+        auto writer = std::make_unique<WAVWriter>();
+
+        if (_mapped_files)
+            writer->set_mode(WAVWriter::Mode::MAPPED, _n_samples_per_file);
+
+        file_writer = std::move(writer);
     }
+
+    file_writer->set_n_channels(_n_active_channels);
+    file_writer->set_bits_per_sample(24);
+
+    if (_output_format != OutputFormat::MINISEED && _output_format != OutputFormat::ARCHIVE)
+        file_writer->set_sample_rate(_sample_rate);
+
+    file_writer->set_commit_interval(std::ceil(_commit_seconds * _sample_rate));
+
+    _recording = std::make_unique<RecordingSink>(std::move(file_writer), _config.data_path);
 }
 
-void DataHandler::new_file(void)
+void DataHandler::setup_sinks(const std::chrono::system_clock::time_point &start)
 {
-    _writer.close_file();
+    _sinks.clear();
+
+    // storage must not lose data, acquisition waits for it once a minute of blocks is queued
+    _sinks.add(*_recording, {.max_backlog = 64, .overflow = SinkOptions::Overflow::WAIT});
+
+    if (_config.stream)
+        start_stream_server();
 
-    std::stringstream ss;
-    time_t in_time_t = std::chrono::system_clock::to_time_t(_current_timestamp);
-    ss << std::put_time(std::localtime(&in_time_t), "date-%Y-%m-%d-time-%H-%M-%S.wav");
+    if (_config.shared_memory)
+        start_shm_ring(start);
 
-    _writer.open_file(_data_path.string() + "/" + ss.str());
-    _current_filename = ss.str();
+    if (_config.spectrum)
+        start_spectrum(start);
 
-    _writer.set_datetime(_current_timestamp);
+    if (_config.correlation)
+        start_correlator(start);
 }
 
-void DataHandler::delete_last_file(void)
+void DataHandler::start_spectrum(const std::chrono::system_clock::time_point &start)
+{
+    try
+    {
+        _spectrum.setup(_n_active_channels, _sample_rate, _config.spectrum->fft_size, 0.5, _config.spectrum->tile_seconds);
+        _spectrum.set_output_path(_config.data_path);
+        _spectrum.set_start_time(start);
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << "spectra disabled: " << e.what();
+
+        std::lock_guard lock(_config_mtx);
+        _config.spectrum.reset();
+        return;
+    }
+
+    // products averaged over minutes skip blocks rather than delay the recording
+    _sinks.add(_spectrum, {.max_backlog = 64});
+}
+
+void DataHandler::start_correlator(const std::chrono::system_clock::time_point &start)
+{
+    const CorrelationSettings &settings = *_config.correlation;
+
+    try
+    {
+        _correlator.setup(_n_active_channels, _sample_rate, settings.pairs, settings.window, 0.5, settings.max_lag_seconds, settings.stack_seconds);
+        _correlator.set_output_path(_config.data_path);
+        _correlator.set_start_time(start);
+        _correlator.start(2);
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << "cross correlation disabled: " << e.what();
+
+        std::lock_guard lock(_config_mtx);
+        _config.correlation.reset();
+        return;
+    }
+
+    _sinks.add(_correlator, {.max_backlog = 64});
+}
+
+void DataHandler::start_stream_server(void)
+{
+    const StreamSettings &settings = *_config.stream;
+
+    try
+    {
+        _stream_server = std::make_unique<StreamServer>(settings.port, settings.ring_blocks, settings.policy);
+        _stream_server->start();
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << "streaming disabled: " << e.what();
+        _stream_server.reset();
+
+        std::lock_guard lock(_config_mtx);
+        _config.stream.reset();
+        return;
+    }
+
+    // the live outputs have their own buffers, only a few blocks wait in front of them
+    _sinks.add(*_stream_server, {.max_backlog = 4});
+}
+
+void DataHandler::start_shm_ring(const std::chrono::system_clock::time_point &start)
+{
+    const SharedMemorySettings &settings = *_config.shared_memory;
+
+    try
+    {
+        _shm_ring = std::make_unique<ShmRingWriter>(settings.name);
+        _shm_ring->open(_n_active_channels, std::max<uint64_t>(1, std::llround(settings.seconds * _sample_rate)));
+        _shm_ring->start_stream(_sample_rate, std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count());
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << "shared memory ring disabled: " << e.what();
+        _shm_ring.reset();
+
+        std::lock_guard lock(_config_mtx);
+        _config.shared_memory.reset();
+        return;
+    }
+
+    _sinks.add(*_shm_ring, {.max_backlog = 4});
+}
+
+void DataHandler::enable_flac(void)
+{
+    _output_format = OutputFormat::FLAC;
+}
+
+void DataHandler::enable_miniseed(const SeedCodes &codes, uint32_t record_length)
+{
+    if (!codes.channels.empty() && codes.channels.size() != _n_active_channels)
+    {
+        LOG(ERROR) << "got " << codes.channels.size() << " SEED channel codes for " << (uint32_t)_n_active_channels << " channels, writing WAV files instead";
+        return;
+    }
+
+    if (record_length != 512 && record_length != 4096)
+    {
+        LOG(ERROR) << "MiniSEED record length has to be 512 or 4096 bytes, writing WAV files instead";
+        return;
+    }
+
+    _seed_codes = codes;
+    _seed_record_length = record_length;
+    _output_format = OutputFormat::MINISEED;
+}
+
+void DataHandler::enable_archive(void)
+{
+    _output_format = OutputFormat::ARCHIVE;
+}
+
+void DataHandler::enable_raw_mode(void)
+{
+    if (_output_format != OutputFormat::ARCHIVE)
+    {
+        LOG(ERROR) << "raw mode needs archive files to keep the STATUS flags, storing filtered data instead";
+        return;
+    }
+
+    if (_config.response_extension)
+        LOG(WARNING) << "the response extension is not applied in raw mode";
+
+    _raw_mode = true;
+}
+
+void DataHandler::stop(void)
+{
+    _run_storing_thread = false;
+
+    _cv_raw_data.notify_one();
+}
+
+void DataHandler::prepare_data_path(const std::filesystem::path &path)
+{
+    if (!std::filesystem::is_directory(path) && !std::filesystem::create_directories(path))
+        throw std::runtime_error("Could not create file directory for data");
+
+    recover_last_file(path);
+}
+
+void DataHandler::recover_last_file(const std::filesystem::path &path)
+{
+    std::filesystem::path last_file;
+    std::vector<std::filesystem::path> prepared;
+
+    // file names sort chronologically, only the newest file can have been interrupted, files that were prepared
+    // for the next boundary but never opened hold no data and are left out
+    for (const auto &entry : std::filesystem::directory_iterator(path))
+    {
+        if (!entry.is_regular_file())
+            continue;
+
+        if (entry.path().extension() == WAVWriter::PREPARED_SUFFIX)
+            prepared.push_back(entry.path());
+        else if ((entry.path().extension() == ".wav" || entry.path().extension() == ".drga") &&
+                 entry.path().filename() > last_file.filename())
+            last_file = entry.path();
+    }
+
+    for (const auto &file : prepared)
+    {
+        std::error_code error;
+
+        if (std::filesystem::remove(file, error))
+            LOG(INFO) << "removed " << file.filename() << ", it was prepared but never written";
+    }
+
+    if (last_file.empty())
+        return;
+
+    try
+    {
+        const bool repaired = last_file.extension() == ".drga" ? ArchiveWriter::recover_file(last_file.string())
+                                                               : WAVWriter::recover_file(last_file.string());
+
+        if (repaired)
+            LOG(WARNING) << "repaired " << last_file.filename() << ", it was not closed properly";
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << e.what();
+    }
+}
+
+void DataHandler::set_commit_interval(double seconds)
+{
+    _commit_seconds = seconds;
+}
+
+void DataHandler::enable_mapped_files(void)
 {
-    _writer.close_file();
+    _mapped_files = true;
+}
 
-    std::remove(_current_filename.c_str());
+void DataHandler::enable_direct_read(void)
+{
+    _direct_read = true;
+}
+
+void DataHandler::delete_last_file(void)
+{
+    if (_recording)
+        _recording->delete_last_file();
 }
 
 void DataHandler::irq_thread_start(void)
@@ -176,7 +601,8 @@ void DataHandler::irq_thread_stop(void)
 {
     _run_irq_thread = false;
 
-    _irq_thread.join();
+    if (_irq_thread.joinable())
+        _irq_thread.join();
 }
 
 void DataHandler::storing_thread_start(void)
@@ -206,53 +632,130 @@ void DataHandler::irq_thread_func(void)
 
     // auto t_now = std::chrono::system_clock::now(), t_prev = t_now;
 
-    constexpr int64_t sample_period_ns = std::ceil(1e9 / drate_delay_to_frequency(AUTO_DRATE3, DLY0));
-
     std::this_thread::sleep_for(1us);
 
-    ChannelData previous;
+    // the watchdog needs the scan the ADC was set up for, it does not change while this thread runs
+    const RegisterImage registers = _plan.registers();
+    const uint32_t n_scanned = _active_channels.size();
+    const auto stall_timeout = std::max<std::chrono::steady_clock::duration>(
+        ADC_STALL_MIN, std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(ADC_STALL_SCANS / sample_rate())));
 
-    uint32_t i = 0, wrong_data = 0;
+    uint32_t scanned_mask = 0;
+    std::array<uint8_t, 32> scan_position;
+    scan_position.fill(0xFF);
+
+    for (uint32_t n = 0; n < n_scanned; n++)
+    {
+        scanned_mask |= 1u << _active_channels[n];
+        scan_position[_active_channels[n]] = n;
+    }
+
+    uint8_t last_position = 0xFF;
+    uint32_t missed_conversions = 0;
+
+    auto last_sample = std::chrono::steady_clock::now();
+    uint32_t window_samples = 0, foreign_samples = 0;
+
+    auto recover = [&](const std::string &reason)
+    {
+        recover_adc(registers, reason, last_sample);
+
+        last_sample = std::chrono::steady_clock::now();
+        window_samples = foreign_samples = 0;
+        last_position = 0xFF;
+    };
+
+    // direct reads take a whole scan per batch, one conversion per DRDY edge, the read command two conversions per transaction
+    const auto conversion_period = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1 / (sample_rate() * n_scanned)));
+
+    std::vector<ChannelData> batch(_direct_read ? n_scanned : 2);
+    std::vector<ChannelData> fresh;
+    fresh.reserve(batch.size());
 
     while (_run_irq_thread)
     {
 
-        std::pair<ChannelData, ChannelData> current;
+        size_t n_read = 0;
 
         try
         {
-            current = _adc.get_data_read();
+            if (_direct_read)
+            {
+                n_read = _adc.get_data_direct(batch, conversion_period);
+            }
+            else
+            {
+                std::tie(batch[0], batch[1]) = _adc.get_data_read();
+                n_read = 2;
+            }
         }
         catch (const std::exception &e)
         {
             LOG(ERROR) << e.what();
+        }
+
+        // reading clears NEW, so every conversion is taken once, a repeated or stale read comes without it
+        fresh.clear();
+
+        for (size_t n = 0; n < n_read; n++)
+        {
+            if (!(batch[n].flags & SAMPLE_NEW))
+                continue;
 
-            current = {{0, 0}, {0, 0}};
+            fresh.push_back(batch[n]);
+
+            // the scan runs in a fixed order, a channel jumped over had its conversion overwritten before it was read
+            const uint8_t position = scan_position[batch[n].channel & 0x1F];
+
+            if (position != 0xFF && last_position != 0xFF)
+                missed_conversions += (position + n_scanned - last_position - 1) % n_scanned;
+
+            last_position = position;
         }
 
-        auto [a, b] = current;
+        if (missed_conversions >= 1000)
+        {
+            LOG(WARNING) << missed_conversions << " conversions were overwritten before they were read";
+            missed_conversions = 0;
+        }
 
-        if (a.first == b.first && a.second != b.second)
+        if (fresh.empty())
         {
-            if(wrong_data > 1000) {
-                LOG_EVERY_N(1000, WARNING) << "1000 missed packages";
-                wrong_data = 0;
-            }
-            else
-                wrong_data++;
+            // only a poll without new data can reveal a stall, a poll delayed by the scheduler returns new data
+            if (std::chrono::steady_clock::now() - last_sample > stall_timeout)
+                recover("stopped delivering data");
 
             continue;
         }
 
-        if (previous == a)
+        bool recovered = false;
+
+        for (size_t n = 0; n < fresh.size(); n++)
+        {
+            // after a brown-out the ADC runs on its reset registers and scans channels it was not set up for
+            if (!((scanned_mask >> fresh[n].channel) & 1))
+                foreign_samples++;
+
+            if (++window_samples >= ADC_FOREIGN_WINDOW * n_scanned)
+                window_samples = foreign_samples = 0;
+
+            if (foreign_samples >= ADC_FOREIGN_LIMIT)
+            {
+                recover("scanned channels outside its scan");
+                recovered = true;
+                break;
+            }
+        }
+
+        if (recovered)
             continue;
 
-        previous = a;
+        last_sample = std::chrono::steady_clock::now();
 
 
         std::unique_lock lock(_mailbox_mtx);
 
-        _raw_data_queue.push_back(a);
+        _raw_data_queue.insert(_raw_data_queue.end(), fresh.begin(), fresh.end());
 
         if (_raw_data_queue.size() >= 4000)
         {
@@ -261,6 +764,7 @@ void DataHandler::irq_thread_func(void)
     }
 }
 
+
 void DataHandler::storing_thread_func(void)
 {
     set_thread_priority(99, SCHED_OTHER);
@@ -268,32 +772,313 @@ void DataHandler::storing_thread_func(void)
 
     LOG(INFO) << "processing thread starting";
 
+    {
+        std::lock_guard lock(_health_mtx);
+
+        _health.started = std::chrono::system_clock::now();
+    }
+
+    // main runs this function on its own thread as well, so the log is started here and not with the thread
+    _gap_log.start();
+
+    // a change of channels ends the stream, the ADC is switched over before the next one starts
+    while (process_stream())
+    {
+        irq_thread_stop();
+
+        {
+            std::lock_guard lock(_mailbox_mtx);
+
+            _raw_data_queue.clear();
+            _adc_gaps.clear();
+        }
+
+        reconfigure_adc(acquisition_plan(_config));
+
+        irq_thread_start();
+    }
+
+    // every queued recovery is in the log before the thread ends
+    _gap_log.stop();
+
+    LOG(INFO) << "processing thread stopped";
+}
+
+bool DataHandler::process_stream(void)
+{
     _current_timestamp = std::chrono::system_clock::now();
 
-    uint32_t sample_counter = 0;
+    const auto stream_start = _current_timestamp;
+    const AcquisitionPlan plan = _plan;
+    uint64_t frame_index = 0;
+
+    // first frame at or after a point in time, counted from the start so file lengths do not drift from the data
+    auto frame_at = [&](const std::chrono::system_clock::time_point &time)
+    {
+        return static_cast<uint64_t>(std::ceil(std::chrono::duration<double>(time - stream_start).count() * _sample_rate));
+    };
+
+    auto frame_time = [&](uint64_t frame)
+    {
+        return stream_start + std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(frame / _sample_rate));
+    };
+
+    auto to_ns = [](const std::chrono::system_clock::time_point &time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    };
+
+    // files start on wall-clock multiples of their length
+    auto boundary_after = [&](const std::chrono::system_clock::time_point &time)
+    {
+        const auto since_epoch = std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch());
+        return std::chrono::system_clock::time_point((since_epoch / _config.file_duration + 1) * _config.file_duration);
+    };
+
+    // the first file runs up to the next wall-clock boundary, every following file covers exactly the file duration
+    auto file_start = stream_start;
+    std::chrono::system_clock::time_point next_boundary = boundary_after(stream_start);
+    uint64_t rotation_frame = frame_at(next_boundary);
+
+    {
+        std::lock_guard lock(_health_mtx);
+
+        // the flag counters belong to the channels, they start over when the channels change
+        if (_health.overflow_samples.size() != _n_active_channels)
+        {
+            _health.overflow_samples.assign(_n_active_channels, 0);
+            _health.supply_samples.assign(_n_active_channels, 0);
+        }
+    }
 
-    std::vector<Iir::ChebyshevII::LowPass<20, Iir::DirectFormIINeon>> filters(_n_active_channels);
+    // lives as long as the stream, so the filter state carries over file boundaries
+    SignalProcessor processor;
+    processor.setup(_n_active_channels, _sample_rate, processing_config());
 
-    for (auto &filter : filters)
+    if (_config.qc_interval)
     {
-        filter.setup(_sample_rate, 450, 60);
-        filter.reset();
+        _qc.setup(_n_active_channels, _sample_rate, *_config.qc_interval);
+        _qc.set_start_time(_current_timestamp);
     }
 
-    new_file();
+    create_writer();
+    setup_sinks(stream_start);
+    _sinks.start();
+
+    // the quality control rows follow the data files, so their files rotate here together with the blocks
+    auto open_qc_file = [&](const std::chrono::system_clock::time_point &start)
+    {
+        if (_config.qc_interval)
+            _qc.open_file((_config.data_path / _recording->file_name(start)).replace_extension(".qc.csv"));
+    };
+
+    open_qc_file(stream_start);
 
     std::deque<std::vector<int32_t>> sorted_sample_queue;
+    std::deque<FrameFlags> sorted_flags_queue;
+
+    // frames are collected into a block that every output shares, it is never copied once published
+    std::vector<int32_t> block;
+    std::vector<FrameStatus> block_status;
+    block.reserve(_n_active_channels * 1000);
+
+    // channels with filled in samples somewhere in the block
+    uint32_t block_gaps = 0;
+
+    uint64_t block_sequence = 0;
 
-    std::vector<int32_t> prev_sample(_n_active_channels);
+    // start of the data file the next block begins, 0 while it continues the open file
+    int64_t file_start_ns = to_ns(stream_start);
+
+    auto flush_block = [&]()
+    {
+        const uint32_t n_frames = block.size() / _n_active_channels;
+
+        if (!n_frames)
+            return;
+
+        const uint64_t first_frame = frame_index - n_frames;
+
+        auto shared = std::make_shared<SampleBlock>();
+        shared->sequence = block_sequence++;
+        shared->start_time_ns = to_ns(frame_time(first_frame));
+        shared->first_sample = first_frame;
+        shared->sample_rate = _sample_rate;
+        shared->n_channels = _n_active_channels;
+        shared->gap_mask = block_gaps;
+        shared->samples = std::move(block);
+        shared->status = std::move(block_status);
+        shared->file_start_ns = file_start_ns;
+        shared->next_file_start_ns = file_start_ns ? to_ns(next_boundary) : 0;
+
+        _sinks.publish(std::move(shared));
+
+        block = std::vector<int32_t>();
+        block.reserve(_n_active_channels * 1000);
+        block_status.clear();
+        block_gaps = 0;
+        file_start_ns = 0;
+    };
+
+    // new settings are applied between blocks, so every output sees whole blocks and no frame is skipped
+    auto apply_config = [&](RuntimeConfig next)
+    {
+        const RuntimeConfig previous = _config;
+        const auto now = frame_time(frame_index);
+
+        if (next.data_path != previous.data_path)
+        {
+            try
+            {
+                prepare_data_path(next.data_path);
+            }
+            catch (const std::exception &e)
+            {
+                LOG(ERROR) << e.what() << ", keeping " << previous.data_path;
+                next.data_path = previous.data_path;
+            }
+        }
+
+        const bool new_file = next.data_path != previous.data_path || next.file_duration != previous.file_duration;
+
+        // a file started in the same second would get the name of the open file, the change waits for the next block
+        if (new_file && next.data_path == previous.data_path && _recording->file_name(now) == _recording->file_name(file_start))
+        {
+            std::lock_guard lock(_config_mtx);
+
+            if (!_pending_config)
+                _pending_config = next;
+
+            return;
+        }
+
+        {
+            std::lock_guard lock(_config_mtx);
+
+            _config = next;
+        }
+
+        if (acquisition_plan(next) != plan)
+            return;
+
+        if (next.lowpass_frequency != previous.lowpass_frequency || next.response_extension != previous.response_extension)
+        {
+            processor.setup(_n_active_channels, _sample_rate, processing_config());
+
+            LOG(WARNING) << "filters changed, their output settles again over the next seconds";
+        }
+
+        if (new_file)
+        {
+            _sinks.remove(*_recording);
+            create_writer();
+            _sinks.add(*_recording, {.max_backlog = 64, .overflow = SinkOptions::Overflow::WAIT});
+
+            _current_timestamp = file_start = now;
+            file_start_ns = to_ns(now);
+
+            next_boundary = boundary_after(now);
+            rotation_frame = frame_at(next_boundary);
+
+            // the rotation is checked after a frame is counted, so it has to lie after the current frame
+            if (rotation_frame <= frame_index)
+            {
+                next_boundary += _config.file_duration;
+                rotation_frame = frame_at(next_boundary);
+            }
+
+            LOG(INFO) << "continuing in " << (_config.data_path / _recording->file_name(now)) << " with files of "
+                      << _config.file_duration.count() << " s";
+        }
+
+        if (next.qc_interval != previous.qc_interval)
+        {
+            // the rows of the unfinished interval are written first
+            _qc.close_file();
+
+            if (next.qc_interval)
+            {
+                _qc.setup(_n_active_channels, _sample_rate, *next.qc_interval);
+                _qc.set_start_time(now);
+            }
+        }
+
+        if (next.qc_interval && (new_file || next.qc_interval != previous.qc_interval))
+            open_qc_file(now);
+
+        const bool path_changed = next.data_path != previous.data_path;
+
+        if (next.spectrum != previous.spectrum || (path_changed && next.spectrum))
+        {
+            if (previous.spectrum)
+                _sinks.remove(_spectrum);
+
+            if (next.spectrum)
+                start_spectrum(now);
+        }
+
+        if (next.correlation != previous.correlation || (path_changed && next.correlation))
+        {
+            if (previous.correlation)
+                _sinks.remove(_correlator);
+
+            if (next.correlation)
+                start_correlator(now);
+        }
+
+        if (next.stream != previous.stream)
+        {
+            if (_stream_server)
+            {
+                _sinks.remove(*_stream_server);
+                _stream_server.reset();
+            }
+
+            if (next.stream)
+                start_stream_server();
+        }
+
+        if (next.shared_memory != previous.shared_memory)
+        {
+            if (_shm_ring)
+            {
+                _sinks.remove(*_shm_ring);
+                _shm_ring.reset();
+            }
+
+            if (next.shared_memory)
+                start_shm_ring(now);
+        }
+
+        LOG(INFO) << "new settings applied at frame " << frame_index;
+    };
+
+    bool channels_changed = false;
+
+    // frames the ADC did not deliver while it was set up again, they are filled in before its next samples
+    uint64_t gap_frames = 0;
 
     while (_run_storing_thread)
     {
 
-        int32_t i = 0, c = 0;
+        int32_t i = 0;
 
         while (_run_storing_thread && sorted_sample_queue.size() < 1000)
         {
+            if (gap_frames)
+            {
+                // samples of 0 are interpolated and marked as filled in, like any other missing sample
+                sorted_sample_queue.emplace_back(_n_active_channels, 0);
+                sorted_flags_queue.emplace_back();
+                gap_frames--;
+                continue;
+            }
+
             std::vector<int32_t> samples(_n_active_channels);
+            FrameFlags flags;
+
+            uint32_t placed = 0;
+            std::optional<AdcGap> gap;
 
             for (uint32_t c = 0; c < _n_active_channels; c++)
             {
@@ -305,13 +1090,24 @@ void DataHandler::storing_thread_func(void)
                     _cv_raw_data.wait(lock, [&]()
                                       { return _raw_data_queue.size() >= 4000 || !_run_storing_thread; });
 
+                // only a stop wakes the wait with nothing queued
+                if (_raw_data_queue.empty())
+                    break;
+
                 ChannelData channel_sample = _raw_data_queue.front();
 
                 _raw_data_queue.pop_front();
 
-                if (channel_sample.first != _active_channels[i])
+                if (channel_sample.channel == ADC_GAP_CHANNEL)
+                {
+                    gap = std::move(_adc_gaps.front());
+                    _adc_gaps.pop_front();
+                    break;
+                }
+
+                if (channel_sample.channel != _active_channels[i])
                 {
-                    std::vector<uint8_t>::iterator data_point = std::find(_active_channels.begin(), _active_channels.end(), channel_sample.first);
+                    std::vector<uint8_t>::iterator data_point = std::find(_active_channels.begin(), _active_channels.end(), channel_sample.channel);
 
                     if (data_point == _active_channels.end())
                         continue;
@@ -319,55 +1115,127 @@ void DataHandler::storing_thread_func(void)
                     i = std::distance(_active_channels.begin(), data_point);
                 }
 
-                samples[i] = channel_sample.second;
+                samples[i] = channel_sample.value;
+
+                flags.overflow |= static_cast<uint32_t>((channel_sample.flags & SAMPLE_OVERFLOW) != 0) << i;
+                flags.supply |= static_cast<uint32_t>((channel_sample.flags & SAMPLE_SUPPLY) != 0) << i;
 
                 i = i < _n_active_channels - 1 ? i + 1 : 0;
+                placed++;
+            }
+
+            // a stop before the first sample of a frame leaves nothing to keep
+            if (!_run_storing_thread && !placed)
+                break;
+
+            // a frame the ADC broke off in the middle is kept, its missing samples are filled in
+            if (!gap || placed)
+            {
+                sorted_sample_queue.push_back(samples);
+                sorted_flags_queue.push_back(flags);
             }
 
-            sorted_sample_queue.push_back(samples);
+            if (gap)
+            {
+                // the stall is measured in time, so the frames after it keep their place on the time line
+                const int64_t missed = std::llround(std::chrono::duration<double>(gap->stalled).count() * _sample_rate) - (placed ? 1 : 0);
+
+                gap_frames = std::max<int64_t>(missed, 0);
+
+                record_gap(*gap, frame_time(frame_index + sorted_sample_queue.size()), gap_frames);
+
+                // the ADC starts a new scan at the first channel
+                i = 0;
+            }
         }
 
         while (sorted_sample_queue.size() > 100)
         {
             std::vector<int32_t> sample = sorted_sample_queue[0], next_sample = sorted_sample_queue[1];
+            const FrameFlags &flags = sorted_flags_queue.front();
 
-            for (uint32_t i = 0; i < _n_active_channels; i++)
+            if (flags.overflow || flags.supply)
             {
-                if (sample[i] == 0)
-                    sample[i] = (prev_sample[i] + next_sample.at(i)) >> 1;
+                block_status.push_back({static_cast<uint32_t>(block.size() / _n_active_channels), flags.overflow, flags.supply});
 
-                sample[i] = filters[i].filter(sample[i]);
+                std::lock_guard lock(_health_mtx);
+
+                for (uint32_t c = 0; c < _n_active_channels; c++)
+                {
+                    _health.overflow_samples[c] += (flags.overflow >> c) & 0x1;
+                    _health.supply_samples[c] += (flags.supply >> c) & 0x1;
+                }
             }
 
-            _writer.write_channels(sample);
+            if (_raw_mode)
+                block.insert(block.end(), sample.begin(), sample.end());
 
-            prev_sample = sample;
+            const uint32_t gaps = processor.fill_gaps(sample, next_sample);
 
-            if (sample_counter++ > _n_samples_per_file)
+            if (_config.qc_interval)
+                _qc.push_frame(sample, flags, gaps);
+
+            if (!_raw_mode)
             {
-                _current_timestamp = std::chrono::system_clock::now();
+                processor.filter(sample);
+                block.insert(block.end(), sample.begin(), sample.end());
+            }
 
-                std::stringstream ss;
-                time_t in_time_t = std::chrono::system_clock::to_time_t(_current_timestamp);
-                ss << "end time: " << std::put_time(std::localtime(&in_time_t), "%Y/%m/%d %H:%M:%S");
+            block_gaps |= gaps;
 
-                _writer.set_comments(ss.str());
+            // frames before the boundary belong to this file, so the block is split exactly there
+            if (++frame_index == rotation_frame)
+            {
+                flush_block();
 
-                sample_counter = 0;
+                // the first frame of the new file lies within one sample period after the boundary
+                _current_timestamp = file_start = next_boundary;
+                file_start_ns = to_ns(next_boundary);
+                open_qc_file(next_boundary);
 
-                new_file();
+                next_boundary += _config.file_duration;
+                rotation_frame = frame_at(next_boundary);
             }
 
             sorted_sample_queue.pop_front();
+            sorted_flags_queue.pop_front();
+        }
+
+        flush_block();
+
+        std::optional<RuntimeConfig> next;
+
+        {
+            std::lock_guard lock(_config_mtx);
+
+            next.swap(_pending_config);
+        }
+
+        if (next)
+            apply_config(std::move(*next));
+
+        // the samples still queued belong to the old scan and are dropped with it
+        if (next && acquisition_plan(_config) != plan)
+        {
+            channels_changed = true;
+            break;
         }
     }
 
-    std::stringstream ss;
-    time_t in_time_t = std::chrono::system_clock::to_time_t(_current_timestamp);
-    ss << "end time: " << std::put_time(std::localtime(&in_time_t), "%Y/%m/%d %H:%M:%S");
+    // every output handles its remaining blocks and closes its files
+    _sinks.stop();
+    _sinks.clear();
+    _stream_server.reset();
+    _shm_ring.reset();
+    _qc.close_file();
+
+    if (channels_changed)
+    {
+        const AcquisitionPlan next_plan = acquisition_plan(_config);
 
-    _writer.set_comments(ss.str());
-    _writer.close_file();
+        LOG(INFO) << "changing from " << plan.channels.size() << " channels at " << plan.sample_rate << " Hz to "
+                  << next_plan.channels.size() << " channels at " << next_plan.sample_rate << " Hz";
+    }
 
-    LOG(INFO) << "processing thread stopped";
+    return channels_changed && _run_storing_thread;
 }
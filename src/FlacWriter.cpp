@@ -0,0 +1,1060 @@
+/**
+ * @file FlacWriter.cpp
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <cmath>
+#include <ctime>
+#include <array>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "easylogging++.h"
+#include "utils/linux_scheduling.h"
+
+#include "FlacWriter.h"
+
+constexpr uint32_t METADATA_RESERVE = 1024; // VORBIS_COMMENT and PADDING blocks, a PADDING block until the file is closed
+constexpr uint32_t STREAMINFO_OFFSET = 8;   // after "fLaC" and the block header
+constexpr uint32_t METADATA_OFFSET = STREAMINFO_OFFSET + 34;
+constexpr uint32_t QLP_PRECISION = 14;      // bits of the quantized predictor coefficients
+constexpr uint32_t MAX_PARTITION_ORDER = 8;
+constexpr size_t JOBS_PER_WORKER = 4;       // frames queued per encoder before write_frames waits
+
+/**
+ * @brief Big endian bit writer for the FLAC bitstream.
+ */
+class BitWriter
+{
+private:
+    std::vector<uint8_t> &_out;
+    uint64_t _acc = 0; ///< Pending bits in the low _n_bits bits.
+    uint32_t _n_bits = 0;
+
+public:
+    explicit BitWriter(std::vector<uint8_t> &out) : _out(out) {}
+
+    /**
+     * @brief Write the low bits of value, at most 32.
+     */
+    inline void write(uint64_t value, uint32_t bits)
+    {
+        if (bits == 0)
+            return;
+
+        _acc = (_acc << bits) | (value & ((uint64_t(1) << bits) - 1));
+        _n_bits += bits;
+
+        while (_n_bits >= 8)
+        {
+            _n_bits -= 8;
+            _out.push_back(static_cast<uint8_t>(_acc >> _n_bits));
+        }
+    }
+
+    inline void write_signed(int64_t value, uint32_t bits)
+    {
+        write(static_cast<uint64_t>(value), bits);
+    }
+
+    /**
+     * @brief Write an unsigned value with Rice parameter k, the quotient in unary.
+     */
+    inline void write_rice(uint32_t value, uint32_t k)
+    {
+        uint32_t quotient = value >> k;
+
+        for (; quotient >= 32; quotient -= 32)
+            write(0, 32);
+
+        write(1, quotient + 1);
+        write(value, k);
+    }
+
+    void align(void)
+    {
+        if (_n_bits)
+            write(0, 8 - _n_bits);
+    }
+};
+
+static uint8_t crc8(const uint8_t *data, size_t size)
+{
+    uint8_t crc = 0;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+
+        for (int b = 0; b < 8; b++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t size)
+{
+    static const auto table = []()
+    {
+        std::array<uint16_t, 256> t;
+
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint16_t crc = i << 8;
+
+            for (int b = 0; b < 8; b++)
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+
+            t[i] = crc;
+        }
+
+        return t;
+    }();
+
+    uint16_t crc = 0;
+
+    for (size_t i = 0; i < size; i++)
+        crc = (crc << 8) ^ table[(crc >> 8) ^ data[i]];
+
+    return crc;
+}
+
+/**
+ * @brief Rice coding of one residual, the partition order and the parameter of every partition.
+ */
+struct RiceChoice
+{
+    uint32_t partition_order = 0;
+    std::vector<uint32_t> parameters;
+    uint64_t bits = UINT64_MAX; ///< Estimated size of the residual section.
+};
+
+static inline uint32_t zigzag(int32_t value)
+{
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+/**
+ * @brief Pick the partition order and parameters with the smallest estimated size.
+ *
+ * @param residual Residual of the samples after the warm-up samples.
+ * @param block_size Samples in the subframe, including the warm-up samples.
+ * @param order Number of warm-up samples.
+ */
+static RiceChoice choose_rice(const std::vector<int32_t> &residual, uint32_t block_size, uint32_t order)
+{
+    uint32_t max_order = 0;
+
+    while (max_order < MAX_PARTITION_ORDER && (block_size % (2u << max_order)) == 0 && (block_size >> (max_order + 1)) > order)
+        max_order++;
+
+    // sums of the finest partitions, coarser partitions are summed from them
+    const uint32_t n_fine = 1u << max_order;
+    const uint32_t fine_size = block_size >> max_order;
+
+    std::vector<uint64_t> sums(n_fine, 0);
+
+    size_t r = 0;
+
+    for (uint32_t p = 0; p < n_fine; p++)
+    {
+        const uint32_t count = p == 0 ? fine_size - order : fine_size;
+
+        uint64_t sum = 0;
+
+        for (uint32_t i = 0; i < count; i++)
+            sum += zigzag(residual[r++]);
+
+        sums[p] = sum;
+    }
+
+    RiceChoice best;
+
+    for (int32_t partition_order = max_order; partition_order >= 0; partition_order--)
+    {
+        const uint32_t n_partitions = 1u << partition_order;
+        const uint32_t partition_size = block_size >> partition_order;
+
+        RiceChoice choice;
+        choice.partition_order = partition_order;
+        choice.parameters.resize(n_partitions);
+        choice.bits = 2 + 4;
+
+        for (uint32_t p = 0; p < n_partitions; p++)
+        {
+            const uint64_t count = p == 0 ? partition_size - order : partition_size;
+            const uint64_t sum = sums[p];
+
+            // estimate the parameter from the mean and refine it with the estimated size of its neighbours
+            uint32_t k = 0;
+
+            if (count && sum > count)
+                k = std::min<uint32_t>(30, std::floor(std::log2(static_cast<double>(sum) / count)));
+
+            auto bits_for = [&](uint32_t parameter)
+            { return count * (parameter + 1) + (sum >> parameter); };
+
+            uint64_t bits = bits_for(k);
+
+            if (k > 0 && bits_for(k - 1) < bits)
+                bits = bits_for(--k);
+            else if (k < 30 && bits_for(k + 1) < bits)
+                bits = bits_for(++k);
+
+            choice.parameters[p] = k;
+            choice.bits += bits + 5;
+        }
+
+        if (choice.bits < best.bits)
+            best = std::move(choice);
+
+        // merge neighbouring partitions for the next, coarser order
+        for (uint32_t p = 0; p < n_partitions / 2; p++)
+            sums[p] = sums[2 * p] + sums[2 * p + 1];
+    }
+
+    return best;
+}
+
+static void write_residual(BitWriter &writer, const std::vector<int32_t> &residual, const RiceChoice &choice, uint32_t block_size, uint32_t order)
+{
+    const bool wide = std::any_of(choice.parameters.begin(), choice.parameters.end(), [](uint32_t k)
+                                  { return k > 14; });
+
+    // coding method 1 has 5 bit parameters, needed for the large residuals of 24 bit data
+    writer.write(wide ? 1 : 0, 2);
+    writer.write(choice.partition_order, 4);
+
+    const uint32_t partition_size = block_size >> choice.partition_order;
+
+    size_t r = 0;
+
+    for (uint32_t p = 0; p < choice.parameters.size(); p++)
+    {
+        const uint32_t k = choice.parameters[p];
+        const uint32_t count = p == 0 ? partition_size - order : partition_size;
+
+        writer.write(k, wide ? 5 : 4);
+
+        for (uint32_t i = 0; i < count; i++)
+            writer.write_rice(zigzag(residual[r++]), k);
+    }
+}
+
+/**
+ * @brief Prediction coefficients of every order up to max_order with the Levinson-Durbin recursion.
+ *
+ * @param autocorrelation Autocorrelation at lags 0 to max_order.
+ * @param coefficients Output, coefficients[order - 1] predicts x[n] from x[n - 1] ... x[n - order].
+ * @param errors Output, prediction error power of every order.
+ */
+static void levinson(const std::vector<double> &autocorrelation, uint32_t max_order,
+                     std::vector<std::vector<double>> &coefficients, std::vector<double> &errors)
+{
+    std::vector<double> a(max_order, 0), previous(max_order, 0);
+    double error = autocorrelation[0];
+
+    coefficients.assign(max_order, {});
+    errors.assign(max_order, 0);
+
+    for (uint32_t i = 0; i < max_order; i++)
+    {
+        double acc = autocorrelation[i + 1];
+
+        for (uint32_t j = 0; j < i; j++)
+            acc -= a[j] * autocorrelation[i - j];
+
+        const double k = error > 0 ? acc / error : 0;
+
+        previous = a;
+
+        for (uint32_t j = 0; j < i; j++)
+            a[j] = previous[j] - k * previous[i - 1 - j];
+
+        a[i] = k;
+        error *= 1 - k * k;
+
+        coefficients[i].assign(a.begin(), a.begin() + i + 1);
+        errors[i] = error;
+    }
+}
+
+/**
+ * @brief Quantize prediction coefficients to precision bits, carrying the rounding error forward.
+ *
+ * @return false when the coefficients cannot be represented
+ */
+static bool quantize(const std::vector<double> &coefficients, uint32_t precision, std::vector<int32_t> &quantized, int32_t &shift)
+{
+    double max = 0;
+
+    for (double c : coefficients)
+        max = std::max(max, std::fabs(c));
+
+    if (max <= 0)
+        return false;
+
+    int log2_max;
+    std::frexp(max, &log2_max);
+
+    shift = static_cast<int32_t>(precision) - 1 - log2_max;
+
+    if (shift < 0)
+        return false;
+
+    shift = std::min(shift, 15);
+
+    const int32_t q_max = (1 << (precision - 1)) - 1, q_min = -(1 << (precision - 1));
+
+    quantized.resize(coefficients.size());
+
+    double error = 0;
+
+    for (size_t i = 0; i < coefficients.size(); i++)
+    {
+        error += coefficients[i] * (1 << shift);
+
+        const int32_t q = std::clamp<int64_t>(std::lround(error), q_min, q_max);
+
+        error -= q;
+        quantized[i] = q;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Encode one channel of a frame as the smallest of the CONSTANT, FIXED, LPC and VERBATIM subframes.
+ */
+static void encode_subframe(BitWriter &writer, const std::vector<int32_t> &x, uint32_t bits_per_sample, uint32_t max_lpc_order)
+{
+    const uint32_t n = x.size();
+
+    if (std::all_of(x.begin(), x.end(), [&](int32_t v)
+                    { return v == x[0]; }))
+    {
+        writer.write(0, 8);
+        writer.write_signed(x[0], bits_per_sample);
+        return;
+    }
+
+    const uint64_t verbatim_bits = static_cast<uint64_t>(n) * bits_per_sample;
+
+    // fixed predictor with the smallest absolute residual
+    uint32_t fixed_order = 0;
+    {
+        uint64_t sums[5] = {};
+
+        for (uint32_t i = 4; i < n; i++)
+        {
+            const int64_t e0 = x[i];
+            const int64_t e1 = e0 - x[i - 1];
+            const int64_t e2 = e1 - (x[i - 1] - int64_t(x[i - 2]));
+            const int64_t e3 = e2 - (x[i - 1] - 2 * int64_t(x[i - 2]) + x[i - 3]);
+            const int64_t e4 = e3 - (x[i - 1] - 3 * int64_t(x[i - 2]) + 3 * int64_t(x[i - 3]) - x[i - 4]);
+
+            sums[0] += std::llabs(e0);
+            sums[1] += std::llabs(e1);
+            sums[2] += std::llabs(e2);
+            sums[3] += std::llabs(e3);
+            sums[4] += std::llabs(e4);
+        }
+
+        const uint32_t max_fixed = std::min<uint32_t>(4, n - 1);
+
+        fixed_order = std::min_element(sums, sums + max_fixed + 1) - sums;
+    }
+
+    std::vector<int32_t> fixed_residual(n - fixed_order);
+
+    for (uint32_t i = fixed_order; i < n; i++)
+    {
+        int64_t r;
+
+        switch (fixed_order)
+        {
+        case 0:
+            r = x[i];
+            break;
+        case 1:
+            r = int64_t(x[i]) - x[i - 1];
+            break;
+        case 2:
+            r = int64_t(x[i]) - 2 * int64_t(x[i - 1]) + x[i - 2];
+            break;
+        case 3:
+            r = int64_t(x[i]) - 3 * int64_t(x[i - 1]) + 3 * int64_t(x[i - 2]) - x[i - 3];
+            break;
+        default:
+            r = int64_t(x[i]) - 4 * int64_t(x[i - 1]) + 6 * int64_t(x[i - 2]) - 4 * int64_t(x[i - 3]) + x[i - 4];
+            break;
+        }
+
+        fixed_residual[i - fixed_order] = r;
+    }
+
+    RiceChoice fixed_rice = choose_rice(fixed_residual, n, fixed_order);
+    const uint64_t fixed_bits = 8 + fixed_order * bits_per_sample + fixed_rice.bits;
+
+    // linear predictor of the order with the smallest expected size
+    uint32_t lpc_order = 0;
+    int32_t lpc_shift = 0;
+    std::vector<int32_t> lpc_coefficients, lpc_residual;
+    RiceChoice lpc_rice;
+    uint64_t lpc_bits = UINT64_MAX;
+
+    if (max_lpc_order && n > 2 * max_lpc_order)
+    {
+        // tukey(0.5) window against the leakage of the block edges
+        std::vector<double> windowed(n);
+        const uint32_t taper = n / 4;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            double w = 1;
+
+            if (i < taper)
+                w = 0.5 - 0.5 * std::cos(M_PI * i / taper);
+            else if (i >= n - taper)
+                w = 0.5 - 0.5 * std::cos(M_PI * (n - 1 - i) / taper);
+
+            windowed[i] = x[i] * w;
+        }
+
+        std::vector<double> autocorrelation(max_lpc_order + 1, 0);
+
+        for (uint32_t lag = 0; lag <= max_lpc_order; lag++)
+        {
+            double sum = 0;
+
+            for (uint32_t i = lag; i < n; i++)
+                sum += windowed[i] * windowed[i - lag];
+
+            autocorrelation[lag] = sum;
+        }
+
+        if (autocorrelation[0] > 0)
+        {
+            std::vector<std::vector<double>> coefficients;
+            std::vector<double> errors;
+
+            levinson(autocorrelation, max_lpc_order, coefficients, errors);
+
+            double best_expected = INFINITY;
+
+            for (uint32_t order = 1; order <= max_lpc_order; order++)
+            {
+                const double bits_per_residual = errors[order - 1] > 0 ? std::max(0.0, 0.5 * std::log2(0.5 * errors[order - 1] / n)) : 0;
+                const double expected = bits_per_residual * (n - order) + order * (QLP_PRECISION + bits_per_sample);
+
+                if (expected < best_expected)
+                {
+                    best_expected = expected;
+                    lpc_order = order;
+                }
+            }
+
+            if (quantize(coefficients[lpc_order - 1], QLP_PRECISION, lpc_coefficients, lpc_shift))
+            {
+                lpc_residual.resize(n - lpc_order);
+
+                bool fits = true;
+
+                for (uint32_t i = lpc_order; i < n; i++)
+                {
+                    int64_t sum = 0;
+
+                    for (uint32_t j = 0; j < lpc_order; j++)
+                        sum += int64_t(lpc_coefficients[j]) * x[i - j - 1];
+
+                    const int64_t r = x[i] - (sum >> lpc_shift);
+
+                    fits &= r >= INT32_MIN / 2 && r <= INT32_MAX / 2;
+                    lpc_residual[i - lpc_order] = r;
+                }
+
+                if (fits)
+                {
+                    lpc_rice = choose_rice(lpc_residual, n, lpc_order);
+                    lpc_bits = 8 + lpc_order * bits_per_sample + 4 + 5 + lpc_order * QLP_PRECISION + lpc_rice.bits;
+                }
+            }
+        }
+    }
+
+    if (verbatim_bits <= std::min(fixed_bits, lpc_bits))
+    {
+        writer.write(0, 1);
+        writer.write(1, 6);
+        writer.write(0, 1);
+
+        for (int32_t v : x)
+            writer.write_signed(v, bits_per_sample);
+    }
+    else if (lpc_bits < fixed_bits)
+    {
+        writer.write(0, 1);
+        writer.write(0x20 | (lpc_order - 1), 6);
+        writer.write(0, 1);
+
+        for (uint32_t i = 0; i < lpc_order; i++)
+            writer.write_signed(x[i], bits_per_sample);
+
+        writer.write(QLP_PRECISION - 1, 4);
+        writer.write_signed(lpc_shift, 5);
+
+        for (int32_t c : lpc_coefficients)
+            writer.write_signed(c, QLP_PRECISION);
+
+        write_residual(writer, lpc_residual, lpc_rice, n, lpc_order);
+    }
+    else
+    {
+        writer.write(0, 1);
+        writer.write(0x08 | fixed_order, 6);
+        writer.write(0, 1);
+
+        for (uint32_t i = 0; i < fixed_order; i++)
+            writer.write_signed(x[i], bits_per_sample);
+
+        write_residual(writer, fixed_residual, fixed_rice, n, fixed_order);
+    }
+}
+
+/**
+ * @brief Encode an independent FLAC frame with fixed block size numbering.
+ */
+static std::vector<uint8_t> encode_frame(const std::vector<int32_t> &interleaved, uint16_t n_channels, uint16_t bits_per_sample,
+                                         uint32_t max_lpc_order, uint64_t frame_number)
+{
+    const uint32_t block_size = interleaved.size() / n_channels;
+
+    std::vector<uint8_t> out;
+    out.reserve(interleaved.size() * 3 + 64);
+
+    BitWriter writer(out);
+
+    // frame header
+    writer.write(0x3ffe, 14);
+    writer.write(0, 1);
+    writer.write(0, 1);
+
+    uint32_t block_size_code = 7;
+
+    for (uint32_t k = 0; k < 8; k++)
+        if (block_size == (256u << k))
+            block_size_code = 8 + k;
+
+    if (block_size_code == 7 && block_size <= 256)
+        block_size_code = 6;
+
+    uint32_t sample_size_code = 0;
+
+    switch (bits_per_sample)
+    {
+    case 8:
+        sample_size_code = 1;
+        break;
+    case 12:
+        sample_size_code = 2;
+        break;
+    case 16:
+        sample_size_code = 4;
+        break;
+    case 20:
+        sample_size_code = 5;
+        break;
+    case 24:
+        sample_size_code = 6;
+        break;
+    }
+
+    writer.write(block_size_code, 4);
+    writer.write(0, 4); // sample rate from STREAMINFO
+    writer.write(n_channels - 1, 4);
+    writer.write(sample_size_code, 3);
+    writer.write(0, 1);
+
+    // frame number in the extended UTF-8 coding
+    if (frame_number < 0x80)
+    {
+        writer.write(frame_number, 8);
+    }
+    else
+    {
+        uint32_t n_extra = 1;
+
+        while (frame_number >= (uint64_t(1) << (6 + 5 * n_extra)) && n_extra < 6)
+            n_extra++;
+
+        writer.write((0xff00 >> (n_extra + 1)) | (frame_number >> (6 * n_extra)), 8);
+
+        for (int32_t i = n_extra - 1; i >= 0; i--)
+            writer.write(0x80 | ((frame_number >> (6 * i)) & 0x3f), 8);
+    }
+
+    if (block_size_code == 6)
+        writer.write(block_size - 1, 8);
+    else if (block_size_code == 7)
+        writer.write(block_size - 1, 16);
+
+    writer.write(crc8(out.data(), out.size()), 8);
+
+    // one subframe per channel, channels are coded independently
+    std::vector<int32_t> channel(block_size);
+
+    for (uint16_t c = 0; c < n_channels; c++)
+    {
+        for (uint32_t i = 0; i < block_size; i++)
+            channel[i] = interleaved[i * n_channels + c];
+
+        encode_subframe(writer, channel, bits_per_sample, max_lpc_order);
+    }
+
+    writer.align();
+
+    const uint16_t crc = crc16(out.data(), out.size());
+
+    out.push_back(crc >> 8);
+    out.push_back(crc & 0xff);
+
+    return out;
+}
+
+FlacWriter::FlacWriter(std::vector<int> cores, uint32_t block_size, uint32_t max_lpc_order)
+    : _block_size(block_size),
+      _max_lpc_order(std::min<uint32_t>(max_lpc_order, 32)),
+      _cores(std::move(cores))
+{
+    if (_block_size < 16 || _block_size > 65535)
+        throw std::invalid_argument("FLAC block size has to be between 16 and 65535");
+
+    if (_cores.empty())
+        _cores.push_back(-1);
+}
+
+FlacWriter::~FlacWriter()
+{
+    close_file();
+    flush();
+    stop_workers();
+}
+
+void FlacWriter::set_comments(const std::string &comment)
+{
+    _comments = comment;
+}
+
+void FlacWriter::set_datetime(const std::chrono::system_clock::time_point &datetime)
+{
+    _datetime = datetime;
+}
+
+void FlacWriter::set_n_channels(uint16_t num_channels)
+{
+    if (!_files.empty())
+        throw std::runtime_error("cannot update number of channels while file is open");
+
+    if (num_channels == 0)
+        throw std::invalid_argument("FLAC needs at least 1 channel");
+
+    _n_channels = num_channels;
+}
+
+void FlacWriter::set_sample_rate(uint32_t sample_rate)
+{
+    if (!_files.empty())
+        throw std::runtime_error("cannot update sample rate while file is open");
+
+    _sample_rate = sample_rate;
+}
+
+void FlacWriter::set_bits_per_sample(uint16_t bits_per_sample)
+{
+    if (!_files.empty())
+        throw std::runtime_error("cannot update bits per sample while file is open");
+
+    if (bits_per_sample < 4 || bits_per_sample > 24)
+        throw std::invalid_argument("FLAC writer supports 4 to 24 bits per sample");
+
+    _bits_per_sample = bits_per_sample;
+}
+
+void FlacWriter::start_workers()
+{
+    if (!_workers.empty())
+        return;
+
+    _run_workers = true;
+
+    for (int core : _cores)
+        _workers.emplace_back(&FlacWriter::worker_func, this, core);
+}
+
+void FlacWriter::stop_workers()
+{
+    {
+        std::lock_guard lock(_mtx);
+        _run_workers = false;
+    }
+
+    _cv_jobs.notify_all();
+
+    for (auto &worker : _workers)
+        worker.join();
+
+    _workers.clear();
+}
+
+std::vector<std::pair<uint16_t, uint16_t>> FlacWriter::channel_groups() const
+{
+    if (_n_channels <= FLAC_MAX_CHANNELS)
+        return {{0, _n_channels}};
+
+    std::vector<std::pair<uint16_t, uint16_t>> groups;
+
+    for (uint16_t first = 0; first < _n_channels; first += FLAC_GROUP_CHANNELS)
+        groups.push_back({first, std::min<uint16_t>(FLAC_GROUP_CHANNELS, _n_channels - first)});
+
+    return groups;
+}
+
+std::vector<std::string> FlacWriter::file_names(const std::string &file_name) const
+{
+    const auto groups = channel_groups();
+
+    if (groups.size() == 1)
+        return {file_name};
+
+    std::vector<std::string> names;
+    std::filesystem::path path(file_name);
+
+    for (const auto &[first, count] : groups)
+    {
+        std::filesystem::path name = path;
+        name.replace_extension(".ch" + std::to_string(first) + "-" + std::to_string(first + count - 1) + path.extension().string());
+
+        names.push_back(name.string());
+    }
+
+    return names;
+}
+
+void FlacWriter::open_file(const std::string &file_name)
+{
+    if (!_files.empty())
+        close_file();
+
+    if (_n_channels == 0 || _sample_rate == 0 || _bits_per_sample == 0)
+        throw std::runtime_error("FLAC format is not configured");
+
+    _io.start();
+    start_workers();
+
+    const auto groups = channel_groups();
+    const std::vector<std::string> names = file_names(file_name);
+
+    for (size_t g = 0; g < groups.size(); g++)
+    {
+        auto file = std::make_shared<FileState>();
+
+        file->id = _io.open(names[g]);
+        file->n_channels = groups[g].second;
+        file->sample_rate = _sample_rate;
+        file->bits_per_sample = _bits_per_sample;
+        file->block_size = _block_size;
+
+        // an unknown length and frame sizes keep a file that is never closed decodable
+        std::vector<uint8_t> header = {'f', 'L', 'a', 'C', 0x00, 0x00, 0x00, 34};
+
+        std::vector<uint8_t> streaminfo = build_streaminfo(*file);
+        header.insert(header.end(), streaminfo.begin(), streaminfo.end());
+
+        // reserved for the VORBIS_COMMENT block, a PADDING block until then
+        const uint32_t padding = METADATA_RESERVE - 4;
+
+        header.push_back(0x80 | 0x01);
+        header.push_back(static_cast<uint8_t>(padding >> 16));
+        header.push_back(static_cast<uint8_t>(padding >> 8));
+        header.push_back(static_cast<uint8_t>(padding));
+        header.resize(header.size() + padding, 0);
+
+        file->offset = header.size();
+
+        _io.write(file->id, 0, std::move(header));
+
+        _files.push_back(file);
+    }
+
+    _block.clear();
+    _block.reserve(_block_size * _n_channels);
+    _n_blocks = 0;
+    _n_frames = 0;
+}
+
+void FlacWriter::write_frames(std::span<const int32_t> interleaved, size_t n_frames)
+{
+    if (_files.empty())
+        throw std::runtime_error("File is not open for writing samples.");
+
+    if (interleaved.size() < n_frames * _n_channels)
+        throw std::runtime_error("Not enough samples for the requested number of frames");
+
+    const int32_t *samples = interleaved.data();
+
+    _n_frames += n_frames;
+
+    while (n_frames)
+    {
+        const size_t n_fit = std::min<size_t>(_block_size - _block.size() / _n_channels, n_frames);
+
+        _block.insert(_block.end(), samples, samples + n_fit * _n_channels);
+
+        samples += n_fit * _n_channels;
+        n_frames -= n_fit;
+
+        if (_block.size() == _block_size * _n_channels)
+            submit_block();
+    }
+}
+
+void FlacWriter::submit_block()
+{
+    if (_block.empty())
+        return;
+
+    const size_t n_frames = _block.size() / _n_channels;
+    const uint64_t block_number = _n_blocks++;
+
+    std::vector<EncodeJob> jobs;
+
+    if (_files.size() == 1)
+    {
+        jobs.push_back({.file = _files.front(), .block_number = block_number, .samples = std::move(_block)});
+    }
+    else
+    {
+        // every file gets the frame of its own channels, interleaved the same way
+        for (const auto &file : _files)
+            jobs.push_back({.file = file, .block_number = block_number, .samples = std::vector<int32_t>(n_frames * file->n_channels)});
+
+        for (size_t f = 0; f < n_frames; f++)
+        {
+            const int32_t *frame = _block.data() + f * _n_channels;
+
+            for (size_t g = 0; g < jobs.size(); g++)
+                std::copy_n(frame + g * FLAC_GROUP_CHANNELS, _files[g]->n_channels, jobs[g].samples.data() + f * _files[g]->n_channels);
+        }
+    }
+
+    _block = {};
+    _block.reserve(_block_size * _n_channels);
+
+    // a frame of every file counts as one frame against the limit
+    const size_t max_in_flight = JOBS_PER_WORKER * _workers.size() * jobs.size();
+
+    for (EncodeJob &job : jobs)
+    {
+        std::unique_lock lock(_mtx);
+
+        if (_in_flight >= max_in_flight)
+        {
+            LOG(WARNING) << "FLAC encoders are falling behind, waiting";
+
+            _cv_done.wait(lock, [&]()
+                          { return _in_flight < max_in_flight; });
+        }
+
+        _jobs.push_back(std::move(job));
+        _in_flight++;
+
+        lock.unlock();
+
+        _cv_jobs.notify_one();
+    }
+}
+
+void FlacWriter::worker_func(int core)
+{
+    if (core >= 0)
+        set_thread_affinity(core);
+
+    std::unique_lock lock(_mtx);
+
+    while (true)
+    {
+        _cv_jobs.wait(lock, [&]()
+                      { return !_jobs.empty() || !_run_workers; });
+
+        if (_jobs.empty())
+            break;
+
+        EncodeJob job = std::move(_jobs.front());
+        _jobs.pop_front();
+
+        lock.unlock();
+
+        std::vector<uint8_t> frame = encode_frame(job.samples, job.file->n_channels, job.file->bits_per_sample, _max_lpc_order, job.block_number);
+
+        lock.lock();
+
+        job.file->done.emplace(job.block_number, std::move(frame));
+        write_ready(*job.file);
+
+        _in_flight--;
+        _cv_done.notify_all();
+    }
+}
+
+void FlacWriter::write_ready(FileState &file)
+{
+    // frames are encoded out of order but written in order
+    for (auto it = file.done.begin(); it != file.done.end() && it->first == file.next_block; it = file.done.erase(it))
+    {
+        const uint32_t size = it->second.size();
+
+        file.min_frame_size = std::min(file.min_frame_size, size);
+        file.max_frame_size = std::max(file.max_frame_size, size);
+
+        _io.write(file.id, file.offset, std::move(it->second));
+
+        file.offset += size;
+        file.next_block++;
+    }
+
+    if (file.next_block == file.n_blocks)
+        finalize(file);
+}
+
+void FlacWriter::finalize(FileState &file)
+{
+    _io.write(file.id, STREAMINFO_OFFSET, build_streaminfo(file));
+    _io.write(file.id, METADATA_OFFSET, std::move(file.metadata));
+    _io.close(file.id);
+
+    file.n_blocks = UINT64_MAX;
+}
+
+void FlacWriter::close_file()
+{
+    if (_files.empty())
+        return;
+
+    submit_block();
+
+    const std::vector<uint8_t> metadata = build_metadata();
+
+    {
+        std::lock_guard lock(_mtx);
+
+        for (const auto &file : _files)
+        {
+            file->total_frames = _n_frames;
+            file->metadata = metadata;
+            file->n_blocks = _n_blocks;
+
+            // otherwise the encoder thread that writes the last frame finalizes the file
+            if (file->next_block == file->n_blocks)
+                finalize(*file);
+        }
+    }
+
+    _files.clear();
+}
+
+void FlacWriter::flush()
+{
+    {
+        std::unique_lock lock(_mtx);
+
+        _cv_done.wait(lock, [&]()
+                      { return _in_flight == 0; });
+    }
+
+    _io.wait_idle();
+}
+
+WriteLatency FlacWriter::take_write_latency()
+{
+    return _io.take_latency();
+}
+
+std::vector<uint8_t> FlacWriter::build_streaminfo(const FileState &file)
+{
+    std::vector<uint8_t> streaminfo;
+    streaminfo.reserve(34);
+
+    BitWriter writer(streaminfo);
+
+    const bool closed = file.total_frames > 0;
+
+    writer.write(file.block_size, 16);
+    writer.write(file.block_size, 16);
+    writer.write(closed ? file.min_frame_size : 0, 24);
+    writer.write(closed ? file.max_frame_size : 0, 24);
+    writer.write(file.sample_rate, 20);
+    writer.write(file.n_channels - 1, 3);
+    writer.write(file.bits_per_sample - 1, 5);
+    writer.write(file.total_frames >> 32, 4);
+    writer.write(file.total_frames, 32);
+
+    // no MD5 signature, it can only be computed serially over the whole file
+    streaminfo.resize(34, 0);
+
+    return streaminfo;
+}
+
+std::vector<uint8_t> FlacWriter::build_metadata() const
+{
+    std::stringstream ss;
+    time_t in_time_t = std::chrono::system_clock::to_time_t(_datetime);
+    ss << std::put_time(std::localtime(&in_time_t), "%Y-%m-%dT%H:%M:%S");
+
+    const std::string vendor = "Drongo";
+    std::vector<std::string> comments = {"DATE=" + ss.str(), "COMMENT=" + _comments};
+
+    auto write_le32 = [](std::vector<uint8_t> &bytes, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            bytes.push_back(value >> (8 * i));
+    };
+
+    std::vector<uint8_t> vorbis;
+
+    write_le32(vorbis, vendor.size());
+    vorbis.insert(vorbis.end(), vendor.begin(), vendor.end());
+    write_le32(vorbis, comments.size());
+
+    for (auto &comment : comments)
+    {
+        // the metadata has to fit in the reserved room, long comments are cut
+        comment.resize(std::min<size_t>(comment.size(), METADATA_RESERVE / 2));
+
+        write_le32(vorbis, comment.size());
+        vorbis.insert(vorbis.end(), comment.begin(), comment.end());
+    }
+
+    // VORBIS_COMMENT, then PADDING over the rest of the reserved room
+    std::vector<uint8_t> metadata = {0x04, uint8_t(vorbis.size() >> 16), uint8_t(vorbis.size() >> 8), uint8_t(vorbis.size())};
+    metadata.insert(metadata.end(), vorbis.begin(), vorbis.end());
+
+    const uint32_t padding = METADATA_RESERVE - metadata.size() - 4;
+
+    metadata.push_back(0x80 | 0x01);
+    metadata.push_back(static_cast<uint8_t>(padding >> 16));
+    metadata.push_back(static_cast<uint8_t>(padding >> 8));
+    metadata.push_back(static_cast<uint8_t>(padding));
+    metadata.resize(METADATA_RESERVE, 0);
+
+    return metadata;
+}
@@ -0,0 +1,397 @@
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "utils/Steim2.h"
+
+#include "MiniSeedWriter.h"
+
+constexpr uint32_t _data_offset = 128; // fixed header and blockettes, padded to two Steim frames
+
+constexpr uint8_t QUALITY_CLIPPING = 0x02; // data quality flag: digitizer clipping detected
+constexpr uint8_t QUALITY_GLITCHES = 0x08; // data quality flag: glitches detected
+
+/**
+ * @brief Append a big endian integer.
+ */
+template <class T>
+uint8_t *put_be(uint8_t *out, T value)
+{
+    for (int i = sizeof(T) - 1; i >= 0; i--)
+        *out++ = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+
+    return out;
+}
+
+/**
+ * @brief Copy a code into a space padded field.
+ */
+void put_code(uint8_t *out, const std::string &code, size_t width)
+{
+    std::memset(out, ' ', width);
+    std::memcpy(out, code.data(), std::min(code.size(), width));
+}
+
+/**
+ * @brief Closest sample rate factor and multiplier of the fixed header.
+ *
+ * @param sample_rate rate in Hz
+ * @param factor output, numerator
+ * @param multiplier output, negative denominator
+ */
+void rate_factor(double sample_rate, int16_t &factor, int16_t &multiplier)
+{
+    double best_error = INFINITY;
+
+    factor = 0;
+    multiplier = 1;
+
+    for (int32_t d = 1; d <= INT16_MAX; d++)
+    {
+        const double f = std::round(sample_rate * d);
+
+        if (f > INT16_MAX)
+            break;
+
+        const double error = std::abs(sample_rate - f / d);
+
+        if (error < best_error)
+        {
+            best_error = error;
+            factor = static_cast<int16_t>(f);
+            multiplier = static_cast<int16_t>(-d);
+        }
+
+        if (error == 0)
+            break;
+    }
+
+    if (multiplier == -1)
+        multiplier = 1;
+}
+
+/**
+ * @brief SEED band code of a short period sensor at this sample rate.
+ */
+char band_code(double sample_rate)
+{
+    if (sample_rate >= 5000)
+        return 'J';
+    if (sample_rate >= 1000)
+        return 'G';
+    if (sample_rate >= 250)
+        return 'D';
+    if (sample_rate >= 80)
+        return 'E';
+    if (sample_rate >= 10)
+        return 'S';
+
+    return 'M';
+}
+
+MiniSeedWriter::MiniSeedWriter(const SeedCodes &codes, uint32_t record_length)
+    : _codes(codes),
+      _record_length(record_length),
+      _n_data_frames((record_length - _data_offset) / STEIM_FRAME_SIZE)
+{
+    if (record_length != 512 && record_length != 4096)
+        throw std::invalid_argument("MiniSEED record length has to be 512 or 4096 bytes");
+}
+
+MiniSeedWriter::~MiniSeedWriter()
+{
+    close_file();
+}
+
+void MiniSeedWriter::set_comments(const std::string &comment)
+{
+}
+
+void MiniSeedWriter::set_datetime(const std::chrono::system_clock::time_point &datetime)
+{
+    _datetime = datetime;
+}
+
+void MiniSeedWriter::set_n_channels(uint16_t num_channels)
+{
+    if (_is_open)
+        throw std::runtime_error("cannot update number of channels while file is open");
+
+    if (!_codes.channels.empty() && _codes.channels.size() != num_channels)
+        throw std::invalid_argument("a SEED channel code is needed for every channel");
+
+    _n_channels = num_channels;
+}
+
+void MiniSeedWriter::set_sample_rate(uint32_t sample_rate)
+{
+    set_exact_sample_rate(sample_rate);
+}
+
+void MiniSeedWriter::set_exact_sample_rate(double sample_rate)
+{
+    if (_is_open)
+        throw std::runtime_error("cannot update sample rate while file is open");
+
+    _sample_rate = sample_rate;
+}
+
+void MiniSeedWriter::set_bits_per_sample(uint16_t bits_per_sample)
+{
+    if (_is_open)
+        throw std::runtime_error("cannot update bits per sample while file is open");
+
+    if (bits_per_sample > 29)
+        throw std::invalid_argument("Steim2 supports at most 29 bits per sample");
+
+    _bits_per_sample = bits_per_sample;
+}
+
+void MiniSeedWriter::set_commit_interval(uint64_t frames)
+{
+    _commit_frames = frames;
+}
+
+void MiniSeedWriter::open_file(const std::string &file_name)
+{
+    if (_is_open)
+        close_file();
+
+    if (_n_channels == 0 || _sample_rate <= 0 || _bits_per_sample == 0)
+        throw std::runtime_error("MiniSEED format is not configured");
+
+    _io.start();
+
+    _file = _io.open(file_name);
+    _is_open = true;
+    _offset = 0;
+    _sequence = 0;
+    _frames_since_commit = 0;
+    _marks.clear();
+
+    rate_factor(_sample_rate, _rate_factor, _rate_multiplier);
+
+    const std::string orientations = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+    _streams.assign(_n_channels, {});
+
+    for (uint16_t c = 0; c < _n_channels; c++)
+    {
+        if (_codes.channels.empty())
+            _streams[c].channel = {band_code(_sample_rate), 'P', orientations[c % orientations.size()]};
+        else
+            _streams[c].channel = _codes.channels[c];
+    }
+}
+
+void MiniSeedWriter::close_file()
+{
+    if (!_is_open)
+        return;
+
+    for (Stream &stream : _streams)
+        encode_records(stream, true);
+
+    submit_buffer();
+
+    _io.close(_file);
+    _is_open = false;
+}
+
+void MiniSeedWriter::flush()
+{
+    _io.wait_idle();
+}
+
+WriteLatency MiniSeedWriter::take_write_latency()
+{
+    return _io.take_latency();
+}
+
+void MiniSeedWriter::write_frames(std::span<const int32_t> interleaved, size_t n_frames)
+{
+    if (!_is_open)
+        throw std::runtime_error("File is not open for writing samples.");
+
+    if (interleaved.size() < n_frames * _n_channels)
+        throw std::runtime_error("Not enough samples for the requested number of frames");
+
+    for (uint16_t c = 0; c < _n_channels; c++)
+    {
+        Stream &stream = _streams[c];
+
+        const size_t start = stream.pending.size();
+
+        for (const FrameMark &mark : _marks)
+        {
+            const uint8_t quality = ((mark.overflow >> c) & 0x1 ? QUALITY_CLIPPING : 0) | ((mark.supply >> c) & 0x1 ? QUALITY_GLITCHES : 0);
+
+            if (quality)
+                stream.flagged.emplace_back(stream.first_sample + start + mark.frame, quality);
+        }
+
+        stream.pending.resize(start + n_frames);
+
+        for (size_t i = 0; i < n_frames; i++)
+            stream.pending[start + i] = interleaved[i * _n_channels + c];
+
+        encode_records(stream, false);
+    }
+
+    _marks.clear();
+
+    _frames_since_commit += n_frames;
+
+    // records are independent, so everything written so far is readable once it is durable
+    if (_commit_frames && _frames_since_commit >= _commit_frames)
+    {
+        submit_buffer();
+        _io.sync(_file);
+
+        _frames_since_commit = 0;
+    }
+}
+
+void MiniSeedWriter::mark_status(uint32_t frame, uint32_t overflow, uint32_t supply)
+{
+    _marks.push_back({frame, overflow, supply});
+}
+
+void MiniSeedWriter::encode_records(Stream &stream, bool partial)
+{
+    // a record is only started with enough samples to fill it at the densest packing
+    const size_t record_samples = _n_data_frames * 15 * 7;
+
+    size_t start = 0;
+
+    while (stream.pending.size() - start >= record_samples || (partial && start < stream.pending.size()))
+        start += write_record(stream, start);
+
+    stream.pending.erase(stream.pending.begin(), stream.pending.begin() + start);
+}
+
+size_t MiniSeedWriter::write_record(Stream &stream, size_t start)
+{
+    if (_buffer && _buffer->capacity - _buffer->size < _record_length)
+        submit_buffer();
+
+    if (!_buffer)
+    {
+        _buffer = _io.acquire_buffer();
+        _buffer_offset = _offset;
+    }
+
+    uint8_t *record = _buffer->data + _buffer->size;
+    std::memset(record, 0, _record_length);
+
+    const int32_t *x = stream.pending.data() + start;
+    const size_t n_available = stream.pending.size() - start;
+
+    uint32_t n_frames = 0;
+    const size_t n_samples = steim2_encode(x, n_available, stream.has_last ? stream.last : x[0],
+                                           record + _data_offset, _n_data_frames, n_frames);
+
+    // the flags of the samples in this record go into its header
+    uint8_t quality = 0;
+    auto flagged_end = stream.flagged.begin();
+
+    while (flagged_end != stream.flagged.end() && flagged_end->first < stream.first_sample + n_samples)
+        quality |= (flagged_end++)->second;
+
+    stream.flagged.erase(stream.flagged.begin(), flagged_end);
+
+    write_header(record, stream, n_samples, n_frames, quality);
+
+    stream.last = x[n_samples - 1];
+    stream.has_last = true;
+    stream.first_sample += n_samples;
+
+    _buffer->size += _record_length;
+    _offset += _record_length;
+
+    return n_samples;
+}
+
+void MiniSeedWriter::write_header(uint8_t *record, const Stream &stream, uint32_t n_samples, uint32_t n_frames, uint8_t quality)
+{
+    namespace chr = std::chrono;
+
+    _sequence = _sequence % 999999 + 1;
+
+    // start time in 0.0001 s ticks and the remaining microseconds, -50 to 49
+    const int64_t us = chr::duration_cast<chr::microseconds>(_datetime.time_since_epoch()).count() +
+                       std::llround(stream.first_sample * 1e6 / _sample_rate);
+    const int64_t ticks = (us + 50) / 100;
+    const int64_t us_offset = us - ticks * 100;
+
+    const chr::sys_days day = chr::floor<chr::days>(chr::sys_time<chr::microseconds>(chr::microseconds(ticks * 100)));
+    const chr::year_month_day date(day);
+    const int64_t day_ticks = ticks - chr::duration_cast<chr::microseconds>(day.time_since_epoch()).count() / 100;
+    const uint16_t day_of_year = (day - chr::sys_days(date.year() / 1 / 1)).count() + 1;
+
+    // fixed section of the data header
+    char sequence[7];
+    std::snprintf(sequence, sizeof(sequence), "%06u", _sequence);
+
+    std::memcpy(record, sequence, 6);
+    record[6] = 'D';
+    record[7] = ' ';
+    put_code(record + 8, _codes.station, 5);
+    put_code(record + 13, _codes.location, 2);
+    put_code(record + 15, stream.channel, 3);
+    put_code(record + 18, _codes.network, 2);
+
+    uint8_t *p = record + 20;
+    p = put_be<uint16_t>(p, static_cast<int>(date.year()));
+    p = put_be<uint16_t>(p, day_of_year);
+    *p++ = day_ticks / 36000000;
+    *p++ = day_ticks / 600000 % 60;
+    *p++ = day_ticks / 10000 % 60;
+    *p++ = 0;
+    p = put_be<uint16_t>(p, day_ticks % 10000);
+    p = put_be<uint16_t>(p, n_samples);
+    p = put_be<int16_t>(p, _rate_factor);
+    p = put_be<int16_t>(p, _rate_multiplier);
+    *p++ = 0; // activity flags
+    *p++ = 0; // I/O and clock flags
+    *p++ = quality; // data quality flags
+    *p++ = 3; // number of blockettes
+    p = put_be<int32_t>(p, 0);
+    p = put_be<uint16_t>(p, _data_offset);
+    p = put_be<uint16_t>(p, 48);
+
+    // blockette 1000, data only SEED
+    p = put_be<uint16_t>(p, 1000);
+    p = put_be<uint16_t>(p, 56);
+    *p++ = 11; // Steim2
+    *p++ = 1;  // big endian
+    *p++ = _record_length == 4096 ? 12 : 9;
+    *p++ = 0;
+
+    // blockette 1001, data extension
+    p = put_be<uint16_t>(p, 1001);
+    p = put_be<uint16_t>(p, 64);
+    *p++ = 0; // timing quality is unknown
+    *p++ = static_cast<uint8_t>(static_cast<int8_t>(us_offset));
+    *p++ = 0;
+    *p++ = n_frames;
+
+    // blockette 100, the exact sample rate
+    const float rate = _sample_rate;
+    uint32_t rate_bits;
+    std::memcpy(&rate_bits, &rate, sizeof(rate_bits));
+
+    p = put_be<uint16_t>(p, 100);
+    p = put_be<uint16_t>(p, 0);
+    p = put_be<uint32_t>(p, rate_bits);
+}
+
+void MiniSeedWriter::submit_buffer()
+{
+    if (!_buffer)
+        return;
+
+    // the buffer belongs to the storage thread until it has been written
+    _io.write(_file, _buffer_offset, _buffer);
+    _buffer = nullptr;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file QualityMonitor.cpp
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+#include "easylogging++.h"
+
+#include "QualityMonitor.h"
+
+constexpr int32_t ADC_FULL_SCALE = (1 << 23) - 1;
+
+QualityMonitor::QualityMonitor()
+{
+}
+
+QualityMonitor::~QualityMonitor()
+{
+    close_file();
+}
+
+void QualityMonitor::setup(uint16_t n_channels, double sample_rate, double interval_seconds, double clip_fraction)
+{
+    if (n_channels > 32)
+        throw std::invalid_argument("quality control supports at most 32 channels");
+
+    if (interval_seconds * sample_rate < 1)
+        throw std::invalid_argument("a quality control interval has to contain at least one frame");
+
+    _n_channels = n_channels;
+    _sample_rate = sample_rate;
+    _frames_per_interval = std::lround(interval_seconds * sample_rate);
+    _clip_level = static_cast<int32_t>(clip_fraction * ADC_FULL_SCALE);
+
+    _sum.resize(n_channels);
+    _sum_sq.resize(n_channels);
+    _min.resize(n_channels);
+    _max.resize(n_channels);
+    _clipped.resize(n_channels);
+    _overflow.resize(n_channels);
+    _supply.resize(n_channels);
+    _gaps.resize(n_channels);
+
+    reset_interval();
+
+    _frames_total = 0;
+}
+
+void QualityMonitor::set_start_time(const std::chrono::system_clock::time_point &start_time)
+{
+    _start_time = start_time;
+    _frames_total = 0;
+    reset_interval();
+}
+
+void QualityMonitor::open_file(const std::filesystem::path &file_name)
+{
+    close_file();
+
+    _output_file.open(file_name);
+
+    if (!_output_file.is_open())
+    {
+        LOG(ERROR) << "could not open quality control file " << file_name;
+        return;
+    }
+
+    _output_file << "start_time,channel,samples,mean_v,rms_v,min_v,max_v,clipped,overflow,supply,gaps\n";
+}
+
+void QualityMonitor::close_file(void)
+{
+    if (!_output_file.is_open())
+        return;
+
+    flush();
+
+    _output_file.close();
+}
+
+void QualityMonitor::reset_interval(void)
+{
+    std::fill(_sum.begin(), _sum.end(), 0);
+    std::fill(_sum_sq.begin(), _sum_sq.end(), 0.0);
+    std::fill(_min.begin(), _min.end(), std::numeric_limits<int32_t>::max());
+    std::fill(_max.begin(), _max.end(), std::numeric_limits<int32_t>::min());
+    std::fill(_clipped.begin(), _clipped.end(), 0);
+    std::fill(_overflow.begin(), _overflow.end(), 0);
+    std::fill(_supply.begin(), _supply.end(), 0);
+    std::fill(_gaps.begin(), _gaps.end(), 0);
+
+    _frames_in_interval = 0;
+}
+
+void QualityMonitor::push_frame(const std::vector<int32_t> &samples, const FrameFlags &flags, uint32_t gaps)
+{
+    if (samples.size() != _n_channels)
+        throw std::runtime_error("Incorrect number of channels");
+
+    const int32_t *x = samples.data();
+    const int32_t clip_level = _clip_level;
+
+    // branch free loops over the channel arrays, these are auto-vectorized
+    for (uint16_t c = 0; c < _n_channels; c++)
+    {
+        _sum[c] += x[c];
+        _sum_sq[c] += static_cast<double>(x[c]) * x[c];
+        _min[c] = std::min(_min[c], x[c]);
+        _max[c] = std::max(_max[c], x[c]);
+        _clipped[c] += (x[c] >= clip_level) | (x[c] <= -clip_level);
+    }
+
+    for (uint16_t c = 0; c < _n_channels; c++)
+    {
+        _overflow[c] += (flags.overflow >> c) & 0x1;
+        _supply[c] += (flags.supply >> c) & 0x1;
+        _gaps[c] += (gaps >> c) & 0x1;
+    }
+
+    _frames_total++;
+
+    if (++_frames_in_interval >= _frames_per_interval)
+        flush();
+}
+
+void QualityMonitor::flush(void)
+{
+    if (_frames_in_interval)
+        write_interval();
+
+    reset_interval();
+}
+
+void QualityMonitor::write_interval(void)
+{
+    if (!_output_file.is_open())
+        return;
+
+    const uint64_t first_frame = _frames_total - _frames_in_interval;
+
+    const auto interval_start = _start_time + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                                  std::chrono::duration<double>(first_frame / _sample_rate));
+
+    std::stringstream ss;
+    time_t in_time_t = std::chrono::system_clock::to_time_t(interval_start);
+    ss << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S");
+
+    for (uint16_t c = 0; c < _n_channels; c++)
+    {
+        const double mean = static_cast<double>(_sum[c]) / _frames_in_interval;
+        const double variance = std::max(0.0, _sum_sq[c] / _frames_in_interval - mean * mean);
+
+        _output_file << ss.str() << ',' << c << ',' << _frames_in_interval << ','
+                     << std::setprecision(9) << mean * ADC_RAW_TO_DOUBLE_RATIO << ','
+                     << std::sqrt(variance) * ADC_RAW_TO_DOUBLE_RATIO << ','
+                     << _min[c] * ADC_RAW_TO_DOUBLE_RATIO << ','
+                     << _max[c] * ADC_RAW_TO_DOUBLE_RATIO << ','
+                     << _clipped[c] << ',' << _overflow[c] << ',' << _supply[c] << ',' << _gaps[c] << '\n';
+    }
+
+    _output_file.flush();
+}
@@ -0,0 +1,509 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cmath>
+#include <ctime>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "easylogging++.h"
+
+#include "utils/Crc32c.h"
+#include "utils/Pack24Neon.h"
+
+#include "RecordingReader.h"
+
+/**
+ * @brief Local time in a fixed format as nanoseconds since the Unix epoch.
+ */
+bool parse_local_time(const std::string &text, const char *format, int64_t &time_ns)
+{
+    std::tm tm{};
+    std::istringstream ss(text);
+
+    ss >> std::get_time(&tm, format);
+
+    if (ss.fail())
+        return false;
+
+    tm.tm_isdst = -1;
+    time_ns = static_cast<int64_t>(std::mktime(&tm)) * 1000000000;
+
+    return true;
+}
+
+bool recording_name_time(const std::filesystem::path &path, int64_t &time_ns)
+{
+    return parse_local_time(path.stem().string(), "date-%Y-%m-%d-time-%H-%M-%S", time_ns);
+}
+
+/**
+ * @brief First frame at or after a point in time, clamped to the frames of a segment.
+ */
+uint64_t frame_at(int64_t start_ns, double sample_rate, uint64_t n_frames, int64_t time_ns)
+{
+    const double frame = std::ceil((time_ns - start_ns) * sample_rate / 1e9);
+
+    return static_cast<uint64_t>(std::clamp(frame, 0.0, static_cast<double>(n_frames)));
+}
+
+RecordingFile::RecordingFile(const std::filesystem::path &path) : _path(path)
+{
+    _fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    struct stat st;
+
+    if (_fd < 0 || fstat(_fd, &st) < 0)
+        throw std::runtime_error("could not open " + path.string() + ": " + std::strerror(errno));
+
+    _size = st.st_size;
+
+    if (_size)
+    {
+        void *map = mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+
+        if (map == MAP_FAILED)
+        {
+            ::close(_fd);
+            throw std::runtime_error("could not map " + path.string() + ": " + std::strerror(errno));
+        }
+
+        _map = static_cast<const uint8_t *>(map);
+    }
+
+    try
+    {
+        if (_size >= sizeof(ArchiveFileHeader) && !std::memcmp(_map, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)))
+            parse_archive();
+        else if (_size >= 12 && !std::memcmp(_map, "RIFF", 4) && !std::memcmp(_map + 8, "WAVE", 4))
+            parse_wav();
+        else
+            throw std::runtime_error(path.string() + " is not a WAV or archive file");
+    }
+    catch (...)
+    {
+        munmap(const_cast<uint8_t *>(_map), _size);
+        ::close(_fd);
+        throw;
+    }
+}
+
+RecordingFile::~RecordingFile()
+{
+    if (_map)
+        munmap(const_cast<uint8_t *>(_map), _size);
+
+    ::close(_fd);
+}
+
+void RecordingFile::parse_wav()
+{
+    _format = Format::WAV;
+
+    uint16_t block_align = 0;
+    uint64_t data_size = 0;
+    std::string created;
+
+    auto u16 = [&](uint64_t offset)
+    {
+        uint16_t value;
+        std::memcpy(&value, _map + offset, sizeof(value));
+        return value;
+    };
+
+    auto u32 = [&](uint64_t offset)
+    {
+        uint32_t value;
+        std::memcpy(&value, _map + offset, sizeof(value));
+        return value;
+    };
+
+    // strings of the INFO list end with one or two terminators
+    auto text = [&](uint64_t offset, uint32_t size)
+    {
+        return std::string(reinterpret_cast<const char *>(_map + offset), strnlen(reinterpret_cast<const char *>(_map + offset), size));
+    };
+
+    uint64_t pos = 12;
+
+    while (pos + 8 <= _size)
+    {
+        const uint8_t *id = _map + pos;
+        const uint64_t size = u32(pos + 4);
+        const uint64_t body = pos + 8;
+
+        if (!std::memcmp(id, "fmt ", 4) && body + 16 <= _size)
+        {
+            _n_channels = u16(body + 2);
+            _sample_rate = u32(body + 4);
+            block_align = u16(body + 12);
+            _bits_per_sample = u16(body + 14);
+        }
+        else if (!std::memcmp(id, "data", 4))
+        {
+            _data_offset = body;
+
+            // a file that was not closed has a placeholder or an outdated size
+            if (size == 0xdeadbeef || body + size > _size)
+            {
+                data_size = _size - body;
+                break;
+            }
+
+            data_size = size;
+        }
+        else if (!std::memcmp(id, "LIST", 4) && body + 4 <= _size && !std::memcmp(_map + body, "INFO", 4))
+        {
+            const uint64_t list_end = std::min<uint64_t>(body + size, _size);
+
+            for (uint64_t sub = body + 4; sub + 8 <= list_end;)
+            {
+                const uint32_t sub_size = std::min<uint64_t>(u32(sub + 4), list_end - sub - 8);
+
+                if (!std::memcmp(_map + sub, "ICRD", 4))
+                    created = text(sub + 8, sub_size);
+                else if (!std::memcmp(_map + sub, "ICMT", 4))
+                    _comment = text(sub + 8, sub_size);
+
+                sub += 8 + sub_size + (sub_size & 1);
+            }
+        }
+
+        pos = body + size + (size & 1);
+    }
+
+    if (_n_channels == 0 || block_align == 0 || _data_offset == 0)
+        throw std::runtime_error(_path.string() + " has no PCM format or data chunk");
+
+    _bytes_per_sample = block_align / _n_channels;
+    _n_frames = data_size / block_align;
+
+    if (!parse_local_time(created, "%Y-%m-%d %H:%M:%S", _start_time_ns) && !recording_name_time(_path, _start_time_ns))
+        LOG(WARNING) << _path << " has no start time";
+}
+
+const ArchiveBlockHeader *RecordingFile::block_at(uint64_t offset) const
+{
+    if (offset + sizeof(ArchiveBlockHeader) > _size || offset % 8)
+        return nullptr;
+
+    const ArchiveBlockHeader *block = reinterpret_cast<const ArchiveBlockHeader *>(_map + offset);
+
+    if (block->magic != ARCHIVE_BLOCK_MAGIC || block->header_crc != crc32c(block, offsetof(ArchiveBlockHeader, header_crc)) ||
+        offset + archive_block_size(block->payload_size) > _size)
+        return nullptr;
+
+    return block;
+}
+
+void RecordingFile::parse_archive()
+{
+    _format = Format::ARCHIVE;
+
+    const ArchiveFileHeader *header = reinterpret_cast<const ArchiveFileHeader *>(_map);
+
+    if (header->crc != crc32c(header, offsetof(ArchiveFileHeader, crc)))
+        throw std::runtime_error(_path.string() + " has a damaged header");
+
+    _n_channels = header->n_channels;
+    _bits_per_sample = header->bits_per_sample;
+    _bytes_per_sample = header->bytes_per_sample;
+    _sample_rate = header->sample_rate;
+    _raw = header->flags & ARCHIVE_RAW;
+    _merged = header->flags & ARCHIVE_MERGED;
+
+    const ArchiveTrailer *trailer = reinterpret_cast<const ArchiveTrailer *>(_map + _size - sizeof(ArchiveTrailer));
+
+    const bool closed = _size >= sizeof(ArchiveFileHeader) + sizeof(ArchiveTrailer) &&
+                        !std::memcmp(trailer->magic, ARCHIVE_INDEX_MAGIC, sizeof(trailer->magic)) &&
+                        trailer->crc == crc32c(trailer, offsetof(ArchiveTrailer, crc)) &&
+                        trailer->index_offset + trailer->n_entries * sizeof(ArchiveIndexEntry) + sizeof(ArchiveTrailer) == _size &&
+                        trailer->index_crc == crc32c(_map + trailer->index_offset, trailer->n_entries * sizeof(ArchiveIndexEntry));
+
+    uint64_t last_block = 0;
+
+    if (closed)
+    {
+        const ArchiveIndexEntry *entries = reinterpret_cast<const ArchiveIndexEntry *>(_map + trailer->index_offset);
+
+        _index.assign(entries, entries + trailer->n_entries);
+        _blocks_end = trailer->index_offset;
+
+        if (!_index.empty())
+            last_block = _index.back().offset;
+    }
+    else
+    {
+        // every block is indexed up to the first one that is incomplete
+        LOG(WARNING) << _path << " was not closed, reading it up to its last complete block";
+
+        _blocks_end = sizeof(ArchiveFileHeader);
+    }
+
+    // walk the blocks after the last index entry, which are all blocks of a file that was not closed
+    for (uint64_t offset = closed ? last_block : _blocks_end; offset && offset < _size;)
+    {
+        const ArchiveBlockHeader *block = block_at(offset);
+
+        if (!block || (closed && offset >= _blocks_end))
+            break;
+
+        if (!closed)
+            _index.push_back({block->start_time_ns, block->first_sample, offset});
+
+        last_block = offset;
+        offset += archive_block_size(block->payload_size);
+
+        if (!closed)
+            _blocks_end = offset;
+    }
+
+    if (_index.empty())
+        return;
+
+    const ArchiveBlockHeader *first = block_at(_index.front().offset);
+    const ArchiveBlockHeader *last = block_at(last_block);
+
+    if (!first || !last)
+        throw std::runtime_error(_path.string() + " has a damaged index");
+
+    _start_time_ns = first->start_time_ns;
+    _n_frames = last->first_sample + last->n_frames - first->first_sample;
+}
+
+int64_t RecordingFile::end_time_ns() const
+{
+    return _start_time_ns + std::llround(_n_frames * 1e9 / _sample_rate);
+}
+
+std::vector<RecordingSegment> RecordingFile::segments(int64_t begin_ns, int64_t end_ns) const
+{
+    std::vector<RecordingSegment> result;
+    const uint32_t frame_size = _n_channels * _bytes_per_sample;
+
+    // trims a run of frames to the range
+    auto add = [&](int64_t start_ns, uint64_t n_frames, const uint8_t *data, uint32_t gap_mask, bool discontinuity,
+                   std::span<const ArchiveStatusRecord> status = {})
+    {
+        const uint64_t first = frame_at(start_ns, _sample_rate, n_frames, begin_ns);
+        const uint64_t last = frame_at(start_ns, _sample_rate, n_frames, end_ns);
+
+        if (first >= last)
+            return;
+
+        auto status_begin = std::partition_point(status.begin(), status.end(), [&](const ArchiveStatusRecord &r)
+                                                 { return r.frame < first; });
+        auto status_end = std::partition_point(status_begin, status.end(), [&](const ArchiveStatusRecord &r)
+                                               { return r.frame < last; });
+
+        result.push_back({.start_time_ns = start_ns + std::llround(first * 1e9 / _sample_rate),
+                          .n_frames = last - first,
+                          .gap_mask = gap_mask,
+                          .discontinuity = discontinuity && first == 0,
+                          .data = std::span<const uint8_t>(data + first * frame_size, (last - first) * frame_size),
+                          .status = std::span<const ArchiveStatusRecord>(status_begin, status_end),
+                          .block_frame = static_cast<uint32_t>(first)});
+    };
+
+    if (_format == Format::WAV)
+    {
+        add(_start_time_ns, _n_frames, _map + _data_offset, 0, false);
+        return result;
+    }
+
+    // the last indexed block that starts at or before the range
+    auto entry = std::upper_bound(_index.begin(), _index.end(), begin_ns, [](int64_t time, const ArchiveIndexEntry &e)
+                                  { return time < e.start_time_ns; });
+
+    uint64_t offset = entry == _index.begin() ? (_index.empty() ? _blocks_end : entry->offset) : std::prev(entry)->offset;
+
+    while (offset < _blocks_end)
+    {
+        const ArchiveBlockHeader *block = block_at(offset);
+
+        if (!block)
+        {
+            LOG(ERROR) << _path << " has a damaged block at offset " << offset;
+            break;
+        }
+
+        if (block->start_time_ns >= end_ns)
+            break;
+
+        const uint8_t *payload = reinterpret_cast<const uint8_t *>(block + 1);
+        const uint32_t frames_size = block->n_frames * frame_size;
+        std::span<const ArchiveStatusRecord> status;
+
+        if (block->flags & ARCHIVE_STATUS && block->payload_size > frames_size)
+            status = std::span(reinterpret_cast<const ArchiveStatusRecord *>(payload + frames_size),
+                               (block->payload_size - frames_size) / sizeof(ArchiveStatusRecord));
+
+        add(block->start_time_ns, block->n_frames, payload, block->gap_mask, block->flags & ARCHIVE_DISCONTINUITY, status);
+
+        offset += archive_block_size(block->payload_size);
+    }
+
+    return result;
+}
+
+uint64_t RecordingFile::verify() const
+{
+    if (_format == Format::WAV)
+        return 0;
+
+    uint64_t damaged = 0;
+
+    for (uint64_t offset = sizeof(ArchiveFileHeader); offset < _blocks_end;)
+    {
+        const ArchiveBlockHeader *block = block_at(offset);
+
+        // the following blocks cannot be found without this header
+        if (!block)
+            return damaged + 1;
+
+        if (block->payload_crc != crc32c(block + 1, block->payload_size))
+            damaged++;
+
+        offset += archive_block_size(block->payload_size);
+    }
+
+    return damaged;
+}
+
+void RecordingFile::unpack(std::span<const uint8_t> data, uint16_t bytes_per_sample, int32_t *out)
+{
+    const size_t n = data.size() / bytes_per_sample;
+
+    if (bytes_per_sample == 3)
+    {
+        unpack_int24(data.data(), out, n);
+        return;
+    }
+
+    // sign extends samples of 1, 2 or 4 bytes
+    const int shift = 32 - 8 * bytes_per_sample;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t value = 0;
+        std::memcpy(&value, data.data() + i * bytes_per_sample, bytes_per_sample);
+
+        out[i] = static_cast<int32_t>(value << shift) >> shift;
+    }
+}
+
+RecordingReader::RecordingReader(const std::filesystem::path &directory)
+{
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+    {
+        int64_t time_ns;
+        const auto extension = entry.path().extension();
+
+        if (entry.is_regular_file() && (extension == ".wav" || extension == ".drga") && recording_name_time(entry.path(), time_ns))
+            _files.emplace_back(time_ns, entry.path());
+    }
+
+    std::sort(_files.begin(), _files.end());
+}
+
+RecordingFile &RecordingReader::file(const std::filesystem::path &path)
+{
+    auto it = _open.find(path);
+
+    if (it == _open.end())
+        it = _open.emplace(path, std::make_unique<RecordingFile>(path)).first;
+
+    return *it->second;
+}
+
+std::vector<std::filesystem::path> RecordingReader::paths() const
+{
+    std::vector<std::filesystem::path> result;
+
+    for (const auto &[time, path] : _files)
+        result.push_back(path);
+
+    return result;
+}
+
+std::vector<RecordingFile *> RecordingReader::files(int64_t begin_ns, int64_t end_ns)
+{
+    std::vector<RecordingFile *> result;
+
+    // names hold whole seconds, so the file before the one named at or before the range may hold its start
+    auto it = std::upper_bound(_files.begin(), _files.end(), begin_ns, [](int64_t time, const auto &f)
+                               { return time < f.first; });
+
+    for (int skip = 0; skip < 2 && it != _files.begin(); skip++)
+        --it;
+
+    for (; it != _files.end() && it->first < end_ns; ++it)
+    {
+        try
+        {
+            RecordingFile &f = file(it->second);
+
+            if (f.end_time_ns() > begin_ns && f.start_time_ns() < end_ns)
+                result.push_back(&f);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(WARNING) << "skipping " << it->second << ": " << e.what();
+        }
+    }
+
+    return result;
+}
+
+std::vector<RecordingSegment> RecordingReader::query(int64_t begin_ns, int64_t end_ns)
+{
+    std::vector<RecordingSegment> result;
+
+    for (RecordingFile *f : files(begin_ns, end_ns))
+    {
+        std::vector<RecordingSegment> segments = f->segments(begin_ns, end_ns);
+
+        result.insert(result.end(), segments.begin(), segments.end());
+    }
+
+    return result;
+}
+
+std::vector<int32_t> RecordingReader::read(int64_t begin_ns, int64_t end_ns, int64_t &start_time_ns)
+{
+    std::vector<RecordingFile *> range = files(begin_ns, end_ns);
+    std::vector<int32_t> samples;
+
+    start_time_ns = 0;
+
+    if (range.empty())
+        return samples;
+
+    const uint16_t n_channels = range.front()->n_channels();
+
+    for (RecordingFile *f : range)
+    {
+        if (f->n_channels() != n_channels)
+            throw std::runtime_error(f->path().string() + " has a different number of channels");
+
+        for (const RecordingSegment &segment : f->segments(begin_ns, end_ns))
+        {
+            if (samples.empty())
+                start_time_ns = segment.start_time_ns;
+
+            const size_t start = samples.size();
+            samples.resize(start + segment.n_frames * n_channels);
+
+            RecordingFile::unpack(segment.data, f->bytes_per_sample(), samples.data() + start);
+        }
+    }
+
+    return samples;
+}
@@ -0,0 +1,123 @@
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+#include "easylogging++.h"
+
+#include "RecordingSink.h"
+
+static std::chrono::system_clock::time_point to_time_point(int64_t time_ns)
+{
+    return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(time_ns)));
+}
+
+RecordingSink::RecordingSink(std::unique_ptr<RecordingWriter> writer, const std::filesystem::path &data_path)
+    : _writer(std::move(writer)), _data_path(data_path)
+{
+}
+
+std::string RecordingSink::file_name(const std::chrono::system_clock::time_point &start_time) const
+{
+    std::stringstream ss;
+    time_t in_time_t = std::chrono::system_clock::to_time_t(start_time);
+    ss << std::put_time(std::localtime(&in_time_t), "date-%Y-%m-%d-time-%H-%M-%S") << _writer->extension();
+
+    return ss.str();
+}
+
+void RecordingSink::set_end_time(int64_t time_ns)
+{
+    std::stringstream ss;
+    time_t in_time_t = std::chrono::system_clock::to_time_t(to_time_point(time_ns));
+    ss << "end time: " << std::put_time(std::localtime(&in_time_t), "%Y/%m/%d %H:%M:%S");
+
+    // tells a clipped geophone from a large signal without reading the samples
+    auto list = [&](const std::vector<uint32_t> &counts)
+    {
+        for (size_t c = 0; c < counts.size(); c++)
+            ss << (c ? "," : "") << counts[c];
+    };
+
+    ss << ", overflow samples: ";
+    list(_overflow_samples);
+    ss << ", low supply samples: ";
+    list(_supply_samples);
+
+    _writer->set_comments(ss.str());
+}
+
+void RecordingSink::consume(const std::shared_ptr<const SampleBlock> &block)
+{
+    if (block->file_start_ns)
+    {
+        const auto start = to_time_point(block->file_start_ns);
+
+        // the previous file ends where the new one begins
+        if (!_current_file.empty())
+        {
+            set_end_time(block->file_start_ns);
+
+            WriteLatency latency = _writer->take_write_latency();
+
+            LOG(INFO) << "storage: " << latency.writes << " writes, " << latency.bytes << " bytes, latency mean "
+                      << latency.mean_ms << " ms, max " << latency.max_ms << " ms";
+        }
+
+        _writer->close_file();
+
+        _current_file = _data_path / file_name(start);
+        _writer->open_file(_current_file.string());
+        _writer->set_datetime(start);
+
+        _overflow_samples.assign(block->n_channels, 0);
+        _supply_samples.assign(block->n_channels, 0);
+
+        // the next file is opened ahead, so the rotation does not wait for the file system
+        if (block->next_file_start_ns)
+            _writer->prepare_file((_data_path / file_name(to_time_point(block->next_file_start_ns))).string());
+    }
+
+    if (_current_file.empty())
+        return;
+
+    const uint32_t n_frames = block->n_frames();
+
+    if (block->gap_mask)
+        _writer->mark_gaps(block->gap_mask);
+
+    for (const FrameStatus &status : block->status)
+    {
+        _writer->mark_status(status.frame, status.overflow, status.supply);
+
+        for (uint32_t c = 0; c < _overflow_samples.size(); c++)
+        {
+            _overflow_samples[c] += (status.overflow >> c) & 0x1;
+            _supply_samples[c] += (status.supply >> c) & 0x1;
+        }
+    }
+
+    _writer->write_frames(block->samples, n_frames);
+
+    _end_time_ns = block->start_time_ns + std::llround(n_frames * 1e9 / block->sample_rate);
+}
+
+void RecordingSink::finish()
+{
+    if (_current_file.empty())
+        return;
+
+    set_end_time(_end_time_ns);
+    _writer->close_file();
+}
+
+void RecordingSink::delete_last_file(void)
+{
+    _writer->close_file();
+    _writer->flush();
+
+    if (!_current_file.empty())
+        for (const std::string &name : _writer->file_names(_current_file.string()))
+            std::filesystem::remove(name);
+
+    _current_file.clear();
+}
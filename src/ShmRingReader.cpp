@@ -0,0 +1,145 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <system_error>
+
+#include "ShmRingReader.h"
+
+ShmRingReader::ShmRingReader(const std::string &name) : _name(name)
+{
+    const int fd = shm_open(_name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "could not open shared memory " + _name);
+
+    struct stat st;
+    void *memory = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmRingHeader))
+        memory = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    const int error = errno;
+    ::close(fd);
+
+    if (memory == MAP_FAILED)
+        throw std::system_error(error, std::system_category(), "could not map shared memory " + _name);
+
+    _size = st.st_size;
+    _header = static_cast<const ShmRingHeader *>(memory);
+
+    const bool valid = _header->magic == SHM_RING_MAGIC && _header->version == SHM_RING_VERSION &&
+                       _header->data_offset + _header->capacity_frames * _header->n_channels * sizeof(int32_t) <= _size;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (!valid)
+    {
+        munmap(memory, _size);
+        throw std::runtime_error(_name + " is not a Drongo ring or is still being created");
+    }
+
+    _data = reinterpret_cast<const int32_t *>(static_cast<const uint8_t *>(memory) + _header->data_offset);
+    _position = _header->write_end.load(std::memory_order_acquire);
+}
+
+ShmRingReader::~ShmRingReader()
+{
+    munmap(const_cast<ShmRingHeader *>(_header), _size);
+}
+
+ShmStreamInfo ShmRingReader::info(void) const
+{
+    ShmStreamInfo info;
+    info.n_channels = _header->n_channels;
+
+    while (true)
+    {
+        const uint32_t sequence = _header->sequence.load(std::memory_order_acquire);
+
+        if (sequence & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        info.generation = _header->generation.load(std::memory_order_relaxed);
+        info.first_frame = _header->first_frame.load(std::memory_order_relaxed);
+        info.start_time_ns = _header->start_time_ns.load(std::memory_order_relaxed);
+        info.sample_rate = _header->sample_rate.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (_header->sequence.load(std::memory_order_relaxed) == sequence)
+            return info;
+    }
+}
+
+void ShmRingReader::rewind(void)
+{
+    const uint64_t end = _header->write_end.load(std::memory_order_acquire);
+
+    _position = end - std::min(end, _header->capacity_frames);
+}
+
+bool ShmRingReader::wait(std::chrono::milliseconds timeout, std::chrono::microseconds interval) const
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (!available())
+    {
+        if (closed() || std::chrono::steady_clock::now() >= deadline)
+            return false;
+
+        std::this_thread::sleep_for(interval);
+    }
+
+    return true;
+}
+
+ShmRingView ShmRingReader::peek(uint32_t max_frames)
+{
+    const uint64_t end = _header->write_end.load(std::memory_order_acquire);
+    const uint64_t capacity = _header->capacity_frames;
+    const uint32_t n_channels = _header->n_channels;
+
+    // the writer went round the ring past this reader
+    if (end - _position > capacity)
+    {
+        _lost += end - capacity - _position;
+        _position = end - capacity;
+    }
+
+    ShmRingView view;
+    view.first_frame = _position;
+    view.n_frames = std::min<uint64_t>(end - _position, max_frames);
+
+    const uint64_t slot = _position % capacity;
+    const uint64_t first_part = std::min<uint64_t>(view.n_frames, capacity - slot);
+
+    view.parts[0] = {_data + slot * n_channels, first_part * n_channels};
+    view.parts[1] = {_data, (view.n_frames - first_part) * n_channels};
+
+    return view;
+}
+
+bool ShmRingReader::consume(const ShmRingView &view)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // frames before begin - capacity may have been overwritten while the view was read
+    const uint64_t begin = _header->write_begin.load(std::memory_order_relaxed);
+    const bool valid = view.first_frame + _header->capacity_frames >= begin;
+
+    _position = std::max(_position, view.first_frame + view.n_frames);
+
+    if (!valid)
+        _lost += view.n_frames;
+
+    return valid;
+}
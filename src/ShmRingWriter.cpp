@@ -0,0 +1,128 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <system_error>
+
+#include "easylogging++.h"
+
+#include "ShmRingWriter.h"
+
+ShmRingWriter::ShmRingWriter(const std::string &name) : _name(name)
+{
+}
+
+ShmRingWriter::~ShmRingWriter()
+{
+    close();
+}
+
+void ShmRingWriter::open(uint16_t n_channels, uint64_t capacity_frames)
+{
+    close();
+
+    capacity_frames = std::max<uint64_t>(capacity_frames, 1);
+
+    const size_t data_offset = (sizeof(ShmRingHeader) + 4095) & ~size_t(4095);
+    const size_t size = data_offset + capacity_frames * n_channels * sizeof(int32_t);
+
+    // readers that still map a ring of an earlier run keep that one, it is marked closed below or was left by a crash
+    shm_unlink(_name.c_str());
+
+    const int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "could not create shared memory " + _name);
+
+    void *memory = MAP_FAILED;
+
+    if (ftruncate(fd, size) == 0)
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    const int error = errno;
+    ::close(fd);
+
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(_name.c_str());
+        throw std::system_error(error, std::system_category(), "could not map shared memory " + _name);
+    }
+
+    _size = size;
+    _header = new (memory) ShmRingHeader{};
+    _data = reinterpret_cast<int32_t *>(static_cast<uint8_t *>(memory) + data_offset);
+
+    _header->capacity_frames = capacity_frames;
+    _header->n_channels = n_channels;
+    _header->data_offset = data_offset;
+    _header->version = SHM_RING_VERSION;
+
+    // readers check the magic last, so they never see a half initialised header
+    std::atomic_thread_fence(std::memory_order_release);
+    _header->magic = SHM_RING_MAGIC;
+
+    LOG(INFO) << "shared memory ring " << _name << " holds " << capacity_frames << " frames";
+}
+
+void ShmRingWriter::close(void)
+{
+    if (!_header)
+        return;
+
+    _header->closed.store(1, std::memory_order_release);
+
+    munmap(_header, _size);
+    shm_unlink(_name.c_str());
+
+    _header = nullptr;
+    _data = nullptr;
+}
+
+void ShmRingWriter::start_stream(double sample_rate, int64_t start_time_ns)
+{
+    if (!_header)
+        return;
+
+    const uint32_t sequence = _header->sequence.load(std::memory_order_relaxed);
+
+    _header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _header->generation.fetch_add(1, std::memory_order_relaxed);
+    _header->first_frame.store(_header->write_end.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    _header->start_time_ns.store(start_time_ns, std::memory_order_relaxed);
+    _header->sample_rate.store(sample_rate, std::memory_order_relaxed);
+
+    _header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void ShmRingWriter::write(std::span<const int32_t> frames, uint32_t n_frames)
+{
+    if (!_header || !n_frames)
+        return;
+
+    const uint64_t capacity = _header->capacity_frames;
+    const uint32_t n_channels = _header->n_channels;
+
+    // a block longer than the ring only leaves its end in it
+    const uint64_t skipped = n_frames > capacity ? n_frames - capacity : 0;
+
+    frames = frames.subspan(skipped * n_channels);
+    n_frames -= skipped;
+
+    const uint64_t begin = _header->write_end.load(std::memory_order_relaxed) + skipped;
+
+    _header->write_begin.store(begin + n_frames, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const uint64_t slot = begin % capacity;
+    const uint64_t first_part = std::min<uint64_t>(n_frames, capacity - slot);
+
+    std::memcpy(_data + slot * n_channels, frames.data(), first_part * n_channels * sizeof(int32_t));
+    std::memcpy(_data, frames.data() + first_part * n_channels, (n_frames - first_part) * n_channels * sizeof(int32_t));
+
+    _header->write_end.store(begin + n_frames, std::memory_order_release);
+}
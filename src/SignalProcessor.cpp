@@ -0,0 +1,139 @@
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "SignalProcessor.h"
+
+void SignalProcessor::setup(uint16_t n_channels, double sample_rate, const SignalProcessorConfig &config)
+{
+    if (config.decimation == 0)
+        throw std::invalid_argument("decimation has to be at least 1");
+
+    if (config.lowpass_frequency >= sample_rate / 2)
+        throw std::invalid_argument("low-pass frequency has to be below the nyquist frequency");
+
+    _n_channels = n_channels;
+    _sample_rate = sample_rate;
+    _config = config;
+
+    _lowpass.resize(config.lowpass_frequency > 0 ? n_channels : 0);
+
+    for (auto &filter : _lowpass)
+        filter.setup(sample_rate, config.lowpass_frequency, config.lowpass_stopband_db);
+
+    _responses.resize(config.response_extension ? n_channels : 0);
+
+    for (auto &response : _responses)
+        setup_response_extension(response, sample_rate, config.response);
+
+    reset();
+}
+
+void SignalProcessor::reset()
+{
+    for (auto &filter : _lowpass)
+        filter.reset();
+
+    for (auto &response : _responses)
+        response.reset();
+
+    _previous.assign(_n_channels, 0);
+    _pending.assign(_n_channels, 0);
+    _has_pending = false;
+    _phase = 0;
+}
+
+void SignalProcessor::set_decimation_phase(uint64_t frames)
+{
+    _phase = frames % _config.decimation;
+}
+
+uint32_t SignalProcessor::fill_gaps(std::span<int32_t> frame, std::span<const int32_t> next)
+{
+    uint32_t gaps = 0;
+
+    for (uint32_t i = 0; i < _n_channels; i++)
+    {
+        if (_config.fill_gaps && frame[i] == 0)
+        {
+            frame[i] = (_previous[i] + next[i]) >> 1;
+            gaps |= 1u << i;
+        }
+
+        _previous[i] = frame[i];
+    }
+
+    return gaps;
+}
+
+void SignalProcessor::filter(std::span<int32_t> frame)
+{
+    for (uint32_t i = 0; i < _n_channels; i++)
+    {
+        double value = frame[i];
+
+        if (!_lowpass.empty())
+            value = _lowpass[i].filter(value);
+
+        if (!_responses.empty())
+            frame[i] = std::lround(std::clamp(_responses[i].filter(value), -8388608.0, 8388607.0));
+        else
+            frame[i] = value;
+    }
+}
+
+bool SignalProcessor::keep()
+{
+    if (_phase)
+    {
+        _phase--;
+        return false;
+    }
+
+    _phase = _config.decimation - 1;
+
+    return true;
+}
+
+uint32_t SignalProcessor::process(std::span<const int32_t> frames, size_t n_frames, std::vector<int32_t> &out)
+{
+    uint32_t gaps = 0;
+
+    for (size_t f = 0; f < n_frames; f++)
+    {
+        std::span<const int32_t> next = frames.subspan(f * _n_channels, _n_channels);
+
+        if (_has_pending)
+        {
+            gaps |= fill_gaps(_pending, next);
+            filter(_pending);
+
+            if (keep())
+                out.insert(out.end(), _pending.begin(), _pending.end());
+        }
+
+        std::copy(next.begin(), next.end(), _pending.begin());
+        _has_pending = true;
+    }
+
+    return gaps;
+}
+
+uint32_t SignalProcessor::flush(std::vector<int32_t> &out)
+{
+    if (!_has_pending)
+        return 0;
+
+    // the last frame has no successor, a gap takes the previous value
+    const std::vector<int32_t> next = _previous;
+
+    const uint32_t gaps = fill_gaps(_pending, next);
+    filter(_pending);
+
+    if (keep())
+        out.insert(out.end(), _pending.begin(), _pending.end());
+
+    _has_pending = false;
+
+    return gaps;
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+
+#include "easylogging++.h"
+
+#include "SinkFanout.h"
+
+SinkFanout::~SinkFanout()
+{
+    stop();
+}
+
+void SinkFanout::add(SampleSink &sink, SinkOptions options)
+{
+    auto worker = std::make_unique<Worker>();
+    worker->sink = &sink;
+    worker->options = options;
+    worker->options.max_backlog = std::max<size_t>(options.max_backlog, 1);
+
+    if (_running)
+        worker->thread = std::thread(&SinkFanout::run, std::ref(*worker));
+
+    _workers.push_back(std::move(worker));
+}
+
+void SinkFanout::remove(SampleSink &sink)
+{
+    auto worker = std::find_if(_workers.begin(), _workers.end(), [&](const auto &worker)
+                               { return worker->sink == &sink; });
+
+    if (worker == _workers.end())
+        return;
+
+    // a stopped fan-out already finished its outputs
+    if (_running)
+    {
+        {
+            std::lock_guard lock((*worker)->mtx);
+
+            (*worker)->stopping = true;
+            (*worker)->cv_data.notify_one();
+        }
+
+        stop_worker(**worker);
+    }
+
+    _workers.erase(worker);
+}
+
+void SinkFanout::clear(void)
+{
+    if (!_running)
+        _workers.clear();
+}
+
+void SinkFanout::start(void)
+{
+    if (_running)
+        return;
+
+    _running = true;
+
+    for (auto &worker : _workers)
+    {
+        worker->stopping = false;
+        worker->thread = std::thread(&SinkFanout::run, std::ref(*worker));
+    }
+}
+
+void SinkFanout::publish(std::shared_ptr<const SampleBlock> block)
+{
+    for (auto &worker : _workers)
+    {
+        std::unique_lock lock(worker->mtx);
+
+        if (worker->queue.size() >= worker->options.max_backlog)
+        {
+            if (worker->options.overflow == SinkOptions::Overflow::WAIT)
+                worker->cv_space.wait(lock, [&]()
+                                      { return worker->queue.size() < worker->options.max_backlog; });
+            else
+            {
+                worker->queue.pop_front();
+                worker->dropped++;
+            }
+        }
+
+        worker->queue.push_back(block);
+
+        worker->cv_data.notify_one();
+    }
+}
+
+void SinkFanout::stop(void)
+{
+    if (!_running)
+        return;
+
+    for (auto &worker : _workers)
+    {
+        std::lock_guard lock(worker->mtx);
+
+        worker->stopping = true;
+        worker->cv_data.notify_one();
+    }
+
+    for (auto &worker : _workers)
+        stop_worker(*worker);
+
+    _running = false;
+}
+
+void SinkFanout::stop_worker(Worker &worker)
+{
+    worker.thread.join();
+
+    if (worker.dropped)
+        LOG(WARNING) << worker.sink->sink_name() << " output dropped " << worker.dropped << " blocks in total";
+}
+
+void SinkFanout::run(Worker &worker)
+{
+    uint64_t reported_drops = 0;
+    auto report_time = std::chrono::steady_clock::now();
+
+    while (true)
+    {
+        std::shared_ptr<const SampleBlock> block;
+        uint64_t dropped;
+
+        {
+            std::unique_lock lock(worker.mtx);
+
+            worker.cv_data.wait(lock, [&]()
+                                { return !worker.queue.empty() || worker.stopping; });
+
+            // the waiting blocks are handled before stopping, so nothing published is lost
+            if (worker.queue.empty())
+                break;
+
+            block = std::move(worker.queue.front());
+            worker.queue.pop_front();
+            dropped = worker.dropped;
+        }
+
+        worker.cv_space.notify_one();
+
+        try
+        {
+            worker.sink->consume(block);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(ERROR) << worker.sink->sink_name() << " output failed on block " << block->sequence << ": " << e.what();
+        }
+
+        // drops are reported at most every 10 seconds
+        if (dropped != reported_drops && std::chrono::steady_clock::now() >= report_time)
+        {
+            LOG(WARNING) << worker.sink->sink_name() << " output is falling behind, " << dropped - reported_drops << " blocks dropped";
+
+            reported_drops = dropped;
+            report_time = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        }
+    }
+
+    try
+    {
+        worker.sink->finish();
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << worker.sink->sink_name() << " output failed to finish: " << e.what();
+    }
+}
@@ -0,0 +1,255 @@
+/**
+ * @file SpectrumAnalyzer.cpp
+ * @author Max Bensink (maxbensink@outlook.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <numbers>
+#include <stdexcept>
+
+#include "easylogging++.h"
+
+#include "Ads1258.h"
+#include "SpectrumAnalyzer.h"
+
+SpectrumAnalyzer::SpectrumAnalyzer()
+{
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    release_plan();
+}
+
+void SpectrumAnalyzer::release_plan(void)
+{
+    if (_plan)
+        fftw_destroy_plan(_plan);
+
+    fftw_free(_fft_in);
+    fftw_free(_fft_out);
+
+    _plan = nullptr;
+    _fft_in = nullptr;
+    _fft_out = nullptr;
+}
+
+void SpectrumAnalyzer::setup(uint16_t n_channels, double sample_rate, uint32_t fft_size, double overlap, double tile_seconds)
+{
+    if (fft_size < 16 || (fft_size & (fft_size - 1)))
+        throw std::invalid_argument("fft size has to be a power of two of at least 16");
+
+    if (overlap < 0 || overlap >= 1)
+        throw std::invalid_argument("overlap has to be in the range [0, 1)");
+
+    if (tile_seconds * sample_rate < fft_size)
+        throw std::invalid_argument("a tile has to contain at least one fft window");
+
+    release_plan();
+
+    _n_channels = n_channels;
+    _sample_rate = sample_rate;
+    _fft_size = fft_size;
+    _n_bins = fft_size / 2 + 1;
+    _hop_size = std::max<uint32_t>(1, std::lround(fft_size * (1 - overlap)));
+    _frames_per_tile = std::lround(tile_seconds * sample_rate);
+
+    _rings.assign(n_channels, SampleRing<double>(fft_size));
+
+    _window.resize(fft_size);
+
+    double window_power = 0;
+
+    for (uint32_t i = 0; i < fft_size; i++)
+    {
+        _window[i] = 0.5 - 0.5 * std::cos(2 * std::numbers::pi * i / fft_size);
+        window_power += _window[i] * _window[i];
+    }
+
+    // one-sided density, the doubling for the mirrored half is undone for DC and nyquist when writing
+    _psd_scale = 2.0 / (_sample_rate * window_power);
+
+    _fft_in = fftw_alloc_real(fft_size);
+    _fft_out = fftw_alloc_complex(_n_bins);
+
+    // planning is done once, the same buffers are reused for every channel and window
+    _plan = fftw_plan_dft_r2c_1d(fft_size, _fft_in, _fft_out, FFTW_MEASURE);
+
+    if (!_plan)
+        throw std::runtime_error("could not create fft plan");
+
+    _accumulator.assign(static_cast<size_t>(n_channels) * _n_bins, 0.0);
+    _n_averages = 0;
+
+    _frames_since_window = 0;
+    _frames_in_tile = 0;
+    _frames_total = 0;
+    _sequence_known = false;
+
+    LOG(INFO) << "spectrum analysis with " << fft_size << " point windows every " << _hop_size << " samples";
+}
+
+void SpectrumAnalyzer::set_output_path(const std::filesystem::path &path)
+{
+    _output_path = path;
+}
+
+void SpectrumAnalyzer::set_start_time(const std::chrono::system_clock::time_point &start_time)
+{
+    _start_time = start_time;
+    _frames_total = 0;
+    _frames_in_tile = 0;
+    _sequence_known = false;
+}
+
+void SpectrumAnalyzer::consume(const std::shared_ptr<const SampleBlock> &block)
+{
+    if (_sequence_known && block->sequence != _next_sequence)
+        skip_gap(block->sequence - _next_sequence, block->first_sample > _next_sample ? block->first_sample - _next_sample : 0);
+
+    _sequence_known = true;
+    _next_sequence = block->sequence + 1;
+    _next_sample = block->first_sample + block->n_frames();
+
+    const std::span<const int32_t> samples(block->samples);
+
+    for (size_t offset = 0; offset + block->n_channels <= samples.size(); offset += block->n_channels)
+        push_frame(samples.subspan(offset, block->n_channels));
+}
+
+void SpectrumAnalyzer::skip_gap(uint64_t missed_blocks, uint64_t missed_frames)
+{
+    LOG(WARNING) << "spectrum missed " << missed_blocks << " blocks (" << missed_frames << " frames), restarting the windows after the gap";
+
+    // the windows so far only hold data from before the gap, they end the tile
+    flush();
+
+    for (auto &ring : _rings)
+        ring.clear();
+
+    _frames_since_window = 0;
+
+    // keeps the next tile timestamped at the first frame after the gap
+    _frames_total += missed_frames;
+}
+
+void SpectrumAnalyzer::push_frame(std::span<const int32_t> samples)
+{
+    if (!_plan)
+        throw std::runtime_error("spectrum analyzer is not set up");
+
+    if (samples.size() != _n_channels)
+        throw std::runtime_error("Incorrect number of channels");
+
+    for (uint16_t c = 0; c < _n_channels; c++)
+        _rings[c].push(samples[c] * ADC_RAW_TO_DOUBLE_RATIO);
+
+    _frames_total++;
+    _frames_in_tile++;
+
+    if (++_frames_since_window >= _hop_size && _rings.front().full())
+    {
+        _frames_since_window = 0;
+
+        process_window();
+    }
+
+    if (_frames_in_tile >= _frames_per_tile)
+        flush();
+}
+
+void SpectrumAnalyzer::process_window(void)
+{
+    for (uint16_t c = 0; c < _n_channels; c++)
+    {
+        std::span<const double> history = _rings[c].latest(_fft_size);
+
+        for (uint32_t i = 0; i < _fft_size; i++)
+            _fft_in[i] = history[i] * _window[i];
+
+        fftw_execute(_plan);
+
+        double *acc = _accumulator.data() + static_cast<size_t>(c) * _n_bins;
+
+        for (uint32_t k = 0; k < _n_bins; k++)
+            acc[k] += _fft_out[k][0] * _fft_out[k][0] + _fft_out[k][1] * _fft_out[k][1];
+    }
+
+    _n_averages++;
+}
+
+void SpectrumAnalyzer::flush(void)
+{
+    if (_n_averages)
+        write_tile();
+
+    std::fill(_accumulator.begin(), _accumulator.end(), 0.0);
+
+    _n_averages = 0;
+    _frames_in_tile = 0;
+}
+
+void SpectrumAnalyzer::write_tile(void)
+{
+    const uint64_t first_frame = _frames_total - _frames_in_tile;
+
+    const auto tile_start = _start_time + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                              std::chrono::duration<double>(first_frame / _sample_rate));
+
+    std::stringstream ss;
+    time_t in_time_t = std::chrono::system_clock::to_time_t(tile_start);
+    ss << std::put_time(std::localtime(&in_time_t), "date-%Y-%m-%d-time-%H-%M-%S");
+
+    // a tile ended early by a gap can start in the same second as the next one
+    std::string file_name = ss.str() + ".psd";
+
+    for (int n = 1; std::filesystem::exists(_output_path / file_name); n++)
+        file_name = ss.str() + "-" + std::to_string(n) + ".psd";
+
+    std::ofstream file(_output_path / file_name, std::ios::binary);
+
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "could not open psd tile " << file_name;
+        return;
+    }
+
+    PsdTileHeader header = {
+        .magic = {PSD_TILE_MAGIC[0], PSD_TILE_MAGIC[1], PSD_TILE_MAGIC[2], PSD_TILE_MAGIC[3]},
+        .version = PSD_TILE_VERSION,
+        .n_channels = _n_channels,
+        .fft_size = _fft_size,
+        .n_bins = _n_bins,
+        .n_averages = _n_averages,
+        .sample_rate = _sample_rate,
+        .start_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(tile_start.time_since_epoch()).count(),
+        .duration_s = _frames_in_tile / _sample_rate};
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    std::vector<float> psd(_n_bins);
+
+    const double scale = _psd_scale / _n_averages;
+
+    for (uint16_t c = 0; c < _n_channels; c++)
+    {
+        const double *acc = _accumulator.data() + static_cast<size_t>(c) * _n_bins;
+
+        for (uint32_t k = 0; k < _n_bins; k++)
+            psd[k] = acc[k] * scale;
+
+        psd.front() *= 0.5f;
+        psd.back() *= 0.5f;
+
+        file.write(reinterpret_cast<const char *>(psd.data()), psd.size() * sizeof(float));
+    }
+}
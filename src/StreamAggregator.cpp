@@ -0,0 +1,157 @@
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "StreamAggregator.h"
+
+StreamAggregator::StreamAggregator(size_t n_units, uint16_t channels_per_unit, double max_delay)
+    : _units(n_units), _channels_per_unit(channels_per_unit), _frame_size(n_units * channels_per_unit), _max_delay(max_delay)
+{
+    if (n_units == 0 || n_units > MAX_UNITS)
+        throw std::invalid_argument("between 1 and " + std::to_string(MAX_UNITS) + " units can be merged");
+
+    for (size_t u = 0; u < n_units; u++)
+        _units[u].channel_offset = u * channels_per_unit;
+}
+
+double StreamAggregator::sample_rate(void)
+{
+    std::lock_guard lock(_mtx);
+
+    return _sample_rate;
+}
+
+void StreamAggregator::set_online(size_t unit, bool online)
+{
+    std::lock_guard lock(_mtx);
+
+    _units[unit].online = online;
+
+    // a unit that comes back starts a new stream, its blocks are placed by their time again
+    _units[unit].has_data = false;
+}
+
+void StreamAggregator::setup_grid(const StreamBlockHeader &header)
+{
+    _sample_rate = header.sample_rate;
+    _start_time_ns = header.start_time_ns;
+
+    // room for the longest wait plus a few blocks of the units that are ahead
+    _capacity = std::ceil((_max_delay + 4) * _sample_rate);
+    _frames.assign(_capacity * _frame_size, 0);
+    _present.assign(_capacity, 0);
+    _next_frame = 0;
+    _newest_frame = 0;
+}
+
+bool StreamAggregator::push(size_t unit, const StreamBlockHeader &header, std::span<const int32_t> samples)
+{
+    std::lock_guard lock(_mtx);
+
+    if (header.n_channels != _channels_per_unit || samples.size() < size_t(header.n_frames) * header.n_channels ||
+        (_sample_rate && std::abs(header.sample_rate - _sample_rate) > 1e-6 * _sample_rate) || header.sample_rate <= 0)
+    {
+        _stats.rejected_blocks++;
+        return false;
+    }
+
+    if (!_sample_rate)
+        setup_grid(header);
+
+    Unit &u = _units[unit];
+
+    int64_t first = std::llround((header.start_time_ns - _start_time_ns) * _sample_rate / 1e9);
+
+    // the frames of a unit follow each other, rounding its block times must not open or close single frame gaps
+    if (u.has_data && header.sequence == u.next_sequence && std::abs(first - u.expected_frame) <= 1)
+        first = u.expected_frame;
+
+    const int64_t end = first + header.n_frames;
+
+    // nothing is waiting, so a unit that returns after everything was handed out moves the grid forward
+    if (first >= int64_t(_next_frame + _capacity) && _newest_frame <= _next_frame)
+        _next_frame = _newest_frame = first;
+
+    u.has_data = true;
+    u.next_sequence = header.sequence + 1;
+    u.expected_frame = end;
+
+    const int64_t begin = std::max<int64_t>(first, _next_frame);
+    const int64_t stop = std::min<int64_t>(end, _next_frame + _capacity);
+
+    _stats.late_frames += std::clamp<int64_t>(_next_frame - first, 0, header.n_frames);
+    _stats.early_frames += std::clamp<int64_t>(end - int64_t(_next_frame + _capacity), 0, header.n_frames);
+
+    if (stop > int64_t(_newest_frame))
+        _newest_frame = stop;
+
+    const uint32_t bit = 1u << unit;
+
+    for (int64_t f = begin; f < stop; f++)
+    {
+        const uint64_t slot = f % _capacity;
+
+        std::copy_n(samples.data() + (f - first) * _channels_per_unit, _channels_per_unit, _frames.data() + slot * _frame_size + u.channel_offset);
+        _present[slot] |= bit;
+    }
+
+    return true;
+}
+
+void StreamAggregator::drain(int64_t now_ns, const Output &output, bool all)
+{
+    std::lock_guard lock(_mtx);
+
+    if (!_sample_rate)
+        return;
+
+    // frames are complete once every online unit is past them
+    const int64_t newest = _newest_frame;
+    int64_t ready = INT64_MAX;
+
+    for (const Unit &u : _units)
+        if (u.online)
+            ready = std::min(ready, u.has_data ? u.expected_frame : int64_t(_next_frame));
+
+    // units that are behind are only waited for max_delay, frames nobody delivered yet are never handed out
+    const int64_t overdue = std::floor((now_ns - _max_delay * 1e9 - _start_time_ns) * _sample_rate / 1e9) + 1;
+
+    const int64_t end = all ? newest : std::min(newest, std::max(ready == INT64_MAX ? newest : ready, overdue));
+    const uint32_t all_units = _units.size() == 32 ? UINT32_MAX : (1u << _units.size()) - 1;
+
+    while (int64_t(_next_frame) < end)
+    {
+        const uint64_t slot = _next_frame % _capacity;
+        const uint32_t present = _present[slot];
+
+        // a run ends where the units change or the buffer wraps
+        uint32_t n = 1;
+
+        while (int64_t(_next_frame + n) < end && slot + n < _capacity && _present[slot + n] == present)
+            n++;
+
+        std::span<int32_t> frames(_frames.data() + slot * _frame_size, size_t(n) * _frame_size);
+
+        output(frames, n, _next_frame, frame_time_ns(_next_frame), all_units & ~present);
+
+        std::fill(frames.begin(), frames.end(), 0);
+        std::fill_n(_present.begin() + slot, n, 0);
+
+        _stats.frames += n;
+
+        if (present != all_units)
+            _stats.missing_frames += n;
+
+        _next_frame += n;
+    }
+}
+
+AggregatorStats StreamAggregator::take_stats(void)
+{
+    std::lock_guard lock(_mtx);
+
+    AggregatorStats stats = _stats;
+    _stats = {};
+
+    return stats;
+}
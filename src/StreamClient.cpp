@@ -0,0 +1,90 @@
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include "StreamClient.h"
+
+StreamClient::StreamClient(const std::string &host, uint16_t port) : _name(host + ":" + std::to_string(port))
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *result = nullptr;
+
+    if (int error = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result))
+        throw std::runtime_error("could not resolve " + host + ": " + gai_strerror(error));
+
+    int error = 0;
+
+    for (addrinfo *ai = result; ai && _fd < 0; ai = ai->ai_next)
+    {
+        _fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+
+        if (_fd >= 0 && connect(_fd, ai->ai_addr, ai->ai_addrlen) < 0)
+        {
+            error = errno;
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+    freeaddrinfo(result);
+
+    if (_fd < 0)
+        throw std::system_error(error, std::system_category(), "could not connect to " + _name);
+
+    int one = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+StreamClient::~StreamClient()
+{
+    if (_fd >= 0)
+        ::close(_fd);
+}
+
+bool StreamClient::receive_all(void *data, size_t size)
+{
+    uint8_t *ptr = static_cast<uint8_t *>(data);
+
+    while (size)
+    {
+        const ssize_t n = recv(_fd, ptr, size, 0);
+
+        if (n == 0)
+            return false;
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            throw std::system_error(errno, std::system_category(), "could not receive from " + _name);
+        }
+
+        ptr += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+bool StreamClient::receive(StreamBlockHeader &header, std::vector<int32_t> &samples)
+{
+    if (!receive_all(&header, sizeof(header)))
+        return false;
+
+    if (header.magic != STREAM_MAGIC || header.version != STREAM_VERSION)
+        throw std::runtime_error(_name + " does not send a Drongo stream");
+
+    samples.resize(size_t(header.n_frames) * header.n_channels);
+
+    return receive_all(samples.data(), samples.size() * sizeof(int32_t));
+}
@@ -0,0 +1,298 @@
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <system_error>
+
+#include "easylogging++.h"
+
+#include "StreamServer.h"
+
+StreamServer::StreamServer(uint16_t port, size_t ring_blocks, SlowClientPolicy policy, const std::string &address)
+    : _port(port), _address(address), _ring_blocks(std::max<size_t>(ring_blocks, 1)), _policy(policy)
+{
+}
+
+StreamServer::~StreamServer()
+{
+    stop();
+}
+
+void StreamServer::start()
+{
+    if (_running)
+        return;
+
+    _listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (_listen_fd < 0)
+        throw std::system_error(errno, std::system_category(), "could not create stream socket");
+
+    int one = 1;
+    setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(_port);
+
+    if (inet_pton(AF_INET, _address.c_str(), &addr.sin_addr) != 1)
+    {
+        ::close(_listen_fd);
+        throw std::invalid_argument("invalid stream address " + _address);
+    }
+
+    socklen_t length = sizeof(addr);
+
+    if (bind(_listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(_listen_fd, 16) < 0 ||
+        getsockname(_listen_fd, reinterpret_cast<sockaddr *>(&addr), &length) < 0)
+    {
+        const int error = errno;
+        ::close(_listen_fd);
+        throw std::system_error(error, std::system_category(), "could not listen on port " + std::to_string(_port));
+    }
+
+    _port = ntohs(addr.sin_port);
+    _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    _running = true;
+    _thread = std::thread(&StreamServer::run, this);
+
+    LOG(INFO) << "streaming on " << _address << ":" << _port;
+}
+
+void StreamServer::stop()
+{
+    if (!_running)
+        return;
+
+    _running = false;
+
+    uint64_t one = 1;
+    (void)!write(_wake_fd, &one, sizeof(one));
+
+    _thread.join();
+
+    std::lock_guard lock(_clients_mtx);
+
+    for (auto &client : _clients)
+        ::close(client->fd);
+
+    _clients.clear();
+
+    ::close(_listen_fd);
+    ::close(_wake_fd);
+}
+
+size_t StreamServer::n_clients()
+{
+    std::lock_guard lock(_clients_mtx);
+
+    return _clients.size();
+}
+
+void StreamServer::publish(std::shared_ptr<const SampleBlock> block)
+{
+    {
+        std::lock_guard lock(_clients_mtx);
+
+        if (_clients.empty())
+            return;
+
+        for (auto &client : _clients)
+        {
+            if (client->count == _ring_blocks)
+            {
+                if (_policy == SlowClientPolicy::DISCONNECT)
+                {
+                    client->too_slow = true;
+                    continue;
+                }
+
+                // the oldest block goes, so a client that catches up again gets the most recent data
+                client->ring[client->head].reset();
+                client->head = (client->head + 1) % _ring_blocks;
+                client->count--;
+                client->skipped++;
+            }
+
+            client->ring[(client->head + client->count) % _ring_blocks] = block;
+            client->count++;
+        }
+    }
+
+    uint64_t one = 1;
+    (void)!write(_wake_fd, &one, sizeof(one));
+}
+
+void StreamServer::run()
+{
+    std::vector<pollfd> fds;
+
+    while (_running)
+    {
+        fds.assign({{_listen_fd, POLLIN, 0}, {_wake_fd, POLLIN, 0}});
+
+        {
+            std::lock_guard lock(_clients_mtx);
+
+            // clients without waiting blocks are only watched for a closed connection
+            for (auto &client : _clients)
+                fds.push_back({client->fd, static_cast<short>(POLLIN | (client->sending || client->count ? POLLOUT : 0)), 0});
+        }
+
+        if (poll(fds.data(), fds.size(), 500) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            LOG(ERROR) << "stream server poll failed: " << std::strerror(errno);
+            break;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            uint64_t count;
+            (void)!read(_wake_fd, &count, sizeof(count));
+        }
+
+        if (fds[0].revents & POLLIN)
+            accept_clients();
+
+        // only this thread adds or removes clients, so indices match the poll set
+        for (size_t i = fds.size() - 2; i-- > 0;)
+        {
+            Client &client = *_clients[i];
+            const short revents = fds[i + 2].revents;
+            bool keep = !client.too_slow;
+
+            if (keep && revents & (POLLERR | POLLHUP))
+                keep = false;
+
+            if (keep && revents & POLLIN)
+            {
+                char scratch[256];
+                const ssize_t n = recv(client.fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+
+                keep = n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+            }
+
+            if (keep && revents & POLLOUT)
+                keep = send_blocks(client);
+
+            // skips are reported at most once a second, a stalled client would flood the log otherwise
+            if (client.skipped != client.reported_skips && std::chrono::steady_clock::now() >= client.report_time)
+            {
+                LOG(WARNING) << "stream client " << client.peer << " is too slow, skipped " << client.skipped - client.reported_skips << " blocks";
+                client.reported_skips = client.skipped;
+                client.report_time = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            }
+
+            if (!keep)
+                remove_client(i);
+        }
+    }
+}
+
+void StreamServer::accept_clients()
+{
+    while (true)
+    {
+        sockaddr_in addr{};
+        socklen_t length = sizeof(addr);
+
+        const int fd = accept4(_listen_fd, reinterpret_cast<sockaddr *>(&addr), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd < 0)
+            return;
+
+        // blocks are sent as soon as they are published
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        char address[INET_ADDRSTRLEN] = {};
+        inet_ntop(AF_INET, &addr.sin_addr, address, sizeof(address));
+
+        auto client = std::make_unique<Client>();
+        client->fd = fd;
+        client->peer = std::string(address) + ":" + std::to_string(ntohs(addr.sin_port));
+        client->ring.resize(_ring_blocks);
+
+        LOG(INFO) << "stream client " << client->peer << " connected";
+
+        std::lock_guard lock(_clients_mtx);
+        _clients.push_back(std::move(client));
+    }
+}
+
+bool StreamServer::send_blocks(Client &client)
+{
+    while (true)
+    {
+        if (!client.sending)
+        {
+            std::lock_guard lock(_clients_mtx);
+
+            if (!client.count)
+                return true;
+
+            client.sending = std::move(client.ring[client.head]);
+            client.head = (client.head + 1) % _ring_blocks;
+            client.count--;
+        }
+
+        if (!client.sent)
+            client.header = stream_header(*client.sending);
+
+        const size_t payload = client.sending->samples.size() * sizeof(int32_t);
+        const uint8_t *samples = reinterpret_cast<const uint8_t *>(client.sending->samples.data());
+
+        // the samples are sent from the shared block, only the header is built per client
+        iovec iov[2];
+        int n_iov = 0;
+
+        if (client.sent < sizeof(StreamBlockHeader))
+            iov[n_iov++] = {reinterpret_cast<uint8_t *>(&client.header) + client.sent, sizeof(StreamBlockHeader) - client.sent};
+
+        const size_t payload_sent = client.sent > sizeof(StreamBlockHeader) ? client.sent - sizeof(StreamBlockHeader) : 0;
+
+        if (payload_sent < payload)
+            iov[n_iov++] = {const_cast<uint8_t *>(samples + payload_sent), payload - payload_sent};
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n_iov;
+
+        const ssize_t n = sendmsg(client.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+
+        client.sent += n;
+
+        if (client.sent < sizeof(StreamBlockHeader) + payload)
+            return true;
+
+        client.sending.reset();
+        client.sent = 0;
+    }
+}
+
+void StreamServer::remove_client(size_t index)
+{
+    std::lock_guard lock(_clients_mtx);
+
+    Client &client = *_clients[index];
+
+    LOG(INFO) << "stream client " << client.peer << (client.too_slow ? " disconnected for being too slow" : " disconnected");
+
+    ::close(client.fd);
+    _clients.erase(_clients.begin() + index);
+}
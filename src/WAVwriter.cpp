@@ -1,3 +1,15 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "easylogging++.h"
+
+#include "utils/Pack24Neon.h"
+
 #include "WAVwriter.h"
 
 // Main chunk descriptor
@@ -15,13 +27,36 @@ constexpr int16_t _audio_format = 1;    // PCM
 // Subchunk2 (data subchunk)
 const std::string subchunk2_id = "data";
 
+constexpr uint32_t _header_size = 44;
+
+// MAPPED mode
+constexpr uint32_t _info_reserve = 512;        // room for the INFO chunk, a JUNK chunk until the file is closed
+constexpr uint64_t _writeback_chunk = 1 << 20; // writeback is started per aligned chunk of this size
+
 template <class T>
-void write_as_bytes(std::ostream &_output_file, const T &obj)
+void write_as_bytes(std::vector<uint8_t> &bytes, const T &obj)
 {
-    const char *ptr = reinterpret_cast<const char *>(&obj);
+    const uint8_t *ptr = reinterpret_cast<const uint8_t *>(&obj);
 
-    // Write obj to stream
-    _output_file.write(ptr, sizeof(obj));
+    // Append obj to the byte block
+    bytes.insert(bytes.end(), ptr, ptr + sizeof(obj));
+}
+
+void write_as_bytes(std::vector<uint8_t> &bytes, const std::string &str)
+{
+    bytes.insert(bytes.end(), str.begin(), str.end());
+}
+
+void pack_samples(const int32_t *samples, uint8_t *out, size_t n_samples, uint16_t bytes_per_sample)
+{
+    if (bytes_per_sample == 3)
+    {
+        pack_int24(samples, out, n_samples);
+        return;
+    }
+
+    for (size_t i = 0; i < n_samples; i++)
+        std::memcpy(out + i * bytes_per_sample, samples + i, bytes_per_sample);
 }
 
 WAVWriter::WAVWriter()
@@ -41,6 +76,7 @@ WAVWriter::WAVWriter(uint8_t num_channels, uint32_t sample_rate, uint8_t bits_pe
 WAVWriter::~WAVWriter()
 {
     close_file();
+    discard_prepared();
 }
 
 void WAVWriter::set_comments(const std::string &comment)
@@ -53,33 +89,66 @@ void WAVWriter::set_datetime(const std::chrono::system_clock::time_point &dateti
     _datetime = datetime;
 }
 
+void WAVWriter::set_mode(Mode mode, uint64_t frames_per_file)
+{
+    if (mode == Mode::MAPPED && frames_per_file == 0)
+        throw std::invalid_argument("MAPPED mode needs the number of frames per file");
+
+    _mode = mode;
+    _frames_per_file = frames_per_file;
+}
+
 void WAVWriter::open_file(const std::string &file_name)
 {
-    if (_output_file.is_open())
+    if (_is_open)
         close_file();
 
-    _output_file.open(file_name, std::ios::binary);
+    _io.start();
 
-    if (!_output_file.is_open())
-        throw std::runtime_error("Could not open file for writing: " + file_name);
+    if (_mode == Mode::MAPPED)
+    {
+        open_mapped(file_name);
+        return;
+    }
+
+    // the file is created on the storage thread, a failure is reported there
+    _file = _io.open(file_name);
+    _is_open = true;
 
     write_wav_header();
 }
 
 void WAVWriter::close_file()
 {
-    if (_output_file.is_open())
+    if (_is_open && _mode == Mode::MAPPED)
+    {
+        close_mapped();
+    }
+    else if (_is_open)
     {
+        submit_buffer();
+
         write_info_chunk();
         finalize_wav_header();
 
-        _output_file.close();
+        _io.close(_file);
+        _is_open = false;
     }
 }
 
+void WAVWriter::flush()
+{
+    _io.wait_idle();
+}
+
+WriteLatency WAVWriter::take_write_latency()
+{
+    return _io.take_latency();
+}
+
 void WAVWriter::set_n_channels(uint16_t num_channels)
 {
-    if(_output_file.is_open())
+    if(_is_open)
         throw std::runtime_error("cannot update number of channels while file is open");
 
     _n_channels = num_channels;
@@ -90,7 +159,7 @@ void WAVWriter::set_n_channels(uint16_t num_channels)
 
 void WAVWriter::set_sample_rate(uint32_t sample_rate)
 {
-    if(_output_file.is_open())
+    if(_is_open)
         throw std::runtime_error("cannot update sample rate while file is open");
 
     _sample_rate = sample_rate;
@@ -101,7 +170,7 @@ void WAVWriter::set_sample_rate(uint32_t sample_rate)
 
 void WAVWriter::set_bits_per_sample(uint16_t bits_per_sample)
 {
-    if(_output_file.is_open())
+    if(_is_open)
         throw std::runtime_error("cannot update bits per sample while file is open");
 
     _bits_per_sample = bits_per_sample; 
@@ -115,68 +184,452 @@ void WAVWriter::set_bits_per_sample(uint16_t bits_per_sample)
 
 void WAVWriter::write_channels(const std::vector<int32_t> &samples)
 {
-    if (!_output_file.is_open())
-        throw std::runtime_error("File is not open for writing samples.");
-
     if (samples.size() != _n_channels)
         throw std::runtime_error("Incorrect number of channels");
 
-    _output_file.seekp(_current_data_chunk_pos);
+    write_frames(samples, 1);
+}
 
-    for (const auto &sample : samples)
-        _output_file.write(reinterpret_cast<const char *>(&sample), _bytes_to_write);
+void WAVWriter::write_frames(std::span<const int32_t> interleaved, size_t n_frames)
+{
+    if (interleaved.size() < n_frames * _n_channels)
+        throw std::runtime_error("Not enough samples for the requested number of frames");
 
-    _current_data_chunk_pos = _output_file.tellp();
+    append_samples(interleaved.data(), n_frames * _n_channels);
 }
 
 void WAVWriter::write_samples(const std::vector<int32_t> &samples)
 {
-    if (!_output_file.is_open())
+    append_samples(samples.data(), samples.size());
+}
+
+void WAVWriter::append_samples(const int32_t *samples, size_t n_samples)
+{
+    if (!_is_open)
         throw std::runtime_error("File is not open for writing samples.");
 
-    _output_file.seekp(_current_data_chunk_pos);
+    if (_mode == Mode::MAPPED)
+    {
+        const uint64_t n_bytes = n_samples * _bytes_to_write;
+
+        if (_data_size + n_bytes > _mapped.capacity)
+        {
+            // the file runs longer than planned, grow it by another file length
+            munmap(_mapped.map, _mapped.map_size);
+
+            _mapped.capacity += std::max<uint64_t>(_frames_per_file * _block_align, n_bytes);
+            map_file(_mapped, build_mapped_header(_mapped.capacity, _committed));
+        }
+
+        pack_samples(samples, _mapped.map + _header_size + _data_size, n_samples, _bytes_to_write);
+        _data_size += n_bytes;
+
+        sync_mapped();
+
+        if (_commit_frames && _data_size - _committed >= _commit_frames * _block_align)
+            commit();
+
+        return;
+    }
+
+    while (n_samples)
+    {
+        if (!_buffer)
+        {
+            _buffer = _io.acquire_buffer();
+            _buffer_offset = _header_size + _data_size;
+        }
+
+        const size_t n_fit = std::min<size_t>((_buffer->capacity - _buffer->size) / _bytes_to_write, n_samples);
+
+        if (n_fit == 0)
+        {
+            submit_buffer();
+            continue;
+        }
+
+        pack_samples(samples, _buffer->data + _buffer->size, n_fit, _bytes_to_write);
+
+        _buffer->size += n_fit * _bytes_to_write;
+        _data_size += n_fit * _bytes_to_write;
 
-    for (const auto &sample : samples)
-        _output_file.write(reinterpret_cast<const char *>(&sample), _bytes_to_write);
+        samples += n_fit;
+        n_samples -= n_fit;
+    }
 
-    _current_data_chunk_pos = _output_file.tellp();
+    if (_commit_frames && _data_size - _committed >= _commit_frames * _block_align)
+        commit();
 }
 
-void WAVWriter::write_wav_header()
+void WAVWriter::set_commit_interval(uint64_t frames)
+{
+    _commit_frames = frames;
+}
+
+void WAVWriter::commit()
+{
+    _committed = _data_size;
+
+    std::vector<uint8_t> sizes;
+    write_as_bytes(sizes, static_cast<uint32_t>(_header_size - 8 + _committed));
+
+    std::vector<uint8_t> data_size;
+    write_as_bytes(data_size, static_cast<uint32_t>(_committed));
+
+    // the sizes only become durable after the data they describe
+    if (_mode == Mode::MAPPED)
+    {
+        _io.run([fd = _mapped.fd, sizes = std::move(sizes), data_size = std::move(data_size)]()
+                {
+                    if (fdatasync(fd) < 0 ||
+                        pwrite(fd, sizes.data(), sizes.size(), 4) != static_cast<ssize_t>(sizes.size()) ||
+                        pwrite(fd, data_size.data(), data_size.size(), 40) != static_cast<ssize_t>(data_size.size()) ||
+                        fdatasync(fd) < 0)
+                        LOG(ERROR) << "Could not commit WAV sizes: " << std::strerror(errno); });
+        return;
+    }
+
+    submit_buffer();
+
+    _io.sync(_file);
+    _io.write(_file, 4, std::move(sizes));
+    _io.write(_file, 40, std::move(data_size));
+    _io.sync(_file);
+}
+
+bool WAVWriter::recover_file(const std::string &file_name)
+{
+    int fd = ::open(file_name.c_str(), O_RDWR | O_CLOEXEC);
+
+    if (fd < 0)
+        return false;
+
+    uint8_t header[_header_size];
+    struct stat st;
+
+    // only files with the fixed layout written here are touched
+    if (pread(fd, header, _header_size, 0) != _header_size || fstat(fd, &st) < 0 ||
+        std::memcmp(header, "RIFF", 4) || std::memcmp(header + 8, "WAVEfmt ", 8) || std::memcmp(header + 36, "data", 4))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    uint32_t riff_size, data_size;
+    uint16_t block_align;
+
+    std::memcpy(&riff_size, header + 4, sizeof(riff_size));
+    std::memcpy(&block_align, header + 32, sizeof(block_align));
+    std::memcpy(&data_size, header + 40, sizeof(data_size));
+
+    const uint64_t length = st.st_size;
+
+    if (riff_size != 0xdeadbeef && riff_size + 8 == length)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // trust the last committed size, or whatever reached the file when nothing was committed
+    uint64_t available = length - _header_size;
+    uint64_t recovered = (data_size != 0xdeadbeef && data_size <= available) ? data_size : available;
+
+    if (block_align)
+        recovered -= recovered % block_align;
+
+    const uint64_t pad = recovered % 2;
+
+    std::vector<uint8_t> sizes;
+    write_as_bytes(sizes, static_cast<uint32_t>(_header_size - 8 + recovered + pad));
+
+    std::vector<uint8_t> new_data_size;
+    write_as_bytes(new_data_size, static_cast<uint32_t>(recovered));
+
+    const uint8_t zero = 0;
+
+    bool success = ftruncate(fd, _header_size + recovered + pad) == 0 &&
+                   (!pad || pwrite(fd, &zero, 1, _header_size + recovered) == 1) &&
+                   pwrite(fd, sizes.data(), sizes.size(), 4) == static_cast<ssize_t>(sizes.size()) &&
+                   pwrite(fd, new_data_size.data(), new_data_size.size(), 40) == static_cast<ssize_t>(new_data_size.size()) &&
+                   fdatasync(fd) == 0;
+
+    ::close(fd);
+
+    if (!success)
+        throw std::runtime_error("Could not repair " + file_name + ": " + std::strerror(errno));
+
+    return true;
+}
+
+void WAVWriter::submit_buffer()
+{
+    if (!_buffer)
+        return;
+
+    // the buffer belongs to the storage thread until it has been written
+    _io.write(_file, _buffer_offset, _buffer);
+    _buffer = nullptr;
+}
+
+void WAVWriter::prepare_file(const std::string &file_name)
+{
+    if (_mode != Mode::MAPPED)
+        return;
+
+    discard_prepared();
+
+    _io.start();
+
+    const uint64_t capacity = _frames_per_file * _block_align;
+
+    auto promise = std::make_shared<std::promise<MappedFile>>();
+
+    _prepared = std::make_unique<PreparedFile>(PreparedFile{file_name, promise->get_future()});
+
+    _io.run([promise, file_name, capacity, header = build_mapped_header(capacity, 0)]()
+            {
+                try
+                {
+                    promise->set_value(create_mapped(file_name + PREPARED_SUFFIX, capacity, header));
+                }
+                catch (...)
+                {
+                    promise->set_exception(std::current_exception());
+                } });
+}
+
+void WAVWriter::discard_prepared()
+{
+    if (!_prepared)
+        return;
+
+    std::shared_ptr<PreparedFile> prepared = std::move(_prepared);
+
+    // runs after the task that creates the file, so the future is ready by then
+    _io.run([prepared]()
+            {
+                try
+                {
+                    MappedFile file = prepared->file.get();
+
+                    munmap(file.map, file.map_size);
+                    ::close(file.fd);
+                    std::remove((prepared->name + PREPARED_SUFFIX).c_str());
+                }
+                catch (...)
+                {
+                } });
+}
+
+void WAVWriter::open_mapped(const std::string &file_name)
+{
+    if (_prepared && _prepared->name == file_name)
+    {
+        // only waits when the storage thread has not gotten to it yet, rethrows its failure
+        std::unique_ptr<PreparedFile> prepared = std::move(_prepared);
+        _mapped = prepared->file.get();
+
+        // queued before any sync of the data, so only a file under its own name can hold data after a crash
+        _io.run([file_name]()
+                {
+                    if (std::rename((file_name + PREPARED_SUFFIX).c_str(), file_name.c_str()) < 0)
+                        LOG(ERROR) << "Could not rename prepared file " << file_name << ": " << std::strerror(errno); });
+    }
+    else
+    {
+        discard_prepared();
+
+        const uint64_t capacity = _frames_per_file * _block_align;
+        _mapped = create_mapped(file_name, capacity, build_mapped_header(capacity, 0));
+    }
+
+    _data_size = 0;
+    _info_size = 0;
+    _committed = 0;
+
+    _is_open = true;
+}
+
+std::vector<uint8_t> WAVWriter::build_mapped_header(uint64_t capacity, uint32_t committed)
+{
+    // with commits the header only covers committed data, so a crash never exposes frames that were not written
+    if (_commit_frames)
+        return build_wav_header(_header_size - 8 + committed, committed);
+
+    const uint64_t length = _header_size + capacity + capacity % 2 + _info_reserve;
+
+    return build_wav_header(length - 8, capacity);
+}
+
+WAVWriter::MappedFile WAVWriter::create_mapped(const std::string &file_name, uint64_t capacity, const std::vector<uint8_t> &header)
+{
+    MappedFile file;
+
+    file.fd = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (file.fd < 0)
+        throw std::runtime_error("Could not open file for writing: " + file_name + ": " + std::strerror(errno));
+
+    file.capacity = capacity;
+
+    try
+    {
+        map_file(file, header);
+    }
+    catch (...)
+    {
+        ::close(file.fd);
+        throw;
+    }
+
+    return file;
+}
+
+void WAVWriter::map_file(MappedFile &file, const std::vector<uint8_t> &header)
+{
+    const uint64_t pad = file.capacity % 2;
+
+    file.map_size = _header_size + file.capacity + pad + _info_reserve;
+
+    // reserve every block now, so the hot path never allocates and the file is not fragmented
+    if (fallocate(file.fd, 0, 0, file.map_size) < 0 && (errno != EOPNOTSUPP || ftruncate(file.fd, file.map_size) < 0))
+        throw std::runtime_error(std::string("Could not allocate file: ") + std::strerror(errno));
+
+    void *map = mmap(nullptr, file.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+
+    if (map == MAP_FAILED)
+        throw std::runtime_error(std::string("Could not map file: ") + std::strerror(errno));
+
+    file.map = static_cast<uint8_t *>(map);
+
+    madvise(file.map, file.map_size, MADV_SEQUENTIAL);
+
+    std::memcpy(file.map, header.data(), header.size());
+
+    // a JUNK chunk keeps the file valid until the INFO chunk is written over it
+    std::vector<uint8_t> junk;
+    write_as_bytes(junk, std::string("JUNK"));
+    write_as_bytes(junk, static_cast<int32_t>(_info_reserve - 8));
+    std::memcpy(file.map + _header_size + file.capacity + pad, junk.data(), junk.size());
+}
+
+void WAVWriter::sync_mapped()
+{
+    const uint64_t end = (_header_size + _data_size) & ~(_writeback_chunk - 1);
+
+    if (end <= _mapped.synced)
+        return;
+
+    // msync(MS_ASYNC) does not start writeback on Linux, sync_file_range does
+    _io.run([fd = _mapped.fd, offset = _mapped.synced, length = end - _mapped.synced]()
+            { sync_file_range(fd, offset, length, SYNC_FILE_RANGE_WRITE); });
+
+    _mapped.synced = end;
+}
+
+void WAVWriter::close_mapped()
+{
+    std::vector<uint8_t> info = build_info_chunk();
+    _info_size = info.size();
+
+    uint64_t length = _header_size + _data_size + _info_size;
+
+    // a full file keeps its length and sizes, the rest of the reserved room stays a JUNK chunk
+    if (_data_size == _mapped.capacity && length + 8 <= _mapped.map_size)
+    {
+        write_as_bytes(info, std::string("JUNK"));
+        write_as_bytes(info, static_cast<int32_t>(_mapped.map_size - length - 8));
+
+        length = _mapped.map_size;
+    }
+
+    // commits may have written smaller sizes, so the header is always rewritten
+    std::vector<uint8_t> header = build_wav_header(length - 8, _data_size);
+
+    // unmapping and the metadata updates are left to the storage thread
+    _io.run([file = _mapped, info = std::move(info), header = std::move(header), offset = _header_size + _data_size, length]()
+            {
+                munmap(file.map, file.map_size);
+
+                bool success = pwrite(file.fd, info.data(), info.size(), offset) == static_cast<ssize_t>(info.size());
+
+                success &= pwrite(file.fd, header.data(), header.size(), 0) == static_cast<ssize_t>(header.size());
+
+                if (length != file.map_size)
+                    success &= ftruncate(file.fd, length) == 0;
+
+                if (!success)
+                    LOG(ERROR) << "Could not finalize WAV file: " << std::strerror(errno);
+
+                sync_file_range(file.fd, file.synced, 0, SYNC_FILE_RANGE_WRITE);
+
+                ::close(file.fd); });
+
+    _mapped = {};
+    _is_open = false;
+}
+
+std::vector<uint8_t> WAVWriter::build_wav_header(uint32_t riff_size, uint32_t data_size)
 {
-    constexpr int32_t _placeholder = 0xdeadbeef; // Placeholder for when still determining size
+    std::vector<uint8_t> header;
+    header.reserve(_header_size);
 
     // Write the header information in the correct order
-    _output_file << _main_chunk_id;
-    write_as_bytes(_output_file, _placeholder);
-    _output_file << _format;
-    _output_file << _subchunk1_id;
-    write_as_bytes(_output_file, _subchunk1_size);
-    write_as_bytes(_output_file, _audio_format);
-    write_as_bytes(_output_file, _n_channels);
-    write_as_bytes(_output_file, _sample_rate);
-    write_as_bytes(_output_file, _byte_rate);
-    write_as_bytes(_output_file, _block_align);
-    write_as_bytes(_output_file, _bits_per_sample);
-    _output_file << subchunk2_id;
-    write_as_bytes(_output_file, _placeholder);
-    _current_data_chunk_pos = _output_file.tellp();
+    write_as_bytes(header, _main_chunk_id);
+    write_as_bytes(header, riff_size);
+    write_as_bytes(header, _format);
+    write_as_bytes(header, _subchunk1_id);
+    write_as_bytes(header, _subchunk1_size);
+    write_as_bytes(header, _audio_format);
+    write_as_bytes(header, _n_channels);
+    write_as_bytes(header, _sample_rate);
+    write_as_bytes(header, _byte_rate);
+    write_as_bytes(header, _block_align);
+    write_as_bytes(header, _bits_per_sample);
+    write_as_bytes(header, subchunk2_id);
+    write_as_bytes(header, data_size);
+
+    return header;
+}
+
+void WAVWriter::write_wav_header()
+{
+    constexpr uint32_t _placeholder = 0xdeadbeef; // Placeholder for when still determining size
+
+    _io.write(_file, 0, build_wav_header(_placeholder, _placeholder));
+
+    _data_size = 0;
+    _info_size = 0;
+    _committed = 0;
 }
 
 void WAVWriter::write_info_chunk()
 {
-    _output_file.seekp(0, std::ios::end);
+    std::vector<uint8_t> chunk = build_info_chunk();
+
+    _info_size = chunk.size();
+
+    _io.write(_file, _header_size + _data_size, std::move(chunk));
+}
+
+std::vector<uint8_t> WAVWriter::build_info_chunk()
+{
+    std::vector<uint8_t> chunk;
+
+    // chunks start on an even offset, an odd sized data chunk gets a pad byte
+    if (_data_size % 2)
+        write_as_bytes(chunk, static_cast<int8_t>(0x0));
 
     auto write_string_chunk = [&](const std::string &chunk_id, const std::string &str)
     {
-        _output_file << chunk_id; // Write the chunk ID
+        write_as_bytes(chunk, chunk_id); // Write the chunk ID
         int32_t str_len = str.size() + ((str.size() % 2) ? 1 : 2);
-        write_as_bytes(_output_file, static_cast<int32_t>(str_len)); // Write the size as little-endian
-        _output_file << str;                                         // Write the string data
+        write_as_bytes(chunk, static_cast<int32_t>(str_len)); // Write the size as little-endian
+        write_as_bytes(chunk, str);                           // Write the string data
         if (str.size() % 2)
-            write_as_bytes(_output_file, static_cast<int8_t>(0x0)); // Null terminator to end the string
+            write_as_bytes(chunk, static_cast<int8_t>(0x0)); // Null terminator to end the string
         else
-            write_as_bytes(_output_file, static_cast<int16_t>(0x0)); // 2 Null terminators to end the string
+            write_as_bytes(chunk, static_cast<int16_t>(0x0)); // 2 Null terminators to end the string
     };
 
     std::stringstream ss;
@@ -184,42 +637,35 @@ void WAVWriter::write_info_chunk()
     ss << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S");
 
     // Placeholder for LIST chunk size, to be overwritten later
-    _output_file << "LIST";
-    std::streampos size_pos = _output_file.tellp();
-    write_as_bytes(_output_file, static_cast<int32_t>(0xdeadbeef)); // Temporary size placeholder
+    write_as_bytes(chunk, std::string("LIST"));
+    size_t size_pos = chunk.size();
+    write_as_bytes(chunk, static_cast<int32_t>(0xdeadbeef)); // Temporary size placeholder
 
-    _output_file << "INFO"; // Write INFO
+    write_as_bytes(chunk, std::string("INFO")); // Write INFO
 
     // Write the ICRD and ICMT sub-chunks
     write_string_chunk("ICRD", ss.str());
     write_string_chunk("ICMT", _comments);
 
     // Go back and write the real size of the LIST chunk
-    std::streampos end_pos = _output_file.tellp();
-
-    _output_file.seekp(size_pos);
-    write_as_bytes(_output_file, static_cast<int32_t>(end_pos - size_pos - sizeof(int32_t))); // Write the size at the placeholder position
+    int32_t list_size = chunk.size() - size_pos - sizeof(int32_t);
+    std::memcpy(chunk.data() + size_pos, &list_size, sizeof(list_size));
 
-    // Restore the position to the end of the stream
-    _output_file.seekp(end_pos);
+    return chunk;
 }
 
 void WAVWriter::finalize_wav_header()
 {
-    if (!_output_file.is_open())
+    if (!_is_open)
         throw std::runtime_error("File is not open for finalizing WAV header.");
 
-    _output_file.seekp(0, std::ios::end);
-
-    std::streampos file_size = _output_file.tellp();
-
     // RIFF chunk size
-    int32_t chunk_size = static_cast<int32_t>(file_size) - 8;
-    _output_file.seekp(4, std::ios::beg);
-    write_as_bytes(_output_file, chunk_size);
+    std::vector<uint8_t> chunk_size;
+    write_as_bytes(chunk_size, static_cast<int32_t>(_header_size - 8 + _data_size + _info_size));
+    _io.write(_file, 4, std::move(chunk_size));
 
     // Subchunk2Size (data size)
-    int32_t subchunk2_size = static_cast<int32_t>(_current_data_chunk_pos) - 44;
-    _output_file.seekp(40, std::ios::beg);
-    write_as_bytes(_output_file, subchunk2_size);
-}
\ No newline at end of file
+    std::vector<uint8_t> subchunk2_size;
+    write_as_bytes(subchunk2_size, static_cast<int32_t>(_data_size));
+    _io.write(_file, 40, std::move(subchunk2_size));
+}
@@ -144,6 +144,40 @@ bool Gpio::wait_for_event(int line_id)
     };
 }
 
+bool Gpio::wait_for_event(int line_id, std::chrono::nanoseconds timeout)
+{
+    gpiod_line *line = retrieve_gpiod_line(line_id);
+
+    const timespec wait_spec = {
+        .tv_sec = static_cast<time_t>(timeout.count() / 1000000000),
+        .tv_nsec = static_cast<long>(timeout.count() % 1000000000)};
+
+    gpiod_line_event event;
+
+    switch (gpiod_line_event_wait(line, &wait_spec))
+    {
+    case 0:
+        return false;
+    case 1:
+        gpiod_line_event_read(line, &event);
+        return true;
+    default:
+        throw std::runtime_error("Could not detect for line " + std::to_string(line_id));
+    };
+}
+
+void Gpio::clear_events(int line_id)
+{
+    gpiod_line *line = retrieve_gpiod_line(line_id);
+
+    constexpr timespec no_wait = {.tv_sec = 0, .tv_nsec = 0};
+
+    gpiod_line_event event;
+
+    while (gpiod_line_event_wait(line, &no_wait) == 1)
+        gpiod_line_event_read(line, &event);
+}
+
 void Gpio::release_line(int line_id)
 {
     gpiod_line *line = retrieve_gpiod_line(line_id);
@@ -0,0 +1,192 @@
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <functional>
+
+#include "argparse/argparse.hpp"
+
+#define ELPP_NO_LOG_TO_FILE
+#include "easylogging++.h"
+
+#include "AcquisitionPlan.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+/**
+ * @brief What a read path achieved over the measured time.
+ */
+struct BenchResult
+{
+    uint64_t samples = 0;  ///< Conversions read with the NEW bit set.
+    uint64_t repeated = 0; ///< Reads of a conversion that was read before.
+    uint64_t missed = 0;   ///< Conversions of the scan that were never read.
+    uint64_t bytes = 0;    ///< Bytes clocked over the SPI bus.
+    double seconds = 0;
+};
+
+/**
+ * @brief Read with the given path for a while and count the samples, the conversions read twice and the ones
+ * skipped in the scan order.
+ *
+ * @param read fills the buffer with the next reads and returns how many it read and the bytes that took
+ */
+static BenchResult run(const std::vector<uint8_t> &scan, double seconds,
+                       const std::function<std::pair<size_t, size_t>(std::vector<ChannelData> &)> &read, size_t batch)
+{
+    std::vector<uint8_t> position(256, 0xFF);
+
+    for (size_t i = 0; i < scan.size(); i++)
+        position[scan[i]] = i;
+
+    std::vector<ChannelData> data(batch);
+    BenchResult result;
+    int32_t last = -1;
+
+    const auto begin = std::chrono::steady_clock::now();
+    const auto end = begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+        const auto [n_read, bytes] = read(data);
+        result.bytes += bytes;
+
+        for (size_t i = 0; i < n_read; i++)
+        {
+            if (!(data[i].flags & SAMPLE_NEW))
+            {
+                result.repeated++;
+                continue;
+            }
+
+            result.samples++;
+
+            const uint8_t now = position[data[i].channel];
+
+            if (now == 0xFF)
+                continue;
+
+            // the scan runs in a fixed order, any position jumped over is a conversion that was overwritten
+            if (last >= 0)
+                result.missed += (now + scan.size() - last - 1) % scan.size();
+
+            last = now;
+        }
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    return result;
+}
+
+static void report(const std::string &name, const BenchResult &result, double conversion_rate, double spi_mhz)
+{
+    const double rate = result.samples / result.seconds;
+
+    std::cout << std::fixed << std::setprecision(1) << name << ": " << rate << " samples/s ("
+              << 100 * rate / conversion_rate << "% of the conversions), "
+              << (result.samples ? double(result.bytes) / result.samples : 0) << " SPI bytes/sample, "
+              << rate / spi_mhz << " samples/s per SPI MHz, " << result.missed << " missed, "
+              << result.repeated << " read twice" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    argparse::ArgumentParser program("drongo_adc_bench");
+
+    program.add_argument("-c", "--channels")
+        .help("number of single ended channels to scan, counted down from AIN15")
+        .default_value(12)
+        .scan<'i', int>();
+
+    program.add_argument("--drate")
+        .help("DRATE setting of the ADC, 0 up to 3")
+        .default_value(3)
+        .scan<'i', int>();
+
+    program.add_argument("--dly")
+        .help("DLY setting of the ADC, 0 up to 7")
+        .default_value(0)
+        .scan<'i', int>();
+
+    program.add_argument("-s", "--seconds")
+        .help("time to measure each read path")
+        .default_value(5.0)
+        .scan<'g', double>();
+
+    program.add_argument("--spi_mhz")
+        .help("SPI clock in MHz")
+        .default_value(12.0)
+        .scan<'g', double>();
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what() << std::endl;
+        LOG(ERROR) << program;
+        return 1;
+    }
+
+    const int n_channels = program.get<int>("--channels");
+    const int drate = program.get<int>("--drate");
+    const int dly = program.get<int>("--dly");
+    const double seconds = program.get<double>("--seconds");
+    const double spi_mhz = program.get<double>("--spi_mhz");
+
+    if (n_channels < 1 || n_channels > 16 || drate < 0 || drate > 3 || dly < 0 || dly > 7)
+    {
+        LOG(ERROR) << "channels has to be between 1 and 16, drate between 0 and 3 and dly between 0 and 7";
+        return 1;
+    }
+
+    const uint16_t channels = ((1u << n_channels) - 1) << (16 - n_channels);
+    const double conversion_rate = drate_delay_to_frequency(AUTO_SCAN_RATES[drate], SWITCH_DELAYS_US[dly]);
+
+    try
+    {
+        Ads1258 adc("/dev/spidev0.0", "/dev/gpiochip0");
+
+        adc.set_spi_speed(std::lround(spi_mhz * 1e6));
+        adc.initialize(auto_scan_registers(channels, drate, dly), 3);
+        adc.start(true);
+
+        const std::vector<uint8_t> scan = adc.get_active_channels();
+        const auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1 / conversion_rate));
+
+        std::cout << "scanning " << scan.size() << " channels, " << std::fixed << std::setprecision(1)
+                  << conversion_rate << " conversions/s, SPI at " << spi_mhz << " MHz" << std::endl;
+
+        const BenchResult command = run(scan, seconds, [&](std::vector<ChannelData> &data) -> std::pair<size_t, size_t>
+                                        {
+                                            std::tie(data[0], data[1]) = adc.get_data_read();
+                                            return {2, 10}; }, 2);
+
+        report("read command", command, conversion_rate, spi_mhz);
+
+        // a new start drops the DRDY edges the read command left queued
+        adc.start(false);
+        adc.start(true);
+
+        const BenchResult direct = run(scan, seconds, [&](std::vector<ChannelData> &data) -> std::pair<size_t, size_t>
+                                       {
+                                           const size_t n_read = adc.get_data_direct(data, period);
+                                           return {n_read, n_read * 4}; }, scan.size());
+
+        report("direct read", direct, conversion_rate, spi_mhz);
+
+        adc.start(false);
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << e.what();
+        return 1;
+    }
+
+    return 0;
+}
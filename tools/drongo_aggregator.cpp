@@ -0,0 +1,288 @@
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <sys/socket.h>
+
+#include "argparse/argparse.hpp"
+
+#define ELPP_NO_LOG_TO_FILE
+#include "easylogging++.h"
+
+#include "StreamClient.h"
+#include "ArchiveWriter.h"
+#include "StreamAggregator.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+std::atomic_bool running = true;
+
+/**
+ * @brief A unit to receive from, with the connection so it can be interrupted when stopping.
+ */
+struct UnitConnection
+{
+    std::string host;
+    uint16_t port = STREAM_DEFAULT_PORT;
+
+    std::mutex mtx;
+    StreamClient *client = nullptr;
+};
+
+static void receive_unit(size_t unit, UnitConnection &connection, StreamAggregator &aggregator)
+{
+    // reused for every block, receiving does not allocate once the first blocks arrived
+    StreamBlockHeader header;
+    std::vector<int32_t> samples;
+    bool reported = false;
+
+    while (running)
+    {
+        try
+        {
+            StreamClient client(connection.host, connection.port);
+
+            {
+                std::lock_guard lock(connection.mtx);
+                connection.client = &client;
+            }
+
+            LOG(INFO) << "unit " << unit << " (" << client.name() << ") connected";
+            aggregator.set_online(unit, true);
+            reported = false;
+
+            while (running && client.receive(header, samples))
+                if (!aggregator.push(unit, header, samples) && !reported)
+                {
+                    LOG(ERROR) << "unit " << unit << " streams " << header.n_channels << " channels at " << header.sample_rate
+                               << " Hz, which does not match the other units, its blocks are dropped";
+                    reported = true;
+                }
+
+            if (running)
+                LOG(WARNING) << "unit " << unit << " (" << client.name() << ") disconnected";
+
+            std::lock_guard lock(connection.mtx);
+            connection.client = nullptr;
+        }
+        catch (const std::exception &e)
+        {
+            if (!reported)
+                LOG(WARNING) << "unit " << unit << ": " << e.what();
+
+            reported = true;
+        }
+
+        aggregator.set_online(unit, false);
+
+        // try again every two seconds
+        for (int i = 0; i < 20 && running; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+static std::string file_name(int64_t time_ns)
+{
+    std::stringstream ss;
+    time_t in_time_t = time_ns / 1000000000;
+    ss << std::put_time(std::localtime(&in_time_t), "date-%Y-%m-%d-time-%H-%M-%S") << ".drga";
+
+    return ss.str();
+}
+
+int main(int argc, char *argv[])
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    argparse::ArgumentParser program("drongo_aggregator");
+
+    program.add_argument("units")
+        .help("units to merge, as host or host:port")
+        .nargs(argparse::nargs_pattern::at_least_one);
+
+    program.add_argument("-o", "--output")
+        .help("folder of the merged archive")
+        .default_value(std::string("merged"));
+
+    program.add_argument("-c", "--channels")
+        .help("channels of every unit")
+        .default_value(12)
+        .scan<'i', int>();
+
+    program.add_argument("--max_delay")
+        .help("seconds to wait for units that are behind before their samples are marked missing")
+        .default_value(5.0)
+        .scan<'g', double>();
+
+    program.add_argument("--file_duration")
+        .help("length of the archive files in seconds")
+        .default_value(3600)
+        .scan<'i', int>();
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what() << std::endl;
+        LOG(ERROR) << program;
+        return 1;
+    }
+
+    std::signal(SIGINT, [](int)
+                { running = false; });
+    std::signal(SIGTERM, [](int)
+                { running = false; });
+
+    const auto names = program.get<std::vector<std::string>>("units");
+    const uint16_t channels = program.get<int>("--channels");
+    const int64_t file_ns = int64_t(std::max(1, program.get<int>("--file_duration"))) * 1000000000;
+    const std::filesystem::path output_path = program.get("--output");
+
+    std::vector<UnitConnection> connections(names.size());
+
+    for (size_t u = 0; u < names.size(); u++)
+    {
+        const size_t colon = names[u].rfind(':');
+
+        connections[u].host = names[u].substr(0, colon);
+
+        if (colon != std::string::npos)
+            connections[u].port = std::stoi(names[u].substr(colon + 1));
+    }
+
+    std::unique_ptr<StreamAggregator> aggregator;
+
+    try
+    {
+        aggregator = std::make_unique<StreamAggregator>(names.size(), channels, program.get<double>("--max_delay"));
+        std::filesystem::create_directories(output_path);
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << e.what();
+        return 1;
+    }
+
+    std::vector<std::thread> receivers;
+
+    for (size_t u = 0; u < connections.size(); u++)
+        receivers.emplace_back(receive_unit, u, std::ref(connections[u]), std::ref(*aggregator));
+
+    ArchiveWriter writer;
+    bool file_open = false;
+    double sample_rate = 0;
+    uint64_t expected_frame = 0;
+    uint64_t boundary_frame = 0;
+
+    // a new file starts at every file boundary and wherever the merged grid jumps because no unit sent data
+    auto open_file = [&](uint64_t frame, int64_t time_ns)
+    {
+        writer.close_file();
+
+        if (!file_open)
+        {
+            writer.set_n_channels(aggregator->n_channels());
+            writer.set_bits_per_sample(24);
+            writer.set_exact_sample_rate(sample_rate);
+            writer.set_merged(true);
+            writer.set_commit_interval(std::ceil(10 * sample_rate));
+        }
+
+        const std::filesystem::path path = output_path / file_name(time_ns);
+
+        writer.open_file(path.string());
+        writer.set_datetime(std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(time_ns))));
+
+        std::ofstream stations(std::filesystem::path(path).replace_extension(".stations.csv"));
+        stations << "unit,host,port,first_channel,n_channels\n";
+
+        for (size_t u = 0; u < connections.size(); u++)
+            stations << u << "," << connections[u].host << "," << connections[u].port << "," << u * channels << "," << channels << "\n";
+
+        const int64_t boundary_ns = (time_ns / file_ns + 1) * file_ns;
+        boundary_frame = frame + std::ceil((boundary_ns - time_ns) * sample_rate / 1e9);
+        file_open = true;
+    };
+
+    const StreamAggregator::Output output = [&](std::span<const int32_t> frames, uint32_t n_frames, uint64_t first_frame, int64_t start_time_ns, uint32_t missing)
+    {
+        if (!file_open || first_frame != expected_frame)
+            open_file(first_frame, start_time_ns);
+
+        while (n_frames)
+        {
+            if (first_frame == boundary_frame)
+                open_file(first_frame, start_time_ns);
+
+            const uint32_t n = std::min<uint64_t>(n_frames, boundary_frame - first_frame);
+
+            if (missing)
+                writer.mark_gaps(missing);
+
+            writer.write_frames(frames, n);
+
+            frames = frames.subspan(size_t(n) * aggregator->n_channels());
+            n_frames -= n;
+            first_frame += n;
+            start_time_ns += std::llround(n * 1e9 / sample_rate);
+        }
+
+        expected_frame = first_frame;
+    };
+
+    auto now_ns = []()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    };
+
+    auto report_time = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+    while (running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        // nothing can be merged before the first block fixed the sample rate
+        if ((sample_rate = aggregator->sample_rate()))
+            aggregator->drain(now_ns(), output);
+
+        if (std::chrono::steady_clock::now() < report_time)
+            continue;
+
+        const AggregatorStats stats = aggregator->take_stats();
+
+        LOG(INFO) << stats.frames << " frames merged, " << stats.missing_frames << " with units missing, " << stats.late_frames
+                  << " late and " << stats.early_frames << " early frames dropped, " << stats.rejected_blocks << " blocks rejected";
+
+        report_time += std::chrono::seconds(10);
+    }
+
+    // interrupt the receivers that wait for a block
+    for (auto &connection : connections)
+    {
+        std::lock_guard lock(connection.mtx);
+
+        if (connection.client)
+            shutdown(connection.client->fd(), SHUT_RDWR);
+    }
+
+    for (auto &receiver : receivers)
+        receiver.join();
+
+    if ((sample_rate = aggregator->sample_rate()))
+        aggregator->drain(now_ns(), output, true);
+
+    writer.close_file();
+    writer.flush();
+
+    LOG(INFO) << "merged archive closed";
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <string>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+
+#include "argparse/argparse.hpp"
+
+#define ELPP_NO_LOG_TO_FILE
+#include "easylogging++.h"
+
+#include "ControlServer.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+int main(int argc, char *argv[])
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    argparse::ArgumentParser program("drongo_control");
+
+    program.add_argument("command")
+        .help("reload, status or set {setting} {value}")
+        .nargs(argparse::nargs_pattern::at_least_one);
+
+    program.add_argument("-s", "--socket")
+        .help("path of the control socket")
+        .default_value(std::string(CONTROL_DEFAULT_SOCKET));
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what() << std::endl;
+        LOG(ERROR) << program;
+        return 1;
+    }
+
+    std::string command;
+
+    for (const std::string &word : program.get<std::vector<std::string>>("command"))
+        command += (command.empty() ? "" : " ") + word;
+
+    const std::string path = program.get("--socket");
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        LOG(ERROR) << "could not connect to " << path << ": " << std::strerror(errno);
+        return 1;
+    }
+
+    command += '\n';
+
+    if (send(fd, command.data(), command.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(command.size()))
+    {
+        LOG(ERROR) << "could not send the command: " << std::strerror(errno);
+        close(fd);
+        return 1;
+    }
+
+    // a reply ends with an empty line
+    std::string reply;
+    char buffer[512];
+    ssize_t n;
+
+    while (reply.find("\n\n") == std::string::npos && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        reply.append(buffer, n);
+
+    close(fd);
+
+    reply = reply.substr(0, reply.find("\n\n") + 1);
+
+    std::cout << reply;
+
+    return reply.starts_with("error") ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+#include <cmath>
+#include <ctime>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+#include "argparse/argparse.hpp"
+
+#define ELPP_NO_LOG_TO_FILE
+#include "easylogging++.h"
+
+#include "RecordingReader.h"
+#include "WAVwriter.h"
+#include "FlacWriter.h"
+#include "MiniSeedWriter.h"
+#include "ArchiveWriter.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+/**
+ * @brief Parse a local time such as "2026-10-19 12:00:00.250".
+ *
+ * @param text date and time with optional fractional seconds
+ * @return int64_t nanoseconds since the Unix epoch
+ */
+int64_t parse_time(const std::string &text)
+{
+    std::tm tm{};
+    std::istringstream ss(text);
+
+    ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+
+    if (ss.fail())
+        throw std::invalid_argument("time has to be formatted as YYYY-MM-DD HH:MM:SS[.fff], got " + text);
+
+    double fraction = 0;
+
+    if (ss.peek() == '.')
+        ss >> fraction;
+
+    tm.tm_isdst = -1;
+
+    return static_cast<int64_t>(std::mktime(&tm)) * 1000000000 + std::llround(fraction * 1e9);
+}
+
+/**
+ * @brief Writer for the format of an output file, picked by its extension.
+ *
+ * @param output output file
+ * @param file format of the extracted recordings
+ * @return std::unique_ptr<RecordingWriter> configured writer
+ */
+std::unique_ptr<RecordingWriter> make_writer(const std::filesystem::path &output, const RecordingFile &file)
+{
+    std::unique_ptr<RecordingWriter> writer;
+    const auto extension = output.extension();
+
+    if (extension == ".flac")
+    {
+        writer = std::make_unique<FlacWriter>(std::vector<int>{-1, -1});
+        writer->set_sample_rate(std::lround(file.sample_rate()));
+    }
+    else if (extension == ".mseed")
+    {
+        auto mseed = std::make_unique<MiniSeedWriter>();
+        mseed->set_exact_sample_rate(file.sample_rate());
+        writer = std::move(mseed);
+    }
+    else if (extension == ".drga")
+    {
+        auto archive = std::make_unique<ArchiveWriter>();
+        archive->set_exact_sample_rate(file.sample_rate());
+        writer = std::move(archive);
+    }
+    else if (extension == ".wav")
+    {
+        writer = std::make_unique<WAVWriter>();
+        writer->set_sample_rate(std::lround(file.sample_rate()));
+    }
+    else
+        throw std::invalid_argument("output has to be a .wav, .flac, .mseed or .drga file");
+
+    writer->set_n_channels(file.n_channels());
+    writer->set_bits_per_sample(file.bits_per_sample());
+
+    return writer;
+}
+
+int main(int argc, char *argv[])
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    argparse::ArgumentParser program("drongo_extract");
+
+    program.add_argument("-i", "--input")
+        .help("directory with the recorded WAV or archive files")
+        .default_value(std::string("drongo_data"));
+
+    program.add_argument("-s", "--start")
+        .help("local start time of the extracted range, YYYY-MM-DD HH:MM:SS[.fff]")
+        .required();
+
+    program.add_argument("-d", "--duration")
+        .help("length of the extracted range in seconds")
+        .default_value(60.0)
+        .scan<'g', double>();
+
+    program.add_argument("-o", "--output")
+        .help("file to write the range to, .wav, .flac, .mseed or .drga, without it the range is only summarized")
+        .default_value(std::string(""));
+
+    program.add_argument("--verify")
+        .help("check the checksums of the archive files in the range")
+        .default_value(false)
+        .implicit_value(true);
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what() << std::endl;
+        LOG(ERROR) << program;
+        return 1;
+    }
+
+    try
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+
+        const int64_t begin_ns = parse_time(program.get("--start"));
+        const int64_t end_ns = begin_ns + std::llround(program.get<double>("--duration") * 1e9);
+
+        RecordingReader reader(program.get("--input"));
+        std::vector<RecordingFile *> files = reader.files(begin_ns, end_ns);
+
+        if (files.empty())
+        {
+            LOG(ERROR) << "no recordings between the start and end time among " << reader.n_files() << " files";
+            return 1;
+        }
+
+        uint64_t n_frames = 0, damaged = 0, flagged = 0;
+        uint32_t gaps = 0;
+
+        for (RecordingFile *file : files)
+        {
+            for (const RecordingSegment &segment : file->segments(begin_ns, end_ns))
+            {
+                n_frames += segment.n_frames;
+                gaps |= segment.gap_mask;
+                flagged += segment.status.size();
+            }
+
+            if (program.get<bool>("--verify"))
+            {
+                const uint64_t bad = file->verify();
+
+                if (bad)
+                    LOG(ERROR) << file->path() << " has " << bad << " damaged blocks";
+
+                damaged += bad;
+            }
+        }
+
+        LOG(INFO) << n_frames << " frames of " << files.front()->n_channels() << " channels in " << files.size()
+                  << " files, found in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms";
+
+        if (gaps)
+            LOG(WARNING) << (files.front()->merged() ? "unit mask " : "channel mask ") << gaps << " has " << (files.front()->raw() || files.front()->merged() ? "missing" : "filled in") << " samples in the range";
+
+        if (flagged)
+            LOG(WARNING) << flagged << " frames in the range have overflow or supply flags";
+
+        if (!program.get("--output").empty())
+        {
+            const std::filesystem::path output = program.get("--output");
+
+            int64_t start_ns;
+            std::vector<int32_t> samples = reader.read(begin_ns, end_ns, start_ns);
+
+            auto writer = make_writer(output, *files.front());
+
+            writer->open_file(output.string());
+            writer->set_datetime(std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(start_ns))));
+            writer->write_frames(samples, samples.size() / files.front()->n_channels());
+            writer->set_comments("extracted from " + program.get("--input"));
+            writer->close_file();
+            writer->flush();
+
+            LOG(INFO) << "wrote " << output << " in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms";
+        }
+
+        return damaged ? 2 : 0;
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,99 @@
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include "argparse/argparse.hpp"
+
+#define ELPP_NO_LOG_TO_FILE
+#include "easylogging++.h"
+
+#include "StreamClient.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+int main(int argc, char *argv[])
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    argparse::ArgumentParser program("drongo_monitor");
+
+    program.add_argument("host")
+        .help("name or address of the unit")
+        .default_value(std::string("127.0.0.1"));
+
+    program.add_argument("-p", "--port")
+        .help("port of the stream server")
+        .default_value(int(STREAM_DEFAULT_PORT))
+        .scan<'i', int>();
+
+    program.add_argument("-c", "--count")
+        .help("stop after this many blocks, 0 keeps running")
+        .default_value(0)
+        .scan<'i', int>();
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what() << std::endl;
+        LOG(ERROR) << program;
+        return 1;
+    }
+
+    try
+    {
+        StreamClient client(program.get("host"), program.get<int>("--port"));
+
+        LOG(INFO) << "connected to " << client.name();
+
+        StreamBlockHeader header;
+        std::vector<int32_t> samples;
+
+        const int count = program.get<int>("--count");
+        uint64_t expected = 0, n_blocks = 0, n_frames = 0, skipped = 0;
+        double latency_sum = 0, latency_max = 0;
+        bool first = true;
+
+        auto report_time = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+        for (int received = 0; (!count || received < count) && client.receive(header, samples); received++)
+        {
+            // the latency is counted from the moment the last frame of the block was measured
+            const int64_t end_ns = header.start_time_ns + std::llround(header.n_frames * 1e9 / header.sample_rate);
+            const double latency = (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() - end_ns) / 1e6;
+
+            if (!first && header.sequence != expected)
+                skipped += header.sequence - expected;
+
+            first = false;
+            expected = header.sequence + 1;
+
+            n_blocks++;
+            n_frames += header.n_frames;
+            latency_sum += latency;
+            latency_max = std::max(latency_max, latency);
+
+            if (std::chrono::steady_clock::now() >= report_time)
+            {
+                LOG(INFO) << n_blocks << " blocks, " << n_frames << " frames of " << header.n_channels << " channels at "
+                          << header.sample_rate << " Hz, latency mean " << latency_sum / n_blocks << " ms, max " << latency_max
+                          << " ms, " << skipped << " blocks skipped";
+
+                n_blocks = n_frames = 0;
+                latency_sum = latency_max = 0;
+                report_time += std::chrono::seconds(1);
+            }
+        }
+
+        LOG(INFO) << "stream ended, " << skipped << " blocks skipped";
+
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,386 @@
+#include <cmath>
+#include <chrono>
+#include <atomic>
+
+#include "argparse/argparse.hpp"
+
+#define ELPP_NO_LOG_TO_FILE
+#include "easylogging++.h"
+
+#include "RecordingReader.h"
+#include "SignalProcessor.h"
+#include "WAVwriter.h"
+#include "FlacWriter.h"
+#include "MiniSeedWriter.h"
+#include "ArchiveWriter.h"
+#include "utils/WorkStealingPool.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+/// Frames unpacked and filtered at once, keeps the memory per worker small for hour long archive files.
+constexpr size_t CHUNK_FRAMES = 1 << 16;
+
+/**
+ * @brief What is known of an input file before it is processed.
+ */
+struct InputFile
+{
+    std::filesystem::path path;
+    bool valid = false;
+    uint16_t n_channels = 0;
+    uint16_t bits_per_sample = 0;
+    double sample_rate = 0;
+    int64_t start_time_ns = 0;
+    int64_t end_time_ns = 0;
+    uint64_t n_frames = 0;
+    bool discontinuity = false; ///< Whether the recorder flagged the first block as the start of a measurement.
+
+    bool follows = false;  ///< Whether the file continues the previous file without a break.
+    uint64_t run_frame = 0; ///< Frames before this file since the start of the measurement.
+};
+
+/**
+ * @brief Writer for an output format.
+ *
+ * @param format wav, flac, mseed or drga
+ * @param input file that is reprocessed
+ * @param sample_rate sample rate of the output
+ * @return std::unique_ptr<RecordingWriter> configured writer
+ */
+std::unique_ptr<RecordingWriter> make_writer(const std::string &format, const InputFile &input, double sample_rate)
+{
+    std::unique_ptr<RecordingWriter> writer;
+
+    if (format == "flac")
+    {
+        // every worker has its own writer, so one encoding thread each is enough
+        writer = std::make_unique<FlacWriter>(std::vector<int>{-1});
+        writer->set_sample_rate(std::lround(sample_rate));
+    }
+    else if (format == "mseed")
+    {
+        auto mseed = std::make_unique<MiniSeedWriter>();
+        mseed->set_exact_sample_rate(sample_rate);
+        writer = std::move(mseed);
+    }
+    else if (format == "drga")
+    {
+        auto archive = std::make_unique<ArchiveWriter>();
+        archive->set_exact_sample_rate(sample_rate);
+        writer = std::move(archive);
+    }
+    else if (format == "wav")
+    {
+        writer = std::make_unique<WAVWriter>();
+        writer->set_sample_rate(std::lround(sample_rate));
+    }
+    else
+        throw std::invalid_argument("format has to be wav, flac, mseed or drga");
+
+    writer->set_n_channels(input.n_channels);
+    writer->set_bits_per_sample(input.bits_per_sample);
+
+    return writer;
+}
+
+/**
+ * @brief Run the unpacked frames of a file through the processor.
+ *
+ * @param file input file
+ * @param begin_ns first point in time
+ * @param skip_frames frames at the start that were already processed
+ * @param processor processor of the file
+ * @param emit called with the kept frames and the channels that had filled in samples
+ */
+template <typename Emit>
+void process_file(const RecordingFile &file, int64_t begin_ns, uint64_t skip_frames, SignalProcessor &processor, Emit emit)
+{
+    const uint16_t n_channels = file.n_channels();
+
+    std::vector<int32_t> in, out;
+    in.reserve(CHUNK_FRAMES * n_channels);
+
+    for (const RecordingSegment &segment : file.segments(begin_ns, file.end_time_ns()))
+    {
+        const size_t frame_size = static_cast<size_t>(n_channels) * file.bytes_per_sample();
+
+        const uint64_t first = std::min(skip_frames, segment.n_frames);
+        skip_frames -= first;
+
+        for (uint64_t f = first; f < segment.n_frames; f += CHUNK_FRAMES)
+        {
+            const size_t n_frames = std::min<uint64_t>(CHUNK_FRAMES, segment.n_frames - f);
+
+            in.resize(n_frames * n_channels);
+            RecordingFile::unpack(segment.data.subspan(f * frame_size, n_frames * frame_size), file.bytes_per_sample(), in.data());
+
+            const uint32_t gaps = processor.process(in, n_frames, out) | segment.gap_mask;
+
+            emit(out, gaps);
+            out.clear();
+        }
+    }
+}
+
+/**
+ * @brief Unpack the first frame of a file.
+ *
+ * @param file input file
+ * @return std::vector<int32_t> samples of the frame
+ */
+std::vector<int32_t> first_frame(const RecordingFile &file)
+{
+    std::vector<int32_t> frame(file.n_channels());
+
+    RecordingFile::unpack(file.segments(file.start_time_ns(), file.end_time_ns()).front().data.first(frame.size() * file.bytes_per_sample()), file.bytes_per_sample(), frame.data());
+
+    return frame;
+}
+
+int main(int argc, char *argv[])
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    argparse::ArgumentParser program("drongo_reprocess");
+
+    program.add_argument("-i", "--input")
+        .help("directory with the recorded WAV or archive files")
+        .default_value(std::string("drongo_data"));
+
+    program.add_argument("-o", "--output")
+        .help("directory to write the reprocessed files to")
+        .required();
+
+    program.add_argument("-f", "--format")
+        .help("format of the reprocessed files: wav, flac, mseed or drga")
+        .default_value(std::string("wav"));
+
+    program.add_argument("--lowpass")
+        .help("cut-off frequency of the low-pass filter in Hz, 0 disables it")
+        .default_value(450.0)
+        .scan<'g', double>();
+
+    program.add_argument("--decimate")
+        .help("keep only every n-th frame")
+        .default_value(1u)
+        .scan<'u', uint32_t>();
+
+    program.add_argument("--no_gap_fill")
+        .help("keep samples the ADC did not deliver at 0")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--extend_response")
+        .help("extend the geophone response down to this natural frequency in Hz, 0 disables it")
+        .default_value(0.0)
+        .scan<'g', double>();
+
+    program.add_argument("--extended_damping")
+        .help("damping ratio of the extended response")
+        .default_value(0.707)
+        .scan<'g', double>();
+
+    program.add_argument("--geophone_frequency")
+        .help("natural frequency of the geophones in Hz")
+        .default_value(4.5)
+        .scan<'g', double>();
+
+    program.add_argument("--geophone_damping")
+        .help("damping ratio of the geophones")
+        .default_value(0.7)
+        .scan<'g', double>();
+
+    program.add_argument("--warmup")
+        .help("seconds of the previous file the filters run over before a file, so they continue where it ended")
+        .default_value(5.0)
+        .scan<'g', double>();
+
+    program.add_argument("-j", "--threads")
+        .help("number of worker threads, 0 uses every core")
+        .default_value(0u)
+        .scan<'u', uint32_t>();
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what() << std::endl;
+        LOG(ERROR) << program;
+        return 1;
+    }
+
+    try
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+
+        const std::filesystem::path input_path = program.get("--input");
+        const std::filesystem::path output_path = program.get("--output");
+        const std::string format = program.get("--format");
+
+        std::filesystem::create_directories(output_path);
+
+        if (std::filesystem::equivalent(input_path, output_path))
+            throw std::invalid_argument("the output directory has to differ from the input directory");
+
+        SignalProcessorConfig config;
+        config.lowpass_frequency = program.get<double>("--lowpass");
+        config.fill_gaps = !program.get<bool>("--no_gap_fill");
+        config.decimation = program.get<uint32_t>("--decimate");
+
+        if (program.get<double>("--extend_response") > 0)
+        {
+            config.response_extension = true;
+            config.response = {.natural_frequency = program.get<double>("--geophone_frequency"),
+                               .damping = program.get<double>("--geophone_damping"),
+                               .target_frequency = program.get<double>("--extend_response"),
+                               .target_damping = program.get<double>("--extended_damping")};
+        }
+
+        const int64_t warmup_ns = std::llround(program.get<double>("--warmup") * 1e9);
+
+        RecordingReader reader(input_path);
+        std::vector<InputFile> inputs;
+
+        for (const auto &path : reader.paths())
+            inputs.push_back({.path = path});
+
+        if (inputs.empty())
+        {
+            LOG(ERROR) << "no recordings in " << input_path;
+            return 1;
+        }
+
+        WorkStealingPool pool(program.get<uint32_t>("--threads"));
+
+        // reading the headers first tells which files continue each other, the files are opened again when processed
+        pool.run(inputs.size(), [&](size_t i, size_t)
+                 {
+            InputFile &input = inputs[i];
+
+            try
+            {
+                RecordingFile file(input.path);
+
+                input.n_channels = file.n_channels();
+                input.bits_per_sample = file.bits_per_sample();
+                input.sample_rate = file.sample_rate();
+                input.start_time_ns = file.start_time_ns();
+                input.end_time_ns = file.end_time_ns();
+                input.n_frames = file.n_frames();
+
+                const auto segments = file.segments(file.start_time_ns(), file.end_time_ns());
+                input.discontinuity = !segments.empty() && segments.front().discontinuity;
+                input.valid = input.n_frames > 0;
+            }
+            catch (const std::exception &e)
+            {
+                LOG(WARNING) << "skipping " << input.path << ": " << e.what();
+            } });
+
+        uint64_t total_frames = 0;
+
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            InputFile &input = inputs[i];
+            const InputFile *previous = i ? &inputs[i - 1] : nullptr;
+
+            if (!input.valid)
+                continue;
+
+            if (config.lowpass_frequency >= input.sample_rate / 2 / config.decimation)
+                LOG(WARNING) << input.path << ": the low-pass at " << config.lowpass_frequency << " Hz is above the nyquist frequency after decimation";
+
+            // WAV files only store whole seconds, so files closer than a second to each other count as continuous
+            input.follows = previous && previous->valid && !input.discontinuity &&
+                            previous->n_channels == input.n_channels &&
+                            previous->bits_per_sample == input.bits_per_sample &&
+                            previous->sample_rate == input.sample_rate &&
+                            std::abs(input.start_time_ns - previous->end_time_ns) < 1000000000;
+
+            input.run_frame = input.follows ? previous->run_frame + previous->n_frames : 0;
+            total_frames += input.n_frames;
+        }
+
+        std::atomic<uint64_t> n_done = 0;
+
+        pool.run(inputs.size(), [&](size_t i, size_t)
+                 {
+            const InputFile &input = inputs[i];
+
+            if (!input.valid)
+                return;
+
+            RecordingFile file(input.path);
+
+            SignalProcessor processor;
+            processor.setup(input.n_channels, input.sample_rate, config);
+
+            uint64_t skip_frames = 0;
+
+            if (input.follows && warmup_ns > 0)
+            {
+                // the filters settle on the end of the previous file, which leaves them close to where the recorder had them
+                RecordingFile previous(inputs[i - 1].path);
+                process_file(previous, previous.end_time_ns() - warmup_ns, 0, processor, [](std::vector<int32_t> &, uint32_t) {});
+
+                // the first frame is the successor of the held back last frame of the previous file, which is dropped
+                std::vector<int32_t> discard;
+                processor.process(first_frame(file), 1, discard);
+                skip_frames = 1;
+            }
+
+            // kept frames stay evenly spaced over file boundaries
+            const uint64_t skip = (config.decimation - input.run_frame % config.decimation) % config.decimation;
+            processor.set_decimation_phase(skip);
+
+            const std::filesystem::path output = (output_path / input.path.filename()).replace_extension("." + format);
+
+            auto writer = make_writer(format, input, processor.output_rate());
+
+            writer->open_file(output.string());
+            writer->set_datetime(std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(input.start_time_ns + std::llround(skip * 1e9 / input.sample_rate)))));
+
+            auto write = [&](std::vector<int32_t> &frames, uint32_t gaps)
+            {
+                if (gaps)
+                    writer->mark_gaps(gaps);
+
+                writer->write_frames(frames, frames.size() / input.n_channels);
+            };
+
+            process_file(file, file.start_time_ns(), skip_frames, processor, write);
+
+            // the last frame is filled in from the first frame of the next file, like the recorder did
+            std::vector<int32_t> last;
+            uint32_t gaps;
+
+            if (i + 1 < inputs.size() && inputs[i + 1].follows)
+                gaps = processor.process(first_frame(RecordingFile(inputs[i + 1].path)), 1, last);
+            else
+                gaps = processor.flush(last);
+
+            write(last, gaps);
+
+            writer->set_comments("reprocessed from " + input.path.filename().string());
+            writer->close_file();
+            writer->flush();
+
+            LOG(INFO) << "[" << ++n_done << "/" << inputs.size() << "] " << output; });
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        const double recorded = inputs.front().sample_rate > 0 ? total_frames / inputs.front().sample_rate : 0;
+
+        LOG(INFO) << "reprocessed " << inputs.size() << " files with " << total_frames << " frames on " << pool.n_workers()
+                  << " threads in " << seconds << " s, " << recorded / seconds << " times faster than real time";
+
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << e.what();
+        return 1;
+    }
+}
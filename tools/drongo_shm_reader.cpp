@@ -0,0 +1,140 @@
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <sstream>
+#include <iomanip>
+
+#include "argparse/argparse.hpp"
+
+#define ELPP_NO_LOG_TO_FILE
+#include "easylogging++.h"
+
+#include "ShmRingReader.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+std::atomic_bool running = true;
+
+int main(int argc, char *argv[])
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    argparse::ArgumentParser program("drongo_shm_reader");
+
+    program.add_argument("-n", "--name")
+        .help("name of the shared memory ring")
+        .default_value(std::string(SHM_RING_DEFAULT_NAME));
+
+    program.add_argument("--oldest")
+        .help("start at the oldest frame in the ring instead of the newest")
+        .default_value(false)
+        .implicit_value(true);
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what() << std::endl;
+        LOG(ERROR) << program;
+        return 1;
+    }
+
+    std::signal(SIGINT, [](int)
+                { running = false; });
+    std::signal(SIGTERM, [](int)
+                { running = false; });
+
+    try
+    {
+        ShmRingReader reader(program.get("--name"));
+
+        if (program.get<bool>("--oldest"))
+            reader.rewind();
+
+        const uint16_t n_channels = reader.n_channels();
+        ShmStreamInfo info = reader.info();
+
+        LOG(INFO) << "following " << program.get("--name") << ", " << n_channels << " channels at " << info.sample_rate
+                  << " Hz, " << reader.capacity() << " frames in the ring";
+
+        // statistics of the last second, computed straight on the shared frames
+        std::vector<double> sum(n_channels), sum_squares(n_channels), view_sum(n_channels), view_squares(n_channels);
+        uint64_t n_frames = 0, torn = 0;
+        double latency_max = 0;
+
+        auto report_time = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+        while (running && !reader.closed())
+        {
+            if (reader.wait(std::chrono::milliseconds(200)))
+            {
+                const ShmRingView view = reader.peek();
+
+                std::fill(view_sum.begin(), view_sum.end(), 0);
+                std::fill(view_squares.begin(), view_squares.end(), 0);
+
+                for (const auto &part : view.parts)
+                    for (size_t s = 0; s < part.size(); s++)
+                    {
+                        view_sum[s % n_channels] += part[s];
+                        view_squares[s % n_channels] += double(part[s]) * part[s];
+                    }
+
+                if (reader.consume(view))
+                {
+                    for (uint16_t c = 0; c < n_channels; c++)
+                    {
+                        sum[c] += view_sum[c];
+                        sum_squares[c] += view_squares[c];
+                    }
+
+                    n_frames += view.n_frames;
+                }
+                else
+                    torn++;
+
+                if (reader.info().generation != info.generation)
+                    info = reader.info();
+
+                const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+                latency_max = std::max(latency_max, (now_ns - info.frame_time_ns(view.first_frame + view.n_frames)) / 1e6);
+            }
+
+            if (std::chrono::steady_clock::now() < report_time)
+                continue;
+
+            std::stringstream ss;
+            ss << n_frames << " frames, latency max " << latency_max << " ms, " << reader.lost() << " frames lost, rms";
+
+            for (uint16_t c = 0; c < n_channels && n_frames; c++)
+            {
+                const double mean = sum[c] / n_frames;
+                ss << " " << std::lround(std::sqrt(std::max(0.0, sum_squares[c] / n_frames - mean * mean)));
+            }
+
+            if (torn)
+                ss << ", " << torn << " views overwritten while reading";
+
+            LOG(INFO) << ss.str();
+
+            std::fill(sum.begin(), sum.end(), 0);
+            std::fill(sum_squares.begin(), sum_squares.end(), 0);
+            n_frames = torn = 0;
+            latency_max = 0;
+            report_time += std::chrono::seconds(1);
+        }
+
+        if (reader.closed())
+            LOG(INFO) << "the writer stopped";
+
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,156 @@
+#include <cmath>
+#include <atomic>
+#include <csignal>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <numbers>
+
+#include "argparse/argparse.hpp"
+
+#define ELPP_NO_LOG_TO_FILE
+#include "easylogging++.h"
+
+#include "StreamServer.h"
+#include "ShmRingWriter.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+std::atomic_bool running = true;
+
+int main(int argc, char *argv[])
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    argparse::ArgumentParser program("drongo_simulator");
+
+    program.add_argument("-p", "--port")
+        .help("port to stream on")
+        .default_value(int(STREAM_DEFAULT_PORT))
+        .scan<'i', int>();
+
+    program.add_argument("--address")
+        .help("local address to listen on")
+        .default_value(std::string("127.0.0.1"));
+
+    program.add_argument("-n", "--number_channels")
+        .help("number of simulated geophones")
+        .default_value(4)
+        .scan<'i', int>();
+
+    program.add_argument("-r", "--rate")
+        .help("sample rate in Hz")
+        .default_value(1000.0)
+        .scan<'g', double>();
+
+    program.add_argument("--block_ms")
+        .help("length of a streamed block in milliseconds")
+        .default_value(100)
+        .scan<'i', int>();
+
+    program.add_argument("--stream_ring")
+        .help("blocks that can wait for each client")
+        .default_value(16)
+        .scan<'i', int>();
+
+    program.add_argument("--stream_disconnect_slow")
+        .help("disconnect clients that do not keep up instead of skipping blocks for them")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--shm")
+        .help("also publish the frames in a shared memory ring with this name")
+        .default_value(std::string());
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception &err)
+    {
+        LOG(ERROR) << err.what() << std::endl;
+        LOG(ERROR) << program;
+        return 1;
+    }
+
+    std::signal(SIGINT, [](int)
+                { running = false; });
+    std::signal(SIGTERM, [](int)
+                { running = false; });
+
+    const uint16_t n_channels = program.get<int>("--number_channels");
+    const double rate = program.get<double>("--rate");
+    const uint32_t block_frames = std::max<long>(1, std::lround(rate * program.get<int>("--block_ms") / 1000.0));
+
+    StreamServer server(program.get<int>("--port"), program.get<int>("--stream_ring"),
+                        program.get<bool>("--stream_disconnect_slow") ? StreamServer::SlowClientPolicy::DISCONNECT : StreamServer::SlowClientPolicy::SKIP,
+                        program.get("--address"));
+
+    try
+    {
+        server.start();
+    }
+    catch (const std::exception &e)
+    {
+        LOG(ERROR) << e.what();
+        return 1;
+    }
+
+    std::unique_ptr<ShmRingWriter> ring;
+
+    const auto start = std::chrono::system_clock::now();
+    const int64_t start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+
+    if (!program.get("--shm").empty())
+    {
+        try
+        {
+            ring = std::make_unique<ShmRingWriter>(program.get("--shm"));
+            ring->open(n_channels, std::llround(10 * rate));
+            ring->start_stream(rate, start_ns);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(ERROR) << e.what();
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(std::random_device{}());
+    std::normal_distribution<double> noise(0, 2000);
+
+    // every geophone sees a tone of its own on top of noise
+    auto sample = [&](uint16_t channel, uint64_t frame)
+    {
+        const double t = frame / rate;
+
+        return static_cast<int32_t>(std::lround(1e6 * std::sin(2 * std::numbers::pi * (5.0 + channel) * t) + noise(rng)));
+    };
+
+    for (uint64_t sequence = 0, frame = 0; running; sequence++, frame += block_frames)
+    {
+        auto block = std::make_shared<SampleBlock>();
+        block->sequence = sequence;
+        block->start_time_ns = start_ns + std::llround(frame * 1e9 / rate);
+        block->first_sample = frame;
+        block->sample_rate = rate;
+        block->n_channels = n_channels;
+        block->samples.resize(size_t(block_frames) * n_channels);
+
+        for (uint32_t f = 0; f < block_frames; f++)
+            for (uint16_t c = 0; c < n_channels; c++)
+                block->samples[f * n_channels + c] = sample(c, frame + f);
+
+        // a block is published once its last frame would have been measured
+        std::this_thread::sleep_until(start + std::chrono::nanoseconds(std::llround((frame + block_frames) * 1e9 / rate)));
+
+        if (ring)
+            ring->write(block->samples, block_frames);
+
+        server.publish(std::move(block));
+    }
+
+    server.stop();
+
+    return 0;
+}